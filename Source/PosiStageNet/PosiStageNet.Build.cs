@@ -36,6 +36,7 @@ public class PosiStageNet : ModuleRules
 			{
 				"Networking",
 				"Sockets",
+				"Json",
 			});
 		
 		
@@ -0,0 +1,473 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+
+#include "Commandlets/PSNLoadCommandlet.h"
+#include "PosiStageNet.h"
+#include "PSNReceiverSubsystem.h"
+#include "Tests/PSNTestHarness.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "Common/UdpSocketBuilder.h"
+#include "CoreGlobals.h"
+#include "HAL/PlatformProcess.h"
+#include "Interfaces/IPv4/IPv4Address.h"
+#include "Math/RandomStream.h"
+#include "Misc/OutputDeviceRedirector.h"
+#include "Misc/Parse.h"
+#include "SocketSubsystem.h"
+#include "Sockets.h"
+
+#include "PSN/psn_lib.hpp"
+
+namespace PSNLoad
+{
+	enum class EMotion : uint8
+	{
+		Static,
+		Circle,
+		PingPong,
+		RandomWalk
+	};
+
+	// Trackers stay inside a 20m square stage, in PSN meters
+	static constexpr float StageHalfSize = 10.f;
+
+	struct FOptions
+	{
+		int32 SourceCount = 4;
+		int32 TrackersPerSource = 100;
+		TArray<float> Rates = { 60.f };
+		EMotion Motion = EMotion::Circle;
+		float Loss = 0.f;
+		float Reorder = 0.f;
+		float Duplicate = 0.f;
+		int32 Seed = 1;
+		FString Address = TEXT("236.10.10.10");
+		int32 Port = 56565;
+		FString BindBase;
+		float Duration = 60.f;
+		float ReportInterval = 10.f;
+		bool bReceive = false;
+	};
+
+	struct FSource
+	{
+		FString Name;
+		FSocket* Socket = nullptr;
+		TUniquePtr<::psn::psn_encoder> Encoder;
+		::psn::tracker_map Trackers;
+		FRandomStream Random;
+
+		double FrameInterval = 0.0;
+		double NextFrame = 0.0;
+		double NextInfo = 0.0;
+		double LastFrameTime = 0.0;
+
+		// A packet picked for reordering goes out after the next one
+		::std::string HeldPacket;
+		bool bHasHeldPacket = false;
+
+		uint64 Frames = 0;
+		uint64 PacketsSent = 0;
+		uint64 BytesSent = 0;
+		uint64 PacketsDropped = 0;
+		uint64 PacketsReordered = 0;
+		uint64 PacketsDuplicated = 0;
+		uint64 SocketErrors = 0;
+	};
+
+	static EMotion ParseMotion(const FString& Name)
+	{
+		if (Name == TEXT("static"))
+		{
+			return EMotion::Static;
+		}
+		if (Name == TEXT("pingpong"))
+		{
+			return EMotion::PingPong;
+		}
+		if (Name == TEXT("random"))
+		{
+			return EMotion::RandomWalk;
+		}
+		return EMotion::Circle;
+	}
+
+	static FOptions ParseOptions(const FString& Params)
+	{
+		FOptions Options;
+
+		FParse::Value(*Params, TEXT("sources="), Options.SourceCount);
+		FParse::Value(*Params, TEXT("trackers="), Options.TrackersPerSource);
+		FParse::Value(*Params, TEXT("loss="), Options.Loss);
+		FParse::Value(*Params, TEXT("reorder="), Options.Reorder);
+		FParse::Value(*Params, TEXT("duplicate="), Options.Duplicate);
+		FParse::Value(*Params, TEXT("seed="), Options.Seed);
+		FParse::Value(*Params, TEXT("address="), Options.Address);
+		FParse::Value(*Params, TEXT("port="), Options.Port);
+		FParse::Value(*Params, TEXT("bind="), Options.BindBase);
+		FParse::Value(*Params, TEXT("duration="), Options.Duration);
+		FParse::Value(*Params, TEXT("report="), Options.ReportInterval);
+		Options.bReceive = FParse::Param(*Params, TEXT("receive"));
+
+		// Rates are cycled across sources, so -rates=60,120 alternates between the two
+		FString Rates;
+		if (FParse::Value(*Params, TEXT("rates="), Rates, false) || FParse::Value(*Params, TEXT("rate="), Rates, false))
+		{
+			TArray<FString> RateStrings;
+			Rates.ParseIntoArray(RateStrings, TEXT(","));
+			Options.Rates.Reset();
+			for (const FString& Rate : RateStrings)
+			{
+				Options.Rates.Add(FMath::Max(FCString::Atof(*Rate), 1.f));
+			}
+			if (Options.Rates.Num() == 0)
+			{
+				Options.Rates.Add(60.f);
+			}
+		}
+
+		FString Motion;
+		if (FParse::Value(*Params, TEXT("motion="), Motion))
+		{
+			Options.Motion = ParseMotion(Motion.ToLower());
+		}
+
+		Options.SourceCount = FMath::Clamp(Options.SourceCount, 1, 255);
+		// Every source gets its own block of IDs, as a receiver holds one tracker per ID
+		Options.TrackersPerSource = FMath::Clamp(Options.TrackersPerSource, 1, 65535 / Options.SourceCount);
+		Options.Loss = FMath::Clamp(Options.Loss, 0.f, 1.f);
+		Options.Reorder = FMath::Clamp(Options.Reorder, 0.f, 1.f);
+		Options.Duplicate = FMath::Clamp(Options.Duplicate, 0.f, 1.f);
+		Options.ReportInterval = FMath::Max(Options.ReportInterval, 1.f);
+		return Options;
+	}
+
+	static ::psn::float3 MotionPosition(EMotion Motion, const ::psn::float3& Previous, int32 Index, float Time, FRandomStream& Random)
+	{
+		// Spread trackers over a grid so static and ping pong trackers do not overlap
+		const float GridX = (float)(Index % 20) - 9.5f;
+		const float GridY = (float)((Index / 20) % 20) - 9.5f;
+		const float Phase = Index * 0.37f;
+
+		switch (Motion)
+		{
+		case EMotion::Circle:
+		{
+			const float Radius = 1.f + (Index % 8);
+			return ::psn::float3(FMath::Cos(Time + Phase) * Radius, FMath::Sin(Time + Phase) * Radius, 1.5f);
+		}
+		case EMotion::PingPong:
+		{
+			// Triangle wave between the stage edges, about 4m/s
+			const float Travel = FMath::Fmod(Time * 4.f + Phase * StageHalfSize, StageHalfSize * 4.f);
+			const float X = Travel < StageHalfSize * 2.f ? Travel - StageHalfSize : StageHalfSize * 3.f - Travel;
+			return ::psn::float3(X, GridY, 1.5f);
+		}
+		case EMotion::RandomWalk:
+		{
+			const float Step = 0.05f;
+			return ::psn::float3(
+				FMath::Clamp(Previous.x + Random.FRandRange(-Step, Step), -StageHalfSize, StageHalfSize),
+				FMath::Clamp(Previous.y + Random.FRandRange(-Step, Step), -StageHalfSize, StageHalfSize),
+				1.5f);
+		}
+		default:
+			return ::psn::float3(GridX, GridY, 0.f);
+		}
+	}
+
+	static uint64 NowMicroseconds()
+	{
+		return (uint64)(FPlatformTime::Seconds() * 1e6);
+	}
+
+	class FLoadGenerator
+	{
+	public:
+
+		explicit FLoadGenerator(const FOptions& InOptions)
+			: Options(InOptions)
+		{
+		}
+
+		~FLoadGenerator()
+		{
+			for (FSource& Source : Sources)
+			{
+				if (Source.Socket)
+				{
+					ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(Source.Socket);
+				}
+			}
+		}
+
+		bool Initialize(double Now)
+		{
+			ISocketSubsystem* SocketSubsystem = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+
+			bool bIsValidAddress = true;
+			Destination = SocketSubsystem->CreateInternetAddr();
+			Destination->SetIp(*Options.Address, bIsValidAddress);
+			Destination->SetPort(Options.Port);
+			if (!bIsValidAddress)
+			{
+				UE_LOG(LogPSN, Error, TEXT("PSN Load: invalid address %s"), *Options.Address);
+				return false;
+			}
+
+			FIPv4Address BindBase = FIPv4Address::Any;
+			if (!Options.BindBase.IsEmpty() && !FIPv4Address::Parse(Options.BindBase, BindBase))
+			{
+				UE_LOG(LogPSN, Error, TEXT("PSN Load: invalid bind address %s"), *Options.BindBase);
+				return false;
+			}
+
+			Sources.SetNum(Options.SourceCount);
+			for (int32 SourceIndex = 0; SourceIndex < Sources.Num(); SourceIndex++)
+			{
+				FSource& Source = Sources[SourceIndex];
+				Source.Name = FString::Printf(TEXT("PSN Load %d"), SourceIndex);
+				Source.Random.Initialize(Options.Seed + SourceIndex * 7919);
+
+				const FIPv4Address BindAddress = BindBase == FIPv4Address::Any ? BindBase : FIPv4Address(BindBase.Value + SourceIndex);
+				Source.Socket = FUdpSocketBuilder(*Source.Name)
+					.BoundToAddress(BindAddress)
+					.WithMulticastLoopback()
+					.WithSendBufferSize(2 * 1024 * 1024)
+					.Build();
+				if (!Source.Socket)
+				{
+					UE_LOG(LogPSN, Error, TEXT("PSN Load: failed to create a socket bound to %s"), *BindAddress.ToString());
+					return false;
+				}
+
+				Source.Encoder = MakeUnique<::psn::psn_encoder>(TCHAR_TO_ANSI(*Source.Name));
+				for (int32 Index = 0; Index < Options.TrackersPerSource; Index++)
+				{
+					const uint16_t ID = (uint16_t)(SourceIndex * Options.TrackersPerSource + Index + 1);
+					::psn::tracker Tracker(ID, TCHAR_TO_ANSI(*FString::Printf(TEXT("Src%d_Trk%d"), SourceIndex, ID)));
+					Tracker.set_pos(MotionPosition(EMotion::Static, ::psn::float3(), Index, 0.f, Source.Random));
+					Tracker.set_status(1.f);
+					Source.Trackers.emplace(ID, Tracker);
+				}
+
+				// Stagger start times so sources do not all send in the same instant
+				Source.FrameInterval = 1.0 / Options.Rates[SourceIndex % Options.Rates.Num()];
+				Source.NextFrame = Now + Source.FrameInterval * Source.Random.FRand();
+				Source.NextInfo = Source.NextFrame;
+				Source.LastFrameTime = Now;
+			}
+
+			StartTime = Now;
+			return true;
+		}
+
+		// Sends everything due at Now
+		void Tick(double Now)
+		{
+			for (FSource& Source : Sources)
+			{
+				if (Now >= Source.NextInfo)
+				{
+					SendPackets(Source, Source.Encoder->encode_info(Source.Trackers, NowMicroseconds()), false);
+					Source.NextInfo += 1.0;
+				}
+
+				if (Now >= Source.NextFrame)
+				{
+					SendFrame(Source, Now);
+
+					// After a stall keep the rate rather than bursting to catch up
+					Source.NextFrame = FMath::Max(Source.NextFrame + Source.FrameInterval, Now);
+				}
+			}
+		}
+
+		void Report(double Now, bool bFinal) const
+		{
+			FSource Total;
+			for (const FSource& Source : Sources)
+			{
+				Total.Frames += Source.Frames;
+				Total.PacketsSent += Source.PacketsSent;
+				Total.BytesSent += Source.BytesSent;
+				Total.PacketsDropped += Source.PacketsDropped;
+				Total.PacketsReordered += Source.PacketsReordered;
+				Total.PacketsDuplicated += Source.PacketsDuplicated;
+				Total.SocketErrors += Source.SocketErrors;
+			}
+
+			const double Elapsed = FMath::Max(Now - StartTime, 0.001);
+			UE_LOG(LogPSN, Display, TEXT("PSN Load %s %.0f s: %d sources x %d trackers, %llu frames (%.1f/s), %llu packets (%.1f/s, %.1f KB/s), %llu dropped, %llu reordered, %llu duplicated, %llu socket errors"),
+				bFinal ? TEXT("total") : TEXT("running"), Elapsed, Sources.Num(), Options.TrackersPerSource,
+				Total.Frames, Total.Frames / Elapsed, Total.PacketsSent, Total.PacketsSent / Elapsed, Total.BytesSent / Elapsed / 1024.0,
+				Total.PacketsDropped, Total.PacketsReordered, Total.PacketsDuplicated, Total.SocketErrors);
+		}
+
+	private:
+
+		void SendFrame(FSource& Source, double Now)
+		{
+			const float Time = (float)(Now - StartTime);
+			const float DeltaTime = FMath::Max((float)(Now - Source.LastFrameTime), KINDA_SMALL_NUMBER);
+			const uint64 Timestamp = NowMicroseconds();
+			Source.LastFrameTime = Now;
+
+			int32 Index = 0;
+			for (auto& Pair : Source.Trackers)
+			{
+				::psn::tracker& Tracker = Pair.second;
+				const ::psn::float3 Previous = Tracker.get_pos();
+				const ::psn::float3 Position = MotionPosition(Options.Motion, Previous, Index++, Time, Source.Random);
+
+				Tracker.set_pos(Position);
+				Tracker.set_speed(::psn::float3((Position.x - Previous.x) / DeltaTime, (Position.y - Previous.y) / DeltaTime, (Position.z - Previous.z) / DeltaTime));
+				Tracker.set_timestamp(Timestamp);
+			}
+
+			SendPackets(Source, Source.Encoder->encode_data(Source.Trackers, Timestamp), true);
+			Source.Frames++;
+		}
+
+		void SendPackets(FSource& Source, const ::std::list< ::std::string >& Packets, bool bInjectFaults)
+		{
+			for (const ::std::string& Packet : Packets)
+			{
+				if (!bInjectFaults)
+				{
+					SendPacket(Source, Packet);
+					continue;
+				}
+
+				if (Source.Random.FRand() < Options.Loss)
+				{
+					Source.PacketsDropped++;
+					continue;
+				}
+
+				if (!Source.bHasHeldPacket && Source.Random.FRand() < Options.Reorder)
+				{
+					Source.HeldPacket = Packet;
+					Source.bHasHeldPacket = true;
+					Source.PacketsReordered++;
+					continue;
+				}
+
+				SendPacket(Source, Packet);
+
+				if (Source.Random.FRand() < Options.Duplicate)
+				{
+					SendPacket(Source, Packet);
+					Source.PacketsDuplicated++;
+				}
+
+				// A held packet may cross into the next frame, which a receiver sees as a late packet
+				if (Source.bHasHeldPacket)
+				{
+					SendPacket(Source, Source.HeldPacket);
+					Source.bHasHeldPacket = false;
+				}
+			}
+		}
+
+		void SendPacket(FSource& Source, const ::std::string& Packet)
+		{
+			int32 BytesSent = 0;
+			if (Source.Socket->SendTo((const uint8*)Packet.data(), (int32)Packet.size(), BytesSent, *Destination))
+			{
+				Source.PacketsSent++;
+				Source.BytesSent += BytesSent;
+			}
+			else
+			{
+				Source.SocketErrors++;
+			}
+		}
+
+		const FOptions Options;
+		TSharedPtr<FInternetAddr> Destination;
+		TArray<FSource> Sources;
+		double StartTime = 0.0;
+	};
+}
+
+UPSNLoadCommandlet::UPSNLoadCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UPSNLoadCommandlet::Main(const FString& Params)
+{
+	const PSNLoad::FOptions Options = PSNLoad::ParseOptions(Params);
+
+	UE_LOG(LogPSN, Display, TEXT("PSN Load: %d sources x %d trackers to %s:%d, loss %.3f, reorder %.3f, duplicate %.3f, seed %d"),
+		Options.SourceCount, Options.TrackersPerSource, *Options.Address, Options.Port, Options.Loss, Options.Reorder, Options.Duplicate, Options.Seed);
+
+	// Optional in process receiver, its counters are printed with each report
+	TUniquePtr<FPSNStandaloneGameInstance> Game;
+	UPSNReceiverSubsystem* Receiver = nullptr;
+	if (Options.bReceive)
+	{
+		Game = MakeUnique<FPSNStandaloneGameInstance>();
+		Receiver = Game->GetSubsystem<UPSNReceiverSubsystem>();
+		if (Receiver)
+		{
+			Receiver->StartPSNReceiver(TEXT("PSN Load Receiver"), Options.Address, Options.Port, true, true);
+		}
+	}
+
+	int32 Result = 0;
+	{
+		PSNLoad::FLoadGenerator Generator(Options);
+		double Now = FPlatformTime::Seconds();
+		if (Generator.Initialize(Now))
+		{
+			const double EndTime = Now + Options.Duration;
+			double NextReport = Now + Options.ReportInterval;
+
+			while (!IsEngineExitRequested() && (Options.Duration <= 0.f || Now < EndTime))
+			{
+				Generator.Tick(Now);
+
+				if (Receiver)
+				{
+					FTaskGraphInterface::Get().ProcessThreadUntilIdle(ENamedThreads::GameThread);
+				}
+
+				if (Now >= NextReport)
+				{
+					Generator.Report(Now, false);
+					if (Receiver)
+					{
+						// The core ticker that rolls the receive rates does not run in a commandlet
+						Receiver->GetStats().Publish();
+						Receiver->GetStats().Dump(*GLog);
+					}
+					NextReport += Options.ReportInterval;
+				}
+
+				FPlatformProcess::Sleep(0.0001f);
+				Now = FPlatformTime::Seconds();
+			}
+
+			Generator.Report(Now, true);
+		}
+		else
+		{
+			Result = 1;
+		}
+	}
+
+	if (Receiver)
+	{
+		Receiver->StopReceiver();
+		FTaskGraphInterface::Get().ProcessThreadUntilIdle(ENamedThreads::GameThread);
+		Receiver->GetStats().Dump(*GLog);
+	}
+	Game.Reset();
+
+	return Result;
+}
@@ -0,0 +1,269 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+
+#include "Commandlets/PSNSoakCommandlet.h"
+#include "PosiStageNet.h"
+#include "PSNReceiverSubsystem.h"
+#include "Tests/PSNTestHarness.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "HAL/PlatformMemory.h"
+#include "HAL/PlatformProcess.h"
+#include "CoreGlobals.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
+
+namespace PSNSoak
+{
+	static uint64 ToMicroseconds(double Seconds)
+	{
+		return (uint64)(Seconds * 1e6);
+	}
+
+	static double ToMegabytes(uint64 Bytes)
+	{
+		return (double)Bytes / (1024.0 * 1024.0);
+	}
+}
+
+UPSNSoakCommandlet::UPSNSoakCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+void UPSNSoakCommandlet::FLatencyHistogram::Reset()
+{
+	Buckets.Reset();
+	Buckets.AddZeroed(NumBuckets + 1);
+	Count = 0;
+	MaxMicroseconds = 0.0;
+}
+
+void UPSNSoakCommandlet::FLatencyHistogram::Add(double Microseconds)
+{
+	const int32 Bucket = FMath::Clamp((int32)(Microseconds / BucketMicroseconds), 0, NumBuckets);
+	Buckets[Bucket]++;
+	Count++;
+	MaxMicroseconds = FMath::Max(MaxMicroseconds, Microseconds);
+}
+
+double UPSNSoakCommandlet::FLatencyHistogram::Percentile(double Fraction) const
+{
+	if (Count == 0)
+	{
+		return 0.0;
+	}
+
+	const uint64 Target = FMath::Max<uint64>(1, (uint64)FMath::CeilToDouble(Fraction * Count));
+	uint64 Seen = 0;
+	for (int32 Bucket = 0; Bucket < NumBuckets; Bucket++)
+	{
+		Seen += Buckets[Bucket];
+		if (Seen >= Target)
+		{
+			return (Bucket + 0.5) * BucketMicroseconds;
+		}
+	}
+
+	// Falls in the overflow bucket
+	return MaxMicroseconds;
+}
+
+int32 UPSNSoakCommandlet::Main(const FString& Params)
+{
+	FString Role = TEXT("both");
+	FString Address = TEXT("236.10.10.10");
+	int32 Port = 56600;
+	float Rate = 60.f;
+	float Duration = 3600.f;
+	float ReportInterval = 60.f;
+	float LateMs = 10.f;
+
+	FParse::Value(*Params, TEXT("role="), Role);
+	FParse::Value(*Params, TEXT("address="), Address);
+	FParse::Value(*Params, TEXT("port="), Port);
+	FParse::Value(*Params, TEXT("trackers="), TrackerCount);
+	FParse::Value(*Params, TEXT("rate="), Rate);
+	FParse::Value(*Params, TEXT("duration="), Duration);
+	FParse::Value(*Params, TEXT("report="), ReportInterval);
+	FParse::Value(*Params, TEXT("latems="), LateMs);
+	FParse::Value(*Params, TEXT("csv="), CsvPath);
+
+	bSend = Role != TEXT("receiver");
+	bReceive = Role != TEXT("sender");
+	TrackerCount = FMath::Clamp(TrackerCount, 1, 65535);
+	FrameRate = FMath::Max(Rate, 1.f);
+	LateMilliseconds = LateMs;
+	ReportInterval = FMath::Max(ReportInterval, 1.f);
+
+	UE_LOG(LogPSN, Display, TEXT("PSN Soak: role %s, %s:%d, %d trackers at %.1f Hz for %.0f s (0 = until exit)"), *Role, *Address, Port, TrackerCount, FrameRate, Duration);
+
+	TUniquePtr<FPSNStandaloneGameInstance> Game;
+	if (bReceive)
+	{
+		Game = MakeUnique<FPSNStandaloneGameInstance>();
+		Receiver = Game->GetSubsystem<UPSNReceiverSubsystem>();
+		if (!Receiver)
+		{
+			UE_LOG(LogPSN, Error, TEXT("PSN Soak: failed to create the receiver subsystem"));
+			return 1;
+		}
+		Receiver->OnPSNDataPacketReceived.AddDynamic(this, &UPSNSoakCommandlet::OnTrackerReceived);
+		Receiver->StartPSNReceiver(TEXT("PSN Soak Receiver"), Address, Port, true, true);
+	}
+
+	if (bSend)
+	{
+		SenderProxy = MakeUnique<FPSNSenderProxy>(TEXT("PSN Soak Sender"), SenderStats);
+		if (!SenderProxy->SetSendIPAddress(Address, Port))
+		{
+			return 1;
+		}
+
+		for (int32 ID = 1; ID <= TrackerCount; ID++)
+		{
+			Trackers.Add(FPSNTracker(FPSNTrackerInfo(ID, FString::Printf(TEXT("Soak_%d"), ID))));
+		}
+	}
+
+	StartTime = FPlatformTime::Seconds();
+	StartUsedPhysical = FPlatformMemory::GetStats().UsedPhysical;
+
+	const double FrameInterval = 1.0 / FrameRate;
+	double NextFrame = StartTime;
+	double NextInfo = StartTime;
+	double NextReport = StartTime + ReportInterval;
+
+	while (!IsEngineExitRequested())
+	{
+		const double Now = FPlatformTime::Seconds();
+		if (Duration > 0.f && Now - StartTime >= Duration)
+		{
+			break;
+		}
+
+		if (bSend && Now >= NextInfo)
+		{
+			SenderProxy->SendPSNInfo(Trackers, PSNSoak::ToMicroseconds(Now));
+			NextInfo += 1.0;
+		}
+
+		if (bSend && Now >= NextFrame)
+		{
+			SendFrame(Now);
+
+			// After a stall keep the rate rather than bursting to catch up
+			NextFrame = FMath::Max(NextFrame + FrameInterval, Now);
+		}
+
+		// Runs the receiver's game thread dispatch
+		FTaskGraphInterface::Get().ProcessThreadUntilIdle(ENamedThreads::GameThread);
+
+		if (Now >= NextReport)
+		{
+			Report(Now, false);
+			NextReport += ReportInterval;
+		}
+
+		FPlatformProcess::Sleep(0.0002f);
+	}
+
+	Report(FPlatformTime::Seconds(), true);
+
+	if (SenderProxy)
+	{
+		SenderProxy->Stop();
+	}
+
+	Game.Reset();
+	Receiver = nullptr;
+
+	return 0;
+}
+
+void UPSNSoakCommandlet::SendFrame(double Now)
+{
+	const uint64 Timestamp = PSNSoak::ToMicroseconds(Now);
+	const float Angle = (float)(Now - StartTime);
+
+	// Trackers circle the origin so every frame carries fresh data
+	for (int32 Index = 0; Index < Trackers.Num(); Index++)
+	{
+		FPSNTracker& Tracker = Trackers[Index];
+		const float Phase = Angle + Index * 0.1f;
+		Tracker.Data.Position = FVector(FMath::Cos(Phase) * 5.f, FMath::Sin(Phase) * 5.f, 1.5f);
+		Tracker.Data.Status = 1.f;
+		Tracker.Header.Timestamp = Timestamp;
+	}
+
+	SenderProxy->SendPSNData(Trackers, Timestamp);
+	FramesSent++;
+}
+
+void UPSNSoakCommandlet::OnTrackerReceived(const FPSNTracker& Tracker)
+{
+	// One latency sample per frame, taken from its first tracker
+	const int32 FrameID = Tracker.Header.FrameID;
+	if (FrameID == LastFrameID)
+	{
+		return;
+	}
+
+	if (LastFrameID != INDEX_NONE)
+	{
+		// 8 bit frame IDs: a forward distance of half the range or more is an older frame arriving late
+		const uint8 Distance = (uint8)(FrameID - LastFrameID);
+		if (Distance >= 128)
+		{
+			FramesOutOfOrder++;
+			return;
+		}
+		FramesLost += Distance - 1;
+	}
+	LastFrameID = FrameID;
+	FramesReceived++;
+
+	const double LatencyMicroseconds = FPlatformTime::Seconds() * 1e6 - (double)Tracker.Header.Timestamp;
+	IntervalLatency.Add(LatencyMicroseconds);
+	TotalLatency.Add(LatencyMicroseconds);
+
+	if (LatencyMicroseconds > LateMilliseconds * 1000.0)
+	{
+		FramesOverLatency++;
+	}
+}
+
+void UPSNSoakCommandlet::Report(double Now, bool bFinal)
+{
+	const double Elapsed = Now - StartTime;
+	const uint64 UsedPhysical = FPlatformMemory::GetStats().UsedPhysical;
+	const double GrowthMB = PSNSoak::ToMegabytes(UsedPhysical) - PSNSoak::ToMegabytes(StartUsedPhysical);
+	const double GrowthPerHourMB = Elapsed > 0.0 ? GrowthMB * 3600.0 / Elapsed : 0.0;
+
+	const FLatencyHistogram& Latency = bFinal ? TotalLatency : IntervalLatency;
+
+	UE_LOG(LogPSN, Display, TEXT("PSN Soak %s %.0f s: sent %llu, received %llu, lost %llu, out of order %llu, over %.1f ms %llu | latency ms p50 %.3f p99 %.3f p99.9 %.3f max %.3f | memory %.1f MB (%+.1f MB, %+.2f MB/h)"),
+		bFinal ? TEXT("total") : TEXT("interval"), Elapsed, FramesSent, FramesReceived, FramesLost, FramesOutOfOrder, LateMilliseconds, FramesOverLatency,
+		Latency.Percentile(0.5) / 1000.0, Latency.Percentile(0.99) / 1000.0, Latency.Percentile(0.999) / 1000.0, Latency.MaxMicroseconds / 1000.0,
+		PSNSoak::ToMegabytes(UsedPhysical), GrowthMB, GrowthPerHourMB);
+
+	if (!CsvPath.IsEmpty())
+	{
+		FString Line;
+		if (!FPaths::FileExists(CsvPath))
+		{
+			Line += TEXT("elapsed_s,final,frames_sent,frames_received,frames_lost,frames_out_of_order,frames_over_latency,p50_ms,p99_ms,p999_ms,max_ms,used_physical_mb,growth_mb_per_hour\n");
+		}
+		Line += FString::Printf(TEXT("%.1f,%d,%llu,%llu,%llu,%llu,%llu,%.4f,%.4f,%.4f,%.4f,%.2f,%.3f\n"),
+			Elapsed, bFinal ? 1 : 0, FramesSent, FramesReceived, FramesLost, FramesOutOfOrder, FramesOverLatency,
+			Latency.Percentile(0.5) / 1000.0, Latency.Percentile(0.99) / 1000.0, Latency.Percentile(0.999) / 1000.0, Latency.MaxMicroseconds / 1000.0,
+			PSNSoak::ToMegabytes(UsedPhysical), GrowthPerHourMB);
+		FFileHelper::SaveStringToFile(Line, *CsvPath, FFileHelper::EEncodingOptions::AutoDetect, &IFileManager::Get(), FILEWRITE_Append);
+	}
+
+	IntervalLatency.Reset();
+}
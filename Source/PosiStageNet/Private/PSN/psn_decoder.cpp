@@ -24,12 +24,7 @@
 **/
 //::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
 
-#pragma once
-
-#ifndef PSN_DECODER_IMPL_HPP
-#define PSN_DECODER_IMPL_HPP
-
-#include "psn_decoder.hpp"
+#include "PSN/psn_decoder.hpp"
 #include <utility>
 
 //::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
@@ -213,7 +208,8 @@ psn_decoder::
 decode_data_tracker( packet_t packet , const chunk_header & header )
 {
     tracker & tracker = data_to_commit_.trackers[ header.id ] ;
-    tracker = ::psn::tracker( header.id , info_.tracker_names[ header.id ] ) ;
+    // Names stay in the info frame rather than being copied into every tracker of every data frame
+    tracker = ::psn::tracker( header.id ) ;
 
     return decode_children( packet , header ,
         [&]( packet_t packet , const chunk_header & child_header )
@@ -288,4 +284,3 @@ decode_children( packet_t packet , const chunk_header & header , const decode_ch
 
 } // namespace psn
 
-#endif
@@ -24,14 +24,7 @@
 **/
 //::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
 
-#pragma once
-
-#ifndef PSN_ENCODER_IMPL_HPP
-#define PSN_ENCODER_IMPL_HPP
-
-#include "CoreMinimal.h" // unreal type
-
-#include "psn_encoder.hpp"
+#include "PSN/psn_encoder.hpp"
 
 //::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
 namespace psn
@@ -72,7 +65,6 @@ encode_info( const tracker_map & trackers , uint64_t timestamp_usec )
         packet_count_offset = (char *)&packet_header->frame_packet_count - buffer ;
 
         // System name
-        //UE_LOG(LogTemp, Display, TEXT("Starting System Name Encode ( %s )"), *FString(system_name_.c_str()));
         if ( !fill_string( packet , INFO_SYSTEM_NAME , system_name_ ) )
             break ;
 
@@ -266,20 +258,18 @@ psn_encoder::
 fill_string( packet_t & packet , uint16_t id , const ::std::string & str )
 {
     // Chunk header
-    if (!fill_chunk_header(packet, id, false, str.length()))
+    if ( !fill_chunk_header( packet , id , false , str.length() ) )
     {
-        UE_LOG(LogTemp, Display, TEXT("Failed to encode! %i, %s"), id, *FString(str.c_str()));
-        return false;
+        log( log_level::info , ( "Failed to encode! " + ::std::to_string( id ) + ", " + str ).c_str() ) ;
+        return false ;
     }
-        
 
     // String
-    if (packet.size < str.length())
+    if ( packet.size < str.length() )
     {
-        UE_LOG(LogTemp, Display, TEXT("Failed to encode! %i, %s"), id, *FString(str.c_str()));
-        return false;
+        log( log_level::info , ( "Failed to encode! " + ::std::to_string( id ) + ", " + str ).c_str() ) ;
+        return false ;
     }
-       
 
     for (size_t i = 0; i < str.length(); ++i)
     {
@@ -293,5 +283,3 @@ fill_string( packet_t & packet , uint16_t id , const ::std::string & str )
 
 
 } // namespace psn
-
-#endif
@@ -0,0 +1,108 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+
+#include "PSNCoordinateSpace.h"
+#include "PosiStageNet.h"
+#include "PSNTrackerRecord.h"
+#include "Math/VectorRegister.h"
+
+FPSNCoordinateTransform::FPSNCoordinateTransform(float UnitScale)
+	: Matrix(FMatrix44f::Identity)
+	, DirectionMatrix(FMatrix44f::Identity)
+{
+	Matrix.M[0][0] = UnitScale;
+	Matrix.M[1][1] = UnitScale;
+	Matrix.M[2][2] = UnitScale;
+}
+
+FPSNCoordinateTransform FPSNCoordinateTransform::Inverse() const
+{
+	FPSNCoordinateTransform Result;
+	Result.Matrix = Matrix.Inverse();
+
+	// Rotation and axis swap only, so orthonormal and the inverse is the transpose
+	Result.DirectionMatrix = DirectionMatrix.GetTransposed();
+	Result.OrientationSign = OrientationSign;
+	return Result;
+}
+
+void FPSNCoordinateTransform::Apply(FPSNTrackerRecord* Trackers, int32 Num) const
+{
+	const VectorRegister4Float Sign = VectorSetFloat1(OrientationSign);
+
+	for (int32 Index = 0; Index < Num; Index++)
+	{
+		FPSNTrackerRecord& Tracker = Trackers[Index];
+
+		// Points pick up the offset, so an unset position must stay unset rather than land on it. Unset directions are zero and stay zero.
+		if (Tracker.HasField(EPSNTrackerField::Position))
+		{
+			VectorStoreFloat3(VectorTransformVector(VectorLoadFloat3_W1(&Tracker.Position.X), &Matrix), &Tracker.Position.X);
+		}
+		if (Tracker.HasField(EPSNTrackerField::TargetPosition))
+		{
+			VectorStoreFloat3(VectorTransformVector(VectorLoadFloat3_W1(&Tracker.TargetPosition.X), &Matrix), &Tracker.TargetPosition.X);
+		}
+		VectorStoreFloat3(VectorTransformVector(VectorLoadFloat3_W0(&Tracker.Speed.X), &DirectionMatrix), &Tracker.Speed.X);
+		VectorStoreFloat3(VectorTransformVector(VectorLoadFloat3_W0(&Tracker.Acceleration.X), &DirectionMatrix), &Tracker.Acceleration.X);
+		VectorStoreFloat3(VectorMultiply(VectorTransformVector(VectorLoadFloat3_W0(&Tracker.Orientation.X), &DirectionMatrix), Sign), &Tracker.Orientation.X);
+	}
+}
+
+namespace PSNCoordinateSpace
+{
+	static int32 AxisIndex(EPSNAxis Axis)
+	{
+		return (int32)Axis / 2;
+	}
+
+	static double AxisSign(EPSNAxis Axis)
+	{
+		return ((int32)Axis & 1) ? -1.0 : 1.0;
+	}
+}
+
+FPSNCoordinateTransform UPSNCoordinateSpace::MakeTransform() const
+{
+	EPSNAxis Axes[3] = { UnrealX, UnrealY, UnrealZ };
+	const int32 X = PSNCoordinateSpace::AxisIndex(UnrealX);
+	const int32 Y = PSNCoordinateSpace::AxisIndex(UnrealY);
+	const int32 Z = PSNCoordinateSpace::AxisIndex(UnrealZ);
+	if (X == Y || Y == Z || X == Z)
+	{
+		UE_LOG(LogPSN, Warning, TEXT("PSN coordinate space '%s' uses a PSN axis twice, the axes are left unswapped."), *GetName());
+		Axes[0] = EPSNAxis::PSN_X;
+		Axes[1] = EPSNAxis::PSN_Y;
+		Axes[2] = EPSNAxis::PSN_Z;
+	}
+
+	FVector SafeScale = Scale;
+	for (int32 Axis = 0; Axis < 3; Axis++)
+	{
+		if (FMath::IsNearlyZero(SafeScale[Axis]))
+		{
+			UE_LOG(LogPSN, Warning, TEXT("PSN coordinate space '%s' has a zero scale, which cannot be inverted. Using 1."), *GetName());
+			SafeScale[Axis] = 1.0;
+		}
+	}
+
+	// Each row is where a PSN axis lands in Unreal
+	FMatrix Swap(FMatrix::Identity);
+	for (int32 Row = 0; Row < 3; Row++)
+	{
+		for (int32 Column = 0; Column < 3; Column++)
+		{
+			Swap.M[Row][Column] = PSNCoordinateSpace::AxisIndex(Axes[Column]) == Row ? PSNCoordinateSpace::AxisSign(Axes[Column]) : 0.0;
+		}
+	}
+
+	// A negative scale mirrors that axis, so directions flip with positions even though they are not scaled
+	const FMatrix Mirror = FScaleMatrix(FVector(FMath::Sign(SafeScale.X), FMath::Sign(SafeScale.Y), FMath::Sign(SafeScale.Z)));
+	const FMatrix RotationMatrix = FRotationMatrix(Rotation);
+
+	FPSNCoordinateTransform Result;
+	Result.Matrix = FMatrix44f(Swap * FScaleMatrix(SafeScale * 100.0) * RotationMatrix * FTranslationMatrix(Offset));
+	Result.DirectionMatrix = FMatrix44f(Swap * Mirror * RotationMatrix);
+	Result.OrientationSign = (float)(Swap * Mirror).Determinant();
+	return Result;
+}
@@ -0,0 +1,93 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+
+#include "PSNFrameSequence.h"
+
+FPSNFrameSequenceResult FPSNFrameSequence::Push(uint8 FrameID, uint8 FramePacketCount, double Now)
+{
+	FPSNFrameSequenceResult Result;
+
+	const bool bResync = !bStarted || Now - LastPacketTime > ResyncSeconds;
+	LastPacketTime = Now;
+	if (bResync)
+	{
+		Resync(FrameID, FramePacketCount);
+		Result.bNewFrame = true;
+		return Result;
+	}
+
+	const int32 Delta = (int8)(uint8)(FrameID - CurrentFrameID);
+	if (Delta == 0)
+	{
+		if (ReceivedPackets >= ExpectedPackets)
+		{
+			Result.bAccept = false;
+			Result.bDuplicate = true;
+		}
+		else
+		{
+			ReceivedPackets++;
+		}
+	}
+	else if (Delta > 0)
+	{
+		Result.bNewFrame = true;
+		Result.FramesLost = Delta - 1;
+		Result.bPreviousPartial = ReceivedPackets < ExpectedPackets;
+		const uint64 Complete = CompleteFrames | (Result.bPreviousPartial ? 0 : 1);
+		ReceivedFrames = (Delta < 64 ? ReceivedFrames << Delta : 0) | 1;
+		CompleteFrames = Delta < 64 ? Complete << Delta : 0;
+		FramesSinceSync = FMath::Min(FramesSinceSync + Delta, 64);
+		StartFrame(FrameID, FramePacketCount);
+	}
+	else
+	{
+		const int32 Age = -Delta;
+		if (Age >= 64)
+		{
+			// Too far back to be a late packet, so the source has most likely restarted its IDs
+			Resync(FrameID, FramePacketCount);
+			Result.bNewFrame = true;
+			return Result;
+		}
+
+		// Older than the newest frame, so dropped either way. Frames from before the sync were never counted, so they are
+		// only late. Otherwise the first packet of a missing frame is reordered, and another packet of a complete frame a repeat.
+		Result.bAccept = false;
+		const uint64 Bit = 1ull << Age;
+		if (Age < FramesSinceSync)
+		{
+			if ((ReceivedFrames & Bit) == 0)
+			{
+				ReceivedFrames |= Bit;
+				if (FramePacketCount <= 1)
+				{
+					CompleteFrames |= Bit;
+				}
+				Result.bReordered = true;
+			}
+			else if ((CompleteFrames & Bit) != 0)
+			{
+				Result.bDuplicate = true;
+			}
+		}
+	}
+
+	return Result;
+}
+
+void FPSNFrameSequence::Resync(uint8 FrameID, uint8 FramePacketCount)
+{
+	StartFrame(FrameID, FramePacketCount);
+	FramesSinceSync = 1;
+	ReceivedFrames = 1;
+	CompleteFrames = 0;
+}
+
+void FPSNFrameSequence::StartFrame(uint8 FrameID, uint8 FramePacketCount)
+{
+	bStarted = true;
+	CurrentFrameID = FrameID;
+	ExpectedPackets = FMath::Max<uint8>(FramePacketCount, 1);
+	ReceivedPackets = 1;
+}
@@ -0,0 +1,344 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+
+#include "PSNHealthEndpoint.h"
+#include "PosiStageNet.h"
+#include "PSNStats.h"
+#include "Common/TcpSocketBuilder.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/Thread.h"
+#include "Interfaces/IPv4/IPv4Address.h"
+#include "Policies/CondensedJsonPrintPolicy.h"
+#include "Serialization/JsonWriter.h"
+#include "Sockets.h"
+#include "SocketSubsystem.h"
+
+namespace PSNHealthEndpoint
+{
+	static int32 Port = 0;
+
+	int32 GetConfiguredPort()
+	{
+		return Port;
+	}
+
+	static void OnPortChanged(IConsoleVariable* Var)
+	{
+		if (Port > 0)
+		{
+			FPSNHealthEndpoint::Get().Start(Port);
+		}
+		else
+		{
+			FPSNHealthEndpoint::Get().Stop();
+		}
+	}
+
+	static FAutoConsoleVariableRef CVarPort(
+		TEXT("psn.HealthEndpointPort"),
+		Port,
+		TEXT("Port to serve PSN health JSON on at /psn/health. 0 disables the endpoint."),
+		FConsoleVariableDelegate::CreateStatic(&OnPortChanged));
+
+	// How often the server thread checks for Stop() while idle
+	static const FTimespan AcceptWait = FTimespan::FromMilliseconds(100);
+
+	// How long a client gets to send its request or take the response before the connection is dropped
+	static const FTimespan ClientTimeout = FTimespan::FromSeconds(2);
+
+	// Requests are a single line and a few headers, anything longer is not for us
+	static constexpr int32 MaxRequestBytes = 4096;
+
+	static bool SendAll(FSocket& Connection, const uint8* Data, int32 Size)
+	{
+		while (Size > 0)
+		{
+			int32 Sent = 0;
+			if (!Connection.Wait(ESocketWaitConditions::WaitForWrite, ClientTimeout) || !Connection.Send(Data, Size, Sent))
+			{
+				return false;
+			}
+			Data += Sent;
+			Size -= Sent;
+		}
+		return true;
+	}
+
+	static void SendResponse(FSocket& Connection, const TCHAR* Status, const FString& Body)
+	{
+		const FTCHARToUTF8 BodyUtf8(*Body);
+		const FString Header = FString::Printf(TEXT("HTTP/1.1 %s\r\nContent-Type: application/json\r\nContent-Length: %d\r\nCache-Control: no-store\r\nConnection: close\r\n\r\n"), Status, BodyUtf8.Length());
+		const FTCHARToUTF8 HeaderUtf8(*Header);
+
+		if (SendAll(Connection, (const uint8*)HeaderUtf8.Get(), HeaderUtf8.Length()))
+		{
+			SendAll(Connection, (const uint8*)BodyUtf8.Get(), BodyUtf8.Length());
+		}
+	}
+}
+
+FPSNHealthEndpoint& FPSNHealthEndpoint::Get()
+{
+	static FPSNHealthEndpoint Instance;
+	return Instance;
+}
+
+void FPSNHealthEndpoint::Start(int32 InPort)
+{
+	if (IsRunning())
+	{
+		if (Port == InPort)
+		{
+			return;
+		}
+		Stop();
+	}
+
+	Listener = FTcpSocketBuilder(TEXT("PSN Health Endpoint"))
+		.AsReusable()
+		.BoundToAddress(FIPv4Address(127, 0, 0, 1))
+		.BoundToPort(InPort)
+		.Listening(8);
+
+	if (!Listener)
+	{
+		UE_LOG(LogPSN, Error, TEXT("PSN health endpoint failed to listen on 127.0.0.1:%d."), InPort);
+		return;
+	}
+
+	Port = InPort;
+	bStopping = false;
+	Server = MakeUnique<FThread>(TEXT("PSNHealthEndpoint"), [this]() { ServeLoop(); });
+
+	UE_LOG(LogPSN, Display, TEXT("PSN health endpoint serving on http://127.0.0.1:%d/psn/health."), Port);
+}
+
+void FPSNHealthEndpoint::Stop()
+{
+	if (Server)
+	{
+		bStopping = true;
+		Server->Join();
+		Server.Reset();
+	}
+
+	if (Listener)
+	{
+		Listener->Close();
+		ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(Listener);
+		Listener = nullptr;
+		Port = 0;
+	}
+}
+
+void FPSNHealthEndpoint::ServeLoop()
+{
+	ISocketSubsystem* SocketSubsystem = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+
+	while (!bStopping)
+	{
+		bool bPending = false;
+		if (!Listener->WaitForPendingConnection(bPending, PSNHealthEndpoint::AcceptWait) || !bPending)
+		{
+			continue;
+		}
+
+		if (FSocket* Connection = Listener->Accept(TEXT("PSN Health Connection")))
+		{
+			HandleConnection(*Connection);
+			Connection->Close();
+			SocketSubsystem->DestroySocket(Connection);
+		}
+	}
+}
+
+void FPSNHealthEndpoint::HandleConnection(FSocket& Connection) const
+{
+	// Read until the end of the headers, the request has no body worth looking at
+	TArray<uint8> Request;
+	while (Request.Num() < PSNHealthEndpoint::MaxRequestBytes)
+	{
+		if (!Connection.Wait(ESocketWaitConditions::WaitForRead, PSNHealthEndpoint::ClientTimeout))
+		{
+			return;
+		}
+
+		uint8 Buffer[1024];
+		int32 Read = 0;
+		if (!Connection.Recv(Buffer, sizeof(Buffer), Read) || Read == 0)
+		{
+			return;
+		}
+		Request.Append(Buffer, Read);
+
+		const int32 Num = Request.Num();
+		if (Num >= 4 && Request[Num - 4] == '\r' && Request[Num - 3] == '\n' && Request[Num - 2] == '\r' && Request[Num - 1] == '\n')
+		{
+			break;
+		}
+	}
+
+	const FString RequestText(Request.Num(), (const ANSICHAR*)Request.GetData());
+	FString RequestLine;
+	if (!RequestText.Split(TEXT("\r\n"), &RequestLine, nullptr))
+	{
+		RequestLine = RequestText;
+	}
+
+	TArray<FString> Parts;
+	RequestLine.ParseIntoArray(Parts, TEXT(" "));
+	if (Parts.Num() < 2 || Parts[0] != TEXT("GET"))
+	{
+		PSNHealthEndpoint::SendResponse(Connection, TEXT("405 Method Not Allowed"), TEXT("{\"error\":\"method not allowed\"}"));
+	}
+	else if (Parts[1] != TEXT("/psn/health"))
+	{
+		PSNHealthEndpoint::SendResponse(Connection, TEXT("404 Not Found"), TEXT("{\"error\":\"not found\"}"));
+	}
+	else
+	{
+		PSNHealthEndpoint::SendResponse(Connection, TEXT("200 OK"), BuildJson());
+	}
+}
+
+void FPSNHealthEndpoint::RegisterReceiver(const FString& Name, const FPSNReceiverStats* Stats)
+{
+	FScopeLock Lock(&RegistrationLock);
+	Receivers.RemoveAll([Stats](const TPair<FString, const FPSNReceiverStats*>& Pair) { return Pair.Value == Stats; });
+	Receivers.Emplace(Name, Stats);
+}
+
+void FPSNHealthEndpoint::UnregisterReceiver(const FPSNReceiverStats* Stats)
+{
+	FScopeLock Lock(&RegistrationLock);
+	Receivers.RemoveAll([Stats](const TPair<FString, const FPSNReceiverStats*>& Pair) { return Pair.Value == Stats; });
+}
+
+void FPSNHealthEndpoint::RegisterSender(const FString& Name, const FPSNSenderStats* Stats)
+{
+	FScopeLock Lock(&RegistrationLock);
+	Senders.RemoveAll([Stats](const TPair<FString, const FPSNSenderStats*>& Pair) { return Pair.Value == Stats; });
+	Senders.Emplace(Name, Stats);
+}
+
+void FPSNHealthEndpoint::UnregisterSender(const FPSNSenderStats* Stats)
+{
+	FScopeLock Lock(&RegistrationLock);
+	Senders.RemoveAll([Stats](const TPair<FString, const FPSNSenderStats*>& Pair) { return Pair.Value == Stats; });
+}
+
+FString FPSNHealthEndpoint::BuildJson() const
+{
+	const double Now = FPlatformTime::Seconds();
+
+	FString Json;
+	TSharedRef<TJsonWriter<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>> Writer = TJsonWriterFactory<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>::Create(&Json);
+
+	// Reused for every source, filled from the table the socket thread keeps
+	TArray<TPair<uint16, double>> Trackers;
+
+	FScopeLock Lock(&RegistrationLock);
+
+	Writer->WriteObjectStart();
+
+	Writer->WriteArrayStart(TEXT("receivers"));
+	for (const TPair<FString, const FPSNReceiverStats*>& Pair : Receivers)
+	{
+		const FPSNReceiverStats& Stats = *Pair.Value;
+
+		Writer->WriteObjectStart();
+		Writer->WriteValue(TEXT("name"), Pair.Key);
+		Writer->WriteValue(TEXT("packetsReceived"), (double)Stats.PacketsReceived.load());
+		Writer->WriteValue(TEXT("packetsPerSecond"), Stats.PacketsPerSecond.load());
+		Writer->WriteValue(TEXT("bytesPerSecond"), Stats.BytesPerSecond.load());
+		Writer->WriteValue(TEXT("decodeErrors"), (double)Stats.DecodeErrors.load());
+		Writer->WriteValue(TEXT("framesCompleted"), (double)Stats.FramesCompleted.load());
+		Writer->WriteValue(TEXT("framesDropped"), (double)Stats.FramesDropped.load());
+		Writer->WriteValue(TEXT("framesPartial"), (double)Stats.FramesPartial.load());
+		Writer->WriteValue(TEXT("framesReordered"), (double)Stats.FramesReordered.load());
+		Writer->WriteValue(TEXT("packetsDuplicated"), (double)Stats.PacketsDuplicated.load());
+		Writer->WriteValue(TEXT("packetsLate"), (double)Stats.PacketsLate.load());
+		Writer->WriteValue(TEXT("packetsRedundant"), (double)Stats.PacketsRedundant.load());
+		Writer->WriteValue(TEXT("trackersSuppressed"), (double)Stats.TrackersSuppressed.load());
+		Writer->WriteValue(TEXT("trackerIdConflicts"), (double)Stats.TrackerIDConflicts.load());
+		Writer->WriteValue(TEXT("queueDepth"), Stats.QueueDepth.load());
+		Writer->WriteValue(TEXT("dispatchLatencyMs"), Stats.LastDispatchLatencyMs.load());
+
+		Writer->WriteArrayStart(TEXT("sources"));
+		for (int32 Index = 0; Index < FPSNReceiverStats::MaxSources; Index++)
+		{
+			const FPSNSourceStats& Source = Stats.GetSources()[Index];
+			if (const uint32 Address = Source.Address.load())
+			{
+				Writer->WriteObjectStart();
+				Writer->WriteValue(TEXT("address"), FIPv4Address(Address).ToString());
+				Writer->WriteValue(TEXT("packetsPerSecond"), Source.PacketsPerSecond.load());
+				Writer->WriteValue(TEXT("lastFrameId"), Source.LastFrameID.load());
+				Writer->WriteValue(TEXT("decodeErrors"), (double)Source.DecodeErrors.load());
+				Writer->WriteValue(TEXT("framesLost"), (double)Source.FramesLost.load());
+				Writer->WriteValue(TEXT("framesPartial"), (double)Source.FramesPartial.load());
+				Writer->WriteValue(TEXT("framesReordered"), (double)Source.FramesReordered.load());
+				Writer->WriteValue(TEXT("packetsDuplicated"), (double)Source.PacketsDuplicated.load());
+				Writer->WriteValue(TEXT("packetsLate"), (double)Source.PacketsLate.load());
+				Writer->WriteValue(TEXT("packetsRedundant"), (double)Source.PacketsRedundant.load());
+				Writer->WriteValue(TEXT("secondsSinceLastPacket"), Now - Source.LastReceiveTime.load());
+				Writer->WriteValue(TEXT("trackersNotListed"), (double)Source.TrackersNotListed.load());
+
+				Source.GetTrackersReceived(Trackers);
+				Writer->WriteArrayStart(TEXT("trackers"));
+				for (const TPair<uint16, double>& Tracker : Trackers)
+				{
+					Writer->WriteObjectStart();
+					Writer->WriteValue(TEXT("id"), (int32)Tracker.Key);
+					Writer->WriteValue(TEXT("staleness"), Now - Tracker.Value);
+					Writer->WriteObjectEnd();
+				}
+				Writer->WriteArrayEnd();
+
+				Writer->WriteObjectEnd();
+			}
+		}
+		Writer->WriteArrayEnd();
+
+		Writer->WriteObjectEnd();
+	}
+	Writer->WriteArrayEnd();
+
+	Writer->WriteArrayStart(TEXT("senders"));
+	for (const TPair<FString, const FPSNSenderStats*>& Pair : Senders)
+	{
+		const FPSNSenderStats& Stats = *Pair.Value;
+
+		Writer->WriteObjectStart();
+		Writer->WriteValue(TEXT("name"), Pair.Key);
+		Writer->WriteValue(TEXT("framesSent"), (double)Stats.FramesSent.load());
+		Writer->WriteValue(TEXT("framesPerSecond"), Stats.FramesPerSecond.load());
+		Writer->WriteValue(TEXT("bytesPerSecond"), Stats.BytesPerSecond.load());
+		Writer->WriteValue(TEXT("packetsPerFrame"), (int32)Stats.LastPacketsPerFrame.load());
+		Writer->WriteValue(TEXT("socketErrors"), (double)Stats.SocketErrors.load());
+		Writer->WriteValue(TEXT("framesSuperseded"), (double)Stats.FramesSuperseded.load());
+
+		Writer->WriteArrayStart(TEXT("interfaces"));
+		for (const FPSNSendInterfaceStats& Interface : Stats.Interfaces)
+		{
+			if (!Interface.bActive)
+			{
+				continue;
+			}
+			Writer->WriteObjectStart();
+			Writer->WriteValue(TEXT("address"), FIPv4Address(Interface.Address.load()).ToString());
+			Writer->WriteValue(TEXT("healthy"), Interface.bHealthy.load());
+			Writer->WriteValue(TEXT("packetsSent"), (double)Interface.PacketsSent.load());
+			Writer->WriteValue(TEXT("socketErrors"), (double)Interface.SocketErrors.load());
+			Writer->WriteObjectEnd();
+		}
+		Writer->WriteArrayEnd();
+		Writer->WriteObjectEnd();
+	}
+	Writer->WriteArrayEnd();
+
+	Writer->WriteObjectEnd();
+	Writer->Close();
+
+	return Json;
+}
@@ -0,0 +1,65 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+
+struct FPSNReceiverStats;
+struct FPSNSenderStats;
+class FSocket;
+class FThread;
+
+/*
+* Optional HTTP endpoint serving PSN health as JSON on GET /psn/health.
+* Enabled by setting psn.HealthEndpointPort to a non zero port. Listens on 127.0.0.1 only, and answers
+* on its own thread so requests are served even while the game thread is stalled.
+* Requests only read the counters in FPSNReceiverStats and FPSNSenderStats, never subsystem state.
+*/
+class FPSNHealthEndpoint
+{
+public:
+
+	static FPSNHealthEndpoint& Get();
+
+	// Start serving on the given port, restarting if already running on another port
+	void Start(int32 InPort);
+
+	// Stop serving and close the port
+	void Stop();
+
+	bool IsRunning() const { return Listener != nullptr; }
+
+	// Receivers and senders register the counters they own for the lifetime of their proxy
+	void RegisterReceiver(const FString& Name, const FPSNReceiverStats* Stats);
+	void UnregisterReceiver(const FPSNReceiverStats* Stats);
+	void RegisterSender(const FString& Name, const FPSNSenderStats* Stats);
+	void UnregisterSender(const FPSNSenderStats* Stats);
+
+	// Current health of every registered receiver and sender
+	FString BuildJson() const;
+
+private:
+
+	// Accept and answer connections until stopped. Server thread.
+	void ServeLoop();
+
+	// Read one request from the connection and write the response
+	void HandleConnection(FSocket& Connection) const;
+
+	mutable FCriticalSection RegistrationLock;
+
+	TArray<TPair<FString, const FPSNReceiverStats*>> Receivers;
+	TArray<TPair<FString, const FPSNSenderStats*>> Senders;
+
+	FSocket* Listener = nullptr;
+	TUniquePtr<FThread> Server;
+	std::atomic<bool> bStopping{ false };
+	int32 Port = 0;
+};
+
+namespace PSNHealthEndpoint
+{
+	// Value of psn.HealthEndpointPort
+	int32 GetConfiguredPort();
+}
@@ -0,0 +1,101 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+
+#include "PSNIDAllocator.h"
+
+FPSNIDAllocator::FPSNIDAllocator()
+{
+	Reset();
+}
+
+bool FPSNIDAllocator::IsAllocated(int32 ID) const
+{
+	if (ID < 0 || ID >= NumIDs)
+	{
+		return false;
+	}
+	return (Words[ID >> 6] & (1ull << (ID & 63))) != 0;
+}
+
+bool FPSNIDAllocator::Allocate(int32 ID)
+{
+	if (ID < 0 || ID >= NumIDs || IsAllocated(ID))
+	{
+		return false;
+	}
+
+	const int32 Word = ID >> 6;
+	Words[Word] |= 1ull << (ID & 63);
+	if (Words[Word] == ~0ull)
+	{
+		FullWords[Word >> 6] |= 1ull << (Word & 63);
+	}
+	NumAllocated++;
+	return true;
+}
+
+int32 FPSNIDAllocator::AllocateFirstFree(int32 StartFrom)
+{
+	const int32 ID = FindFirstFree(StartFrom);
+	if (ID != INDEX_NONE)
+	{
+		Allocate(ID);
+	}
+	return ID;
+}
+
+int32 FPSNIDAllocator::FindFirstFree(int32 StartFrom) const
+{
+	StartFrom = FMath::Max(StartFrom, 0);
+	if (StartFrom >= NumIDs)
+	{
+		return INDEX_NONE;
+	}
+
+	// Rest of the word holding StartFrom
+	const int32 StartWord = StartFrom >> 6;
+	const uint64 FreeInStartWord = ~Words[StartWord] & (~0ull << (StartFrom & 63));
+	if (FreeInStartWord)
+	{
+		return (StartWord << 6) + (int32)FMath::CountTrailingZeros64(FreeInStartWord);
+	}
+
+	// Then the first word that is not full, found through the summary
+	const int32 NextWord = StartWord + 1;
+	for (int32 Summary = NextWord >> 6; Summary < NumSummaryWords; Summary++)
+	{
+		uint64 NotFull = ~FullWords[Summary];
+		if (Summary == NextWord >> 6)
+		{
+			NotFull &= ~0ull << (NextWord & 63);
+		}
+
+		if (NotFull)
+		{
+			const int32 Word = (Summary << 6) + (int32)FMath::CountTrailingZeros64(NotFull);
+			return (Word << 6) + (int32)FMath::CountTrailingZeros64(~Words[Word]);
+		}
+	}
+
+	return INDEX_NONE;
+}
+
+void FPSNIDAllocator::Free(int32 ID)
+{
+	if (!IsAllocated(ID))
+	{
+		return;
+	}
+
+	const int32 Word = ID >> 6;
+	Words[Word] &= ~(1ull << (ID & 63));
+	FullWords[Word >> 6] &= ~(1ull << (Word & 63));
+	NumAllocated--;
+}
+
+void FPSNIDAllocator::Reset()
+{
+	FMemory::Memzero(Words);
+	FMemory::Memzero(FullWords);
+	NumAllocated = 0;
+}
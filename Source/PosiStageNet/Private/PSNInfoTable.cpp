@@ -0,0 +1,53 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+
+#include "PSNInfoTable.h"
+
+void FPSNInfoTable::SetSource(uint32 SourceAddress, FPSNSourceInfo&& Info, TArray<FPSNTrackerInfo>& OutChanged)
+{
+	FPSNSourceInfo& Source = Sources.FindOrAdd(SourceAddress);
+
+	for (const TPair<int32, FString>& Name : Info.TrackerNames)
+	{
+		const FString* Previous = Source.TrackerNames.Find(Name.Key);
+		if (!Previous || *Previous != Name.Value || Source.SystemName != Info.SystemName)
+		{
+			OutChanged.Emplace(Name.Key, Name.Value, Info.SystemName);
+		}
+		Names.Add(Name.Key, Name.Value);
+	}
+
+	// Trackers this source no longer announces keep a name only if another source still has one for them
+	for (const TPair<int32, FString>& Name : Source.TrackerNames)
+	{
+		if (Info.TrackerNames.Contains(Name.Key))
+		{
+			continue;
+		}
+
+		Names.Remove(Name.Key);
+		for (const TPair<uint32, FPSNSourceInfo>& Other : Sources)
+		{
+			const FString* OtherName = Other.Key != SourceAddress ? Other.Value.TrackerNames.Find(Name.Key) : nullptr;
+			if (OtherName)
+			{
+				Names.Add(Name.Key, *OtherName);
+				break;
+			}
+		}
+	}
+
+	Source = MoveTemp(Info);
+}
+
+const FString* FPSNInfoTable::FindName(uint32 SourceAddress, int32 ID) const
+{
+	const FPSNSourceInfo* Source = Sources.Find(SourceAddress);
+	return Source ? Source->TrackerNames.Find(ID) : nullptr;
+}
+
+void FPSNInfoTable::Reset()
+{
+	Sources.Reset();
+	Names.Reset();
+}
@@ -0,0 +1,146 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+
+#include "PSNOrientation.h"
+#include "Math/VectorRegister.h"
+
+namespace PSNOrientation
+{
+	// Below this the angle is treated as zero and the small angle limits are used
+	static constexpr float SmallAngle = 1e-6f;
+
+	// Rows in, columns out. W of the rows may be anything.
+	FORCEINLINE void Transpose(const VectorRegister4Float& R0, const VectorRegister4Float& R1, const VectorRegister4Float& R2, const VectorRegister4Float& R3,
+		VectorRegister4Float& OutX, VectorRegister4Float& OutY, VectorRegister4Float& OutZ, VectorRegister4Float& OutW)
+	{
+		const VectorRegister4Float XY01 = VectorShuffle(R0, R1, 0, 1, 0, 1);
+		const VectorRegister4Float XY23 = VectorShuffle(R2, R3, 0, 1, 0, 1);
+		const VectorRegister4Float ZW01 = VectorShuffle(R0, R1, 2, 3, 2, 3);
+		const VectorRegister4Float ZW23 = VectorShuffle(R2, R3, 2, 3, 2, 3);
+		OutX = VectorShuffle(XY01, XY23, 0, 2, 0, 2);
+		OutY = VectorShuffle(XY01, XY23, 1, 3, 1, 3);
+		OutZ = VectorShuffle(ZW01, ZW23, 0, 2, 0, 2);
+		OutW = VectorShuffle(ZW01, ZW23, 1, 3, 1, 3);
+	}
+
+	// Length of each lane of (X, Y, Z), without dividing by zero
+	FORCEINLINE VectorRegister4Float Length3(const VectorRegister4Float& X, const VectorRegister4Float& Y, const VectorRegister4Float& Z)
+	{
+		const VectorRegister4Float LengthSq = VectorMultiplyAdd(X, X, VectorMultiplyAdd(Y, Y, VectorMultiply(Z, Z)));
+		return VectorMultiply(LengthSq, VectorReciprocalSqrtAccurate(VectorMax(LengthSq, VectorSetFloat1(SMALL_NUMBER))));
+	}
+
+	FORCEINLINE FVector3f* Advance(FVector3f* Ptr, int32 Stride)
+	{
+		return (FVector3f*)((uint8*)Ptr + Stride);
+	}
+
+	FORCEINLINE const FVector3f* Advance(const FVector3f* Ptr, int32 Stride)
+	{
+		return (const FVector3f*)((const uint8*)Ptr + Stride);
+	}
+
+	FQuat4f AxisAngleToQuat(const FVector3f& AxisAngle)
+	{
+		const float Angle = AxisAngle.Size();
+		float SinHalf, CosHalf;
+		FMath::SinCos(&SinHalf, &CosHalf, Angle * 0.5f);
+
+		// sin(a/2)/a tends to 1/2 as the angle goes to zero
+		const float Scale = Angle > SmallAngle ? SinHalf / Angle : 0.5f;
+		return FQuat4f(AxisAngle.X * Scale, AxisAngle.Y * Scale, AxisAngle.Z * Scale, CosHalf);
+	}
+
+	FVector3f QuatToAxisAngle(const FQuat4f& Quat)
+	{
+		// q and -q are the same rotation, pick the one with the shorter angle
+		const float Sign = Quat.W < 0.f ? -1.f : 1.f;
+		const FVector3f Axis(Quat.X * Sign, Quat.Y * Sign, Quat.Z * Sign);
+		const float SinHalf = Axis.Size();
+		const float Half = FMath::Atan2(SinHalf, Quat.W * Sign);
+
+		// a/sin(a/2) tends to 2 as the angle goes to zero
+		const float Scale = SinHalf > SmallAngle ? 2.f * Half / SinHalf : 2.f;
+		return Axis * Scale;
+	}
+
+	void AxisAnglesToQuats(const FVector3f* AxisAngles, int32 AxisAngleStride, FQuat4f* OutQuats, int32 Num)
+	{
+		const VectorRegister4Float Half = VectorSetFloat1(0.5f);
+		const VectorRegister4Float Small = VectorSetFloat1(SmallAngle);
+
+		int32 Index = 0;
+		for (; Index + 4 <= Num; Index += 4)
+		{
+			const FVector3f* V1 = Advance(AxisAngles, AxisAngleStride);
+			const FVector3f* V2 = Advance(V1, AxisAngleStride);
+			const FVector3f* V3 = Advance(V2, AxisAngleStride);
+
+			VectorRegister4Float X, Y, Z, Unused;
+			Transpose(VectorLoadFloat3_W0(&AxisAngles->X), VectorLoadFloat3_W0(&V1->X), VectorLoadFloat3_W0(&V2->X), VectorLoadFloat3_W0(&V3->X), X, Y, Z, Unused);
+
+			const VectorRegister4Float Angle = Length3(X, Y, Z);
+			const VectorRegister4Float HalfAngle = VectorMultiply(Angle, Half);
+			VectorRegister4Float SinHalf, CosHalf;
+			VectorSinCos(&SinHalf, &CosHalf, &HalfAngle);
+
+			const VectorRegister4Float Scale = VectorSelect(VectorCompareGT(Angle, Small), VectorDivide(SinHalf, VectorMax(Angle, Small)), Half);
+
+			VectorRegister4Float Q0, Q1, Q2, Q3;
+			Transpose(VectorMultiply(X, Scale), VectorMultiply(Y, Scale), VectorMultiply(Z, Scale), CosHalf, Q0, Q1, Q2, Q3);
+			VectorStore(Q0, &OutQuats[Index].X);
+			VectorStore(Q1, &OutQuats[Index + 1].X);
+			VectorStore(Q2, &OutQuats[Index + 2].X);
+			VectorStore(Q3, &OutQuats[Index + 3].X);
+
+			AxisAngles = Advance(V3, AxisAngleStride);
+		}
+
+		for (; Index < Num; Index++)
+		{
+			OutQuats[Index] = AxisAngleToQuat(*AxisAngles);
+			AxisAngles = Advance(AxisAngles, AxisAngleStride);
+		}
+	}
+
+	void QuatsToAxisAngles(const FQuat4f* Quats, FVector3f* OutAxisAngles, int32 AxisAngleStride, int32 Num)
+	{
+		const VectorRegister4Float Two = VectorSetFloat1(2.f);
+		const VectorRegister4Float Small = VectorSetFloat1(SmallAngle);
+
+		int32 Index = 0;
+		for (; Index + 4 <= Num; Index += 4)
+		{
+			VectorRegister4Float X, Y, Z, W;
+			Transpose(VectorLoad(&Quats[Index].X), VectorLoad(&Quats[Index + 1].X), VectorLoad(&Quats[Index + 2].X), VectorLoad(&Quats[Index + 3].X), X, Y, Z, W);
+
+			// q and -q are the same rotation, pick the one with the shorter angle
+			const VectorRegister4Float Sign = VectorSelect(VectorCompareGT(VectorZero(), W), VectorSetFloat1(-1.f), VectorOne());
+			X = VectorMultiply(X, Sign);
+			Y = VectorMultiply(Y, Sign);
+			Z = VectorMultiply(Z, Sign);
+			W = VectorMultiply(W, Sign);
+
+			const VectorRegister4Float SinHalf = Length3(X, Y, Z);
+			const VectorRegister4Float HalfAngle = VectorATan2(SinHalf, W);
+			const VectorRegister4Float Scale = VectorSelect(VectorCompareGT(SinHalf, Small), VectorDivide(VectorMultiply(Two, HalfAngle), VectorMax(SinHalf, Small)), Two);
+
+			VectorRegister4Float V0, V1, V2, V3;
+			Transpose(VectorMultiply(X, Scale), VectorMultiply(Y, Scale), VectorMultiply(Z, Scale), VectorZero(), V0, V1, V2, V3);
+			VectorStoreFloat3(V0, &OutAxisAngles->X);
+			OutAxisAngles = Advance(OutAxisAngles, AxisAngleStride);
+			VectorStoreFloat3(V1, &OutAxisAngles->X);
+			OutAxisAngles = Advance(OutAxisAngles, AxisAngleStride);
+			VectorStoreFloat3(V2, &OutAxisAngles->X);
+			OutAxisAngles = Advance(OutAxisAngles, AxisAngleStride);
+			VectorStoreFloat3(V3, &OutAxisAngles->X);
+			OutAxisAngles = Advance(OutAxisAngles, AxisAngleStride);
+		}
+
+		for (; Index < Num; Index++)
+		{
+			*OutAxisAngles = QuatToAxisAngle(Quats[Index]);
+			OutAxisAngles = Advance(OutAxisAngles, AxisAngleStride);
+		}
+	}
+}
@@ -8,16 +8,17 @@
 #include "Common/UdpSocketBuilder.h"
 #include "Sockets.h"
 #include "Stats/Stats2.h"
+#include "PSNStats.h"
+#include "PSNTrace.h"
+#include "Misc/ScopeLock.h"
 #include "PSN/psn_lib.hpp"
 
 FPSNReceiverProxy::FPSNReceiverProxy(UPSNReceiverSubsystem& InReceiver)
 	: ReceiverSubsystem(&InReceiver)
-	, Socket(nullptr)
-	, SocketReceiver(nullptr)
 	, Port(::psn::DEFAULT_UDP_PORT)
 	, bMulticastLoopback(false)
+	, LastPacketType(EPSNPacketType::PSNType_Invalid)
 {
-	psn_decoder = new ::psn::psn_decoder;
 }
 
 bool FPSNReceiverProxy::GetMulticastLoopback() const
@@ -27,7 +28,7 @@ bool FPSNReceiverProxy::GetMulticastLoopback() const
 
 bool FPSNReceiverProxy::IsActive() const
 {
-	return SocketReceiver != nullptr;
+	return ListenSockets.Num() > 0;
 }
 
 void FPSNReceiverProxy::Listen(const FString& ServerName)
@@ -37,11 +38,37 @@ void FPSNReceiverProxy::Listen(const FString& ServerName)
 		return;
 	}
 
+	RedundantMerge.Reset();
+
+	// Redundant paths share the port, so their sockets must be reusable
+	const bool bReusable = RedundantPaths.Num() > 0;
+	FPSNReceivePath MainPath;
+	MainPath.Address = ReceiveIPAddress;
+	ListenOn(ServerName, MainPath, bReusable);
+	for (int32 Index = 0; Index < RedundantPaths.Num(); Index++)
+	{
+		ListenOn(FString::Printf(TEXT("%s_%d"), *ServerName, Index + 1), RedundantPaths[Index], bReusable);
+	}
+}
+
+bool FPSNReceiverProxy::ListenOn(const FString& ServerName, const FPSNReceivePath& Path, bool bReusable)
+{
 	FUdpSocketBuilder Builder(*ServerName);
 	Builder.BoundToPort(Port);
-	if (ReceiveIPAddress.IsMulticastAddress())
+	if (bReusable)
 	{
-		Builder.JoinedToGroup(ReceiveIPAddress);
+		Builder.AsReusable();
+	}
+	if (Path.Address.IsMulticastAddress())
+	{
+		if (Path.Interface == FIPv4Address::Any)
+		{
+			Builder.JoinedToGroup(Path.Address);
+		}
+		else
+		{
+			Builder.JoinedToGroup(Path.Address, Path.Interface);
+		}
 		if (bMulticastLoopback)
 		{
 			Builder.WithMulticastLoopback();
@@ -53,24 +80,25 @@ void FPSNReceiverProxy::Listen(const FString& ServerName)
 		{
 			UE_LOG(LogPSN, Warning, TEXT("PSN Receiver '%s' ReceiveIPAddress provided is not a multicast address."),*ServerName);
 		}
-		Builder.BoundToAddress(ReceiveIPAddress);
+		Builder.BoundToAddress(Path.Address);
 	}
 
-	Socket = Builder.Build();
+	FSocket* Socket = Builder.Build();
 	if (Socket)
 	{
-		SocketReceiver = new FUdpSocketReceiver(Socket, FTimespan::FromMilliseconds(100), *(ServerName + TEXT("_ListenerThread")));
-		SocketReceiver->OnDataReceived().BindRaw(this, &FPSNReceiverProxy::OnPacketReceived);
-		SocketReceiver->Start();
-		UE_LOG(LogPSN, Display, TEXT("PSNReceiver '%s' Listening: %s:%d."), *ServerName, *ReceiveIPAddress.ToString(), Port);
-	}
-	else
-	{
-		UE_LOG(LogPSN, Error, TEXT("PSNReceiver '%s' failed to bind to socket on %s:%d."), *ServerName, *ReceiveIPAddress.ToString(), Port);
-		ESocketErrors Error = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->GetLastErrorCode();
-		FString ErrorMsg = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->GetSocketError();
-		UE_LOG(LogPSN, Error, TEXT("Potential Error: %s."), *ErrorMsg);
+		FListenSocket& Listener = ListenSockets.AddDefaulted_GetRef();
+		Listener.Socket = Socket;
+		Listener.Receiver = new FUdpSocketReceiver(Socket, FTimespan::FromMilliseconds(100), *(ServerName + TEXT("_ListenerThread")));
+		Listener.Receiver->OnDataReceived().BindRaw(this, &FPSNReceiverProxy::OnPacketReceived);
+		Listener.Receiver->Start();
+		UE_LOG(LogPSN, Display, TEXT("PSNReceiver '%s' Listening: %s:%d."), *ServerName, *Path.Address.ToString(), Port);
+		return true;
 	}
+
+	UE_LOG(LogPSN, Error, TEXT("PSNReceiver '%s' failed to bind to socket on %s:%d."), *ServerName, *Path.Address.ToString(), Port);
+	FString ErrorMsg = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->GetSocketError();
+	UE_LOG(LogPSN, Error, TEXT("Potential Error: %s."), *ErrorMsg);
+	return false;
 }
 
 
@@ -92,6 +120,18 @@ bool FPSNReceiverProxy::SetAddress(const FString& InReceiveIPAddress, int32 InPo
 	return true;
 }
 
+bool FPSNReceiverProxy::SetRedundantPaths(const TArray<FPSNReceivePath>& InPaths)
+{
+	if (IsActive())
+	{
+		UE_LOG(LogPSN, Error, TEXT("Cannot set redundant paths while PSNServer is active."));
+		return false;
+	}
+
+	RedundantPaths = InPaths;
+	return true;
+}
+
 void FPSNReceiverProxy::SetMulticastLoopback(bool InMulticastLoopback)
 {
 	if (InMulticastLoopback != bMulticastLoopback && IsActive())
@@ -103,42 +143,219 @@ void FPSNReceiverProxy::SetMulticastLoopback(bool InMulticastLoopback)
 	bMulticastLoopback = InMulticastLoopback;
 }
 
-void FPSNReceiverProxy::Stop()
+bool FPSNReceiverProxy::RecordSequence(const FPSNFrameSequenceResult& Sequence, FPSNSourceStats* SourceStats)
 {
-	if (SocketReceiver)
+	FPSNReceiverStats& Stats = ReceiverSubsystem->GetStats();
+
+	const auto Count = [SourceStats](std::atomic<uint64>& Total, std::atomic<uint64> FPSNSourceStats::* SourceCounter, uint64 Value)
+	{
+		Total += Value;
+		if (SourceStats)
+		{
+			(SourceStats->*SourceCounter) += Value;
+		}
+	};
+
+	if (Sequence.FramesLost > 0)
 	{
-		delete SocketReceiver;
-		SocketReceiver = nullptr;
+		Count(Stats.FramesDropped, &FPSNSourceStats::FramesLost, Sequence.FramesLost);
 	}
-	if (Socket)
+	if (Sequence.bPreviousPartial)
+	{
+		Count(Stats.FramesPartial, &FPSNSourceStats::FramesPartial, 1);
+	}
+	if (Sequence.bDuplicate)
+	{
+		Count(Stats.PacketsDuplicated, &FPSNSourceStats::PacketsDuplicated, 1);
+	}
+	else if (!Sequence.bAccept)
+	{
+		Count(Stats.PacketsLate, &FPSNSourceStats::PacketsLate, 1);
+	}
+
+	// It was counted as lost when the newer frame arrived
+	if (Sequence.bReordered)
+	{
+		Count(Stats.FramesReordered, &FPSNSourceStats::FramesReordered, 1);
+		Stats.FramesDropped--;
+		if (SourceStats)
+		{
+			SourceStats->FramesLost--;
+		}
+	}
+
+	return Sequence.bAccept;
+}
+
+void FPSNReceiverProxy::SetCoordinateTransforms(const FPSNCoordinateTransform& InDefaultTransform, const TMap<FIPv4Address, FPSNCoordinateTransform>& InSourceTransforms)
+{
+	FScopeLock Lock(&TransformLock);
+	DefaultTransform = InDefaultTransform;
+	SourceTransforms = InSourceTransforms;
+}
+
+void FPSNReceiverProxy::Stop()
+{
+	for (FListenSocket& Listener : ListenSockets)
 	{
-		Socket->Close();
-		ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(Socket);
-		Socket = nullptr;
+		delete Listener.Receiver;
+		Listener.Socket->Close();
+		ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(Listener.Socket);
 	}
+	ListenSockets.Reset();
 }
 
 void FPSNReceiverProxy::OnPacketReceived(const FArrayReaderPtr& RawData, const FIPv4Endpoint& Endpoint)
 {
+	PSN_TRACE_SCOPE(PSN_Receive);
+	PSNTrace::PacketReceived(RawData->Num());
+
+	FPSNReceiverStats& Stats = ReceiverSubsystem->GetStats();
+	const uint64 ReceiveCycles = FPlatformTime::Cycles64();
+	const double ReceiveTime = FPlatformTime::Seconds();
+	Stats.PacketsReceived++;
+	Stats.BytesReceived += RawData->Num();
+
+	// Each network is still counted as its own source, so a failing path shows in the stats
+	FPSNSourceStats* SourceStats = Stats.FindOrAddSource(Endpoint.Address.Value);
+	if (SourceStats)
+	{
+		SourceStats->PacketsReceived++;
+		SourceStats->LastReceiveTime = ReceiveTime;
+	}
+
+	// With redundant paths, the first copy of each packet goes on and later copies are dropped before decoding.
+	// Only the merge and the source lookup are shared between paths; decoding runs under the source's own lock.
+	uint32 SourceKey = Endpoint.Address.Value;
+	FSourceState* SourceState = nullptr;
+	{
+		FScopeLock ReceiveScope(&ReceiveLock);
+		if (RedundantPaths.Num() > 0 && !RedundantMerge.Push(RawData->GetData(), RawData->Num(), Endpoint.Address.Value, ReceiveTime, SourceKey))
+		{
+			Stats.PacketsRedundant++;
+			if (SourceStats)
+			{
+				SourceStats->PacketsRedundant++;
+			}
+			return;
+		}
+
+		TUniquePtr<FSourceState>& State = SourceStates.FindOrAdd(SourceKey);
+		if (!State)
+		{
+			State = MakeUnique<FSourceState>();
+		}
+		SourceState = State.Get();
+	}
+	const FIPv4Address SourceAddress(SourceKey);
+
+	FScopeLock SourceScope(&SourceState->Lock);
+
+	// Sequence data packets before decoding, so repeats and packets of older frames never reach the decoder
+	uint16 PacketID = 0;
+	uint8 HeaderFrameID = 0;
+	uint8 FramePacketCount = 0;
+	if (FPSNStream::PeekHeader(RawData->GetData(), RawData->Num(), PacketID, HeaderFrameID, FramePacketCount) && PacketID == ::psn::DATA_PACKET)
+	{
+		const FPSNFrameSequenceResult Sequence = SourceState->Sequence.Push(HeaderFrameID, FramePacketCount, ReceiveTime);
+		if (!RecordSequence(Sequence, SourceStats))
+		{
+			return;
+		}
+	}
+
 	// Create PSN Stream
-	FPSNStream Stream = FPSNStream(RawData->GetData(), RawData->Num(), LastFrameID);
+	FPSNStream Stream = FPSNStream(RawData->GetData(), RawData->Num(), SourceState->LastFrameID);
 	
-	TArray<FPSNTracker> TrackerMap;
-	Stream.DecodeToTrackers(TrackerMap, psn_decoder);
-	LastPacketType = Stream.StreamDataType;
-	LastFrameID = Stream.GetHeaderFrameID();
+	FPSNQueuedPacket Packet;
+	Packet.ReceiveCycles = ReceiveCycles;
+	Packet.SourceAddress = SourceKey;
+	{
+		SCOPE_CYCLE_COUNTER(STAT_PSNDecode);
+		CSV_SCOPED_TIMING_STAT(PSN, Decode);
+		PSN_TRACE_SCOPE(PSN_Decode);
 
-	for (auto& Tracker : TrackerMap)
+		// Decode alone, so lock waits and sequencing above do not show up as decode cost
+		const uint64 DecodeStart = FPlatformTime::Cycles64();
+		const bool bDecoded = Stream.DecodeToTrackers(Packet.Trackers, &SourceState->Decoder);
+		Stats.DecodeCycles += FPlatformTime::Cycles64() - DecodeStart;
+		Stats.PacketsDecoded++;
+		if (!bDecoded)
+		{
+			Stats.DecodeErrors++;
+			if (SourceStats)
+			{
+				SourceStats->DecodeErrors++;
+			}
+		}
+	}
+	const EPSNPacketType PacketType = Stream.StreamDataType;
+	LastPacketType = PacketType;
+	Packet.PacketType = PacketType;
+
+	// Info frames repeat about once a second and rarely change, so names are only converted and queued when they do
+	if (PacketType == EPSNPacketType::PSNType_Info)
+	{
+		const ::psn::psn_decoder::info_t& Info = SourceState->Decoder.get_info();
+		if (Info.system_name != SourceState->SystemName || Info.tracker_names != SourceState->TrackerNames)
+		{
+			SourceState->SystemName = Info.system_name;
+			SourceState->TrackerNames = Info.tracker_names;
+			FPSNStream::ConvertInfo(SourceState->Decoder, Packet.SourceInfo.Emplace());
+		}
+	}
+
+	// A changed frame ID means a frame was completed. Gaps are counted by the frame sequence.
+	const uint8_t FrameID = Stream.GetHeaderFrameID();
+	if (PacketType == EPSNPacketType::PSNType_Data && (FrameID != SourceState->LastFrameID || !SourceState->bHasDataFrame))
 	{
-		TSharedPtr<FPSNTracker> TrackerPtr = MakeShared<FPSNTracker>(Tracker);
-		ReceiverSubsystem->EnqueuePacket(TrackerPtr);
+		Stats.FramesCompleted++;
+		SourceState->bHasDataFrame = true;
+		if (SourceStats)
+		{
+			SourceStats->FramesCompleted++;
+			SourceStats->LastFrameID = FrameID;
+		}
+		PSNTrace::FrameDecoded(FrameID, SourceState->Decoder.get_data().header.frame_packet_count, Packet.Trackers.Num());
+	}
+	SourceState->LastFrameID = FrameID;
+
+	const int32 NumTrackers = Packet.Trackers.Num();
+	if (NumTrackers > 0)
+	{
+		// Meters to cm and the source's coordinate space in one pass
+		FPSNCoordinateTransform Transform;
+		{
+			FScopeLock Lock(&TransformLock);
+			const FPSNCoordinateTransform* SourceTransform = SourceTransforms.Find(Endpoint.Address);
+			if (!SourceTransform)
+			{
+				SourceTransform = SourceTransforms.Find(SourceAddress);
+			}
+			Transform = SourceTransform ? *SourceTransform : DefaultTransform;
+		}
+		Transform.Apply(Packet.Trackers);
+	}
+
+	if (NumTrackers > 0 || Packet.SourceInfo.IsSet())
+	{
+		PSN_TRACE_SCOPE(PSN_Enqueue);
+		if (SourceStats)
+		{
+			SourceStats->MarkTrackersReceived(Packet.Trackers, ReceiveTime);
+		}
+		ReceiverSubsystem->EnqueuePacket(MoveTemp(Packet));
+		if (NumTrackers > 0)
+		{
+			PSNTrace::FrameEnqueued(FrameID, NumTrackers);
+		}
 	}
 
 	// Dispatch task to  dequeue and processes each event (approaching it this way avoids problems with multiple executions per tick)
 	DECLARE_CYCLE_STAT(TEXT("PSNReceiver.OnPacketReceived"), STAT_PSNReceiverOnPacketReceived, STATGROUP_PSNNetworkCommands);
-	FFunctionGraphTask::CreateAndDispatchWhenReady([this, Endpoint]()
+	FFunctionGraphTask::CreateAndDispatchWhenReady([this, SourceAddress]()
 		{
-		ReceiverSubsystem->OnPacketReceived(Endpoint.Address.ToString());
+		ReceiverSubsystem->OnPacketReceived(SourceAddress.ToString());
 		}, GET_STATID(STAT_PSNReceiverOnPacketReceived), nullptr, ENamedThreads::GameThread);
 
 }
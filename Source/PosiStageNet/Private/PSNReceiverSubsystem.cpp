@@ -3,12 +3,72 @@
 
 #include "PSNReceiverSubsystem.h"
 #include "PSNReceiverProxy.h"
+#include "PSNTrace.h"
+#include "PSNHealthEndpoint.h"
 
 UPSNReceiverSubsystem::UPSNReceiverSubsystem()
 	: ReceiverProxy(nullptr)
 {
 }
 
+void UPSNReceiverSubsystem::Tick(float DeltaTime)
+{
+	const double Now = FPlatformTime::Seconds();
+	EvictStaleTrackers(Now);
+
+	if (Zones.Num() > 0)
+	{
+		const bool bPositionsChanged = SnapshotRevision != ZoneRevision;
+		ZoneRevision = SnapshotRevision;
+
+		Zones.Evaluate(SpatialIndex, Now, bPositionsChanged, ZoneEvents);
+		BroadcastZoneEvents();
+	}
+}
+
+bool UPSNReceiverSubsystem::IsTickable() const
+{
+	return Zones.Num() > 0 || (TrackerTimeout > 0.f && SpatialIndex.Num() > 0);
+}
+
+TStatId UPSNReceiverSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UPSNReceiverSubsystem, STATGROUP_Tickables);
+}
+
+void UPSNReceiverSubsystem::SetTrackerTimeout(float Seconds)
+{
+	TrackerTimeout = FMath::Max(Seconds, 0.f);
+	NextTimeoutCheck = 0.0;
+}
+
+void UPSNReceiverSubsystem::EvictStaleTrackers(double Now)
+{
+	if (TrackerTimeout <= 0.f || Now < NextTimeoutCheck)
+	{
+		return;
+	}
+
+	// Exits go out at most a quarter of the timeout late
+	NextTimeoutCheck = Now + TrackerTimeout * 0.25;
+
+	bool bEvicted = false;
+	FVector3f Position;
+	for (const TPair<int32, FPSNTrackerSnapshotEntry>& Pair : TrackerSnapshot)
+	{
+		if (Now - Pair.Value.LastReceivedTime > TrackerTimeout && SpatialIndex.GetPosition(Pair.Key, Position))
+		{
+			SpatialIndex.Remove(Pair.Key);
+			bEvicted = true;
+		}
+	}
+
+	if (bEvicted)
+	{
+		++SnapshotRevision;
+	}
+}
+
 void UPSNReceiverSubsystem::Initialize(FSubsystemCollectionBase& Collection)
 {
 	Super::Initialize(Collection);
@@ -31,10 +91,18 @@ void UPSNReceiverSubsystem::StartPSNReceiver(FString ReceiverName, FString IPAdd
 	ReceiverProxy.Reset(new FPSNReceiverProxy(*this));
 	ReceiverProxy->SetMulticastLoopback(bMulticastLoopback);
 	ReceiverProxy->SetAddress(IPAddress, Port);
+	ReceiverProxy->SetRedundantPaths(RedundantPaths);
+	ReceiverProxy->SetCoordinateTransforms(CoordinateTransform, SourceTransforms);
 	if (bStartListening)
 	{
 		ReceiverProxy->Listen(ReceiverName);
 	}
+
+	FPSNHealthEndpoint::Get().RegisterReceiver(ReceiverName, &Stats);
+	if (!PublishStatsHandle.IsValid())
+	{
+		PublishStatsHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &UPSNReceiverSubsystem::PublishStats));
+	}
 }
 
 void UPSNReceiverSubsystem::StopReceiver()
@@ -43,38 +111,414 @@ void UPSNReceiverSubsystem::StopReceiver()
 	{
 		ReceiverProxy->Stop();
 	}
+
+	FPSNHealthEndpoint::Get().UnregisterReceiver(&Stats);
+	if (PublishStatsHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(PublishStatsHandle);
+		PublishStatsHandle.Reset();
+	}
+}
+
+bool UPSNReceiverSubsystem::PublishStats(float DeltaTime)
+{
+	Stats.Publish();
+	return true;
+}
+
+bool UPSNReceiverSubsystem::AddRedundantPath(const FString& IPAddress, const FString& InterfaceAddress)
+{
+	FPSNReceivePath Path;
+	if (!FIPv4Address::Parse(IPAddress, Path.Address) || (!InterfaceAddress.IsEmpty() && !FIPv4Address::Parse(InterfaceAddress, Path.Interface)))
+	{
+		UE_LOG(LogPSN, Warning, TEXT("Invalid PSN redundant path '%s' on interface '%s', not added."), *IPAddress, *InterfaceAddress);
+		return false;
+	}
+
+	RedundantPaths.Add(Path);
+	return true;
+}
+
+void UPSNReceiverSubsystem::ClearRedundantPaths()
+{
+	RedundantPaths.Reset();
+}
+
+void UPSNReceiverSubsystem::SetCoordinateSpace(UPSNCoordinateSpace* Space)
+{
+	CoordinateTransform = Space ? Space->MakeTransform() : FPSNCoordinateTransform();
+	if (ReceiverProxy)
+	{
+		ReceiverProxy->SetCoordinateTransforms(CoordinateTransform, SourceTransforms);
+	}
+}
+
+bool UPSNReceiverSubsystem::SetSourceCoordinateSpace(const FString& SourceAddress, UPSNCoordinateSpace* Space)
+{
+	FIPv4Address Address;
+	if (!FIPv4Address::Parse(SourceAddress, Address))
+	{
+		UE_LOG(LogPSN, Warning, TEXT("Invalid PSN source address '%s', coordinate space not set."), *SourceAddress);
+		return false;
+	}
+
+	if (Space)
+	{
+		SourceTransforms.Add(Address, Space->MakeTransform());
+	}
+	else
+	{
+		SourceTransforms.Remove(Address);
+	}
+
+	if (ReceiverProxy)
+	{
+		ReceiverProxy->SetCoordinateTransforms(CoordinateTransform, SourceTransforms);
+	}
+	return true;
+}
+
+void UPSNReceiverSubsystem::SetChangeSuppression(bool bEnable, float PositionTolerance, float ValueTolerance, float HeartbeatSeconds)
+{
+	bSuppressUnchanged = bEnable;
+	SuppressPositionTolerance = FMath::Max(PositionTolerance, KINDA_SMALL_NUMBER);
+	SuppressValueTolerance = FMath::Max(ValueTolerance, KINDA_SMALL_NUMBER);
+	SuppressHeartbeatSeconds = FMath::Max(HeartbeatSeconds, 0.f);
+}
+
+void UPSNReceiverSubsystem::AddBoxZone(FName Zone, FBox Box, float DwellTime)
+{
+	Zones.AddZone(FPSNZone::MakeBox(Zone, Box, DwellTime));
+}
+
+void UPSNReceiverSubsystem::AddSphereZone(FName Zone, FVector Center, float Radius, float DwellTime)
+{
+	Zones.AddZone(FPSNZone::MakeSphere(Zone, Center, Radius, DwellTime));
+}
+
+void UPSNReceiverSubsystem::AddPolygonZone(FName Zone, const TArray<FVector2D>& Points, float MinZ, float MaxZ, float DwellTime)
+{
+	if (Points.Num() < 3)
+	{
+		UE_LOG(LogPSN, Warning, TEXT("PSN zone '%s' needs at least 3 points, nothing will enter it."), *Zone.ToString());
+	}
+	Zones.AddZone(FPSNZone::MakePolygon(Zone, Points, MinZ, MaxZ, DwellTime));
+}
+
+bool UPSNReceiverSubsystem::RemoveZone(FName Zone)
+{
+	const bool bRemoved = Zones.RemoveZone(Zone, ZoneEvents);
+	BroadcastZoneEvents();
+	return bRemoved;
+}
+
+void UPSNReceiverSubsystem::ClearZones()
+{
+	Zones.Reset(ZoneEvents);
+	BroadcastZoneEvents();
+}
+
+bool UPSNReceiverSubsystem::GetZoneOccupants(FName Zone, TArray<int32>& OutIDs) const
+{
+	return Zones.GetOccupants(Zone, OutIDs);
+}
+
+void UPSNReceiverSubsystem::BroadcastZoneEvents()
+{
+	if (ZoneEvents.Num() == 0)
+	{
+		return;
+	}
+
+	// Handlers may add or remove zones, which queues more events
+	TArray<FPSNZoneEvent> Events = MoveTemp(ZoneEvents);
+	for (const FPSNZoneEvent& Event : Events)
+	{
+		switch (Event.Type)
+		{
+		case EPSNZoneEventType::PSN_Enter:
+			OnPSNZoneEntered.Broadcast(Event.Zone, Event.TrackerID);
+			break;
+		case EPSNZoneEventType::PSN_Exit:
+			OnPSNZoneExited.Broadcast(Event.Zone, Event.TrackerID);
+			break;
+		case EPSNZoneEventType::PSN_Dwell:
+			OnPSNZoneDwell.Broadcast(Event.Zone, Event.TrackerID);
+			break;
+		}
+	}
+
+	// Keep the allocation for the next frame
+	if (ZoneEvents.Num() == 0)
+	{
+		Events.Reset();
+		ZoneEvents = MoveTemp(Events);
+	}
 }
 
 // Called from the ReceiverProxy
-void UPSNReceiverSubsystem::EnqueuePacket(TSharedPtr<FPSNTracker> Packet)
+void UPSNReceiverSubsystem::EnqueuePacket(FPSNQueuedPacket&& Packet)
 {
-	PacketQueue.Enqueue(Packet);
+	Stats.QueueDepth += Packet.Trackers.Num();
+	PacketQueue.Enqueue(MoveTemp(Packet));
 }
 
 // Called from the ReceiverProxy
 void UPSNReceiverSubsystem::OnPacketReceived(const FString& IPAddress)
 {
-	TSharedPtr<FPSNTracker> Msg;
+	SCOPE_CYCLE_COUNTER(STAT_PSNDispatch);
+	CSV_SCOPED_TIMING_STAT(PSN, Dispatch);
+	PSN_TRACE_SCOPE(PSN_Dispatch);
+	const uint64 DispatchStart = FPlatformTime::Cycles64();
+
+	FPSNQueuedPacket Msg;
+	int32 FrameID = INDEX_NONE;
+	uint32 FrameTrackerCount = 0;
 
 	while (PacketQueue.Dequeue(Msg))
 	{
-		DispatchMessage(Msg);
+		if (Msg.SourceInfo.IsSet())
+		{
+			DispatchSourceInfo(Msg.SourceAddress, MoveTemp(Msg.SourceInfo.GetValue()));
+			Msg.SourceInfo.Reset();
+		}
+
+		const int32 NumTrackers = Msg.Trackers.Num();
+		if (NumTrackers == 0)
+		{
+			continue;
+		}
+
+		// Packets are queued in frame order, so a change of ID closes the previous frame
+		if (Msg.Trackers[0].FrameID != FrameID)
+		{
+			if (FrameTrackerCount > 0)
+			{
+				PSNTrace::FrameDispatched((uint8)FrameID, FrameTrackerCount);
+			}
+			FrameID = Msg.Trackers[0].FrameID;
+			FrameTrackerCount = 0;
+		}
+		FrameTrackerCount += NumTrackers;
+
+		Stats.QueueDepth -= NumTrackers;
+
+		const uint64 LatencyCycles = FPlatformTime::Cycles64() - Msg.ReceiveCycles;
+		Stats.DispatchLatencyCycles += LatencyCycles * NumTrackers;
+		Stats.LastDispatchLatencyMs = FPlatformTime::ToMilliseconds64(LatencyCycles);
+		Stats.TrackersDispatched += NumTrackers;
+
+		// History is timed by arrival rather than dispatch, which is quantised to game frames
+		const double ReceiveTime = FPlatformTime::Seconds() - FPlatformTime::ToSeconds64(LatencyCycles);
+		for (const FPSNTrackerRecord& Record : Msg.Trackers)
+		{
+			DispatchTracker(Record, Msg.SourceAddress, ReceiveTime);
+		}
+	}
+
+	if (FrameTrackerCount > 0)
+	{
+		PSNTrace::FrameDispatched((uint8)FrameID, FrameTrackerCount);
+	}
+
+	Stats.DispatchCycles += FPlatformTime::Cycles64() - DispatchStart;
+}
+
+void UPSNReceiverSubsystem::DispatchTracker(const FPSNTrackerRecord& Record, uint32 SourceAddress, double ReceiveTime)
+{
+	FPSNTrackerSnapshotEntry& Entry = TrackerSnapshot.FindOrAdd(Record.ID);
+
+	// One tracker per ID: another source can only take the ID over once its holder has timed out
+	if (Entry.LastReceivedTime > 0.0 && Entry.SourceAddress != SourceAddress &&
+		(TrackerTimeout <= 0.f || ReceiveTime - Entry.LastReceivedTime <= TrackerTimeout))
+	{
+		Stats.TrackerIDConflicts++;
+		if (Entry.ConflictAddress != SourceAddress)
+		{
+			Entry.ConflictAddress = SourceAddress;
+			UE_LOG(LogPSN, Warning, TEXT("PSN tracker %d from %s dropped, the ID is already used by %s. Sources sharing a receiver need distinct tracker IDs."),
+				Record.ID, *FIPv4Address(SourceAddress).ToString(), *FIPv4Address(Entry.SourceAddress).ToString());
+		}
+		return;
+	}
+
+	// Taken over from a source that timed out, so the old source's samples are not interpolated with the new one's
+	if (Entry.LastReceivedTime > 0.0 && Entry.SourceAddress != SourceAddress)
+	{
+		TrackerHistory.Remove(Record.ID);
+	}
+
+	Entry.Tracker = Record;
+	Entry.SourceAddress = SourceAddress;
+	Entry.ConflictAddress = 0;
+	Entry.LastReceivedTime = ReceiveTime;
+	++SnapshotRevision;
+
+	if (Record.HasField(EPSNTrackerField::Position))
+	{
+		SpatialIndex.Update(Record.ID, Record.Position);
+		TrackerHistory.Push(Record.ID, ReceiveTime, Record);
+	}
+
+	if (OnPSNPacketReceived.IsBound() || OnPSNDataPacketReceived.IsBound())
+	{
+		if (bSuppressUnchanged && !ShouldDeliver(Entry))
+		{
+			Stats.TrackersSuppressed++;
+			return;
+		}
+
+		Entry.Tracker.ToTracker(DispatchScratch);
+
+		// Copy into the existing buffer rather than allocating a name per tracker. Sources may reuse IDs, so only this one's names apply.
+		const FString* Name = InfoTable.FindName(SourceAddress, Record.ID);
+		if (Name)
+		{
+			DispatchScratch.Info.Name = *Name;
+		}
+		else
+		{
+			DispatchScratch.Info.Name.Reset();
+		}
+
+		OnPSNPacketReceived.Broadcast(DispatchScratch);
+		OnPSNDataPacketReceived.Broadcast(DispatchScratch);
+	}
+}
+
+bool UPSNReceiverSubsystem::ShouldDeliver(FPSNTrackerSnapshotEntry& Entry) const
+{
+	const double Now = Entry.LastReceivedTime;
+	const bool bHeartbeat = SuppressHeartbeatSeconds > 0.f && Now - Entry.LastDeliveredTime >= SuppressHeartbeatSeconds;
+
+	// Compared against the last delivered state rather than the previous frame, so slow drift still gets through
+	if (Entry.LastDeliveredTime > 0.0 && !bHeartbeat &&
+		Entry.Tracker.NearlyEquals(Entry.Delivered, SuppressPositionTolerance, SuppressValueTolerance))
+	{
+		return false;
+	}
+
+	Entry.Delivered = Entry.Tracker;
+	Entry.LastDeliveredTime = Now;
+	return true;
+}
+
+void UPSNReceiverSubsystem::DispatchSourceInfo(uint32 SourceAddress, FPSNSourceInfo&& Info)
+{
+	// Names change rarely, so a local array is fine here
+	TArray<FPSNTrackerInfo> ChangedInfos;
+	InfoTable.SetSource(SourceAddress, MoveTemp(Info), ChangedInfos);
+	for (const FPSNTrackerInfo& Changed : ChangedInfos)
+	{
+		DispatchInfo(Changed);
 	}
 }
 
-void UPSNReceiverSubsystem::DispatchMessage(TSharedPtr<FPSNTracker> Message)
+void UPSNReceiverSubsystem::DispatchInfo(const FPSNTrackerInfo& Info)
 {
-	// Before sending, convert from meters to cm
-	Message->Data.Position *= 100;
-	Message->Data.TargetPosition *= 100;
-	OnPSNPacketReceived.Broadcast(*Message);
-	
-	if (ReceiverProxy->GetLastPacketType() == EPSNPacketType::PSNType_Info)
+	if (OnPSNPacketReceived.IsBound())
 	{
-		OnPSNInfoPacketReceived.Broadcast(Message->Info);
+		OnPSNPacketReceived.Broadcast(FPSNTracker(Info));
 	}
-	else if (ReceiverProxy->GetLastPacketType() == EPSNPacketType::PSNType_Data)
+	OnPSNInfoPacketReceived.Broadcast(Info);
+}
+
+FString UPSNReceiverSubsystem::GetTrackerName(int32 ID) const
+{
+	const FPSNTrackerSnapshotEntry* Entry = TrackerSnapshot.Find(ID);
+	const FString* Name = Entry ? InfoTable.FindName(Entry->SourceAddress, ID) : InfoTable.FindName(ID);
+	return Name ? *Name : FString();
+}
+
+FString UPSNReceiverSubsystem::GetSourceSystemName(const FString& SourceAddress) const
+{
+	FIPv4Address Address;
+	if (!FIPv4Address::Parse(SourceAddress, Address))
+	{
+		return FString();
+	}
+
+	const FPSNSourceInfo* Source = InfoTable.FindSource(Address.Value);
+	return Source ? Source->SystemName : FString();
+}
+
+void UPSNReceiverSubsystem::GetLatestTrackers(TArray<FPSNTracker>& OutTrackers) const
+{
+	OutTrackers.Reset(TrackerSnapshot.Num());
+	for (const TPair<int32, FPSNTrackerSnapshotEntry>& Pair : TrackerSnapshot)
+	{
+		FPSNTracker& Tracker = OutTrackers.AddDefaulted_GetRef();
+		Pair.Value.Tracker.ToTracker(Tracker);
+		Tracker.Info.Name = GetTrackerName(Pair.Key);
+	}
+}
+
+bool UPSNReceiverSubsystem::GetLatestTracker(int32 ID, FPSNTracker& OutTracker) const
+{
+	const FPSNTrackerSnapshotEntry* Entry = TrackerSnapshot.Find(ID);
+	if (!Entry)
+	{
+		return false;
+	}
+
+	Entry->Tracker.ToTracker(OutTracker);
+	OutTracker.Info.Name = GetTrackerName(ID);
+	return true;
+}
+
+void UPSNReceiverSubsystem::GetTrackersInRadius(FVector Center, float Radius, TArray<int32>& OutIDs) const
+{
+	SpatialIndex.QueryRadius(Center, Radius, OutIDs);
+}
+
+void UPSNReceiverSubsystem::GetTrackersInBox(FBox Box, TArray<int32>& OutIDs) const
+{
+	SpatialIndex.QueryBox(Box, OutIDs);
+}
+
+void UPSNReceiverSubsystem::GetNearestTrackers(FVector Location, int32 Count, TArray<int32>& OutIDs, float MaxDistance) const
+{
+	SpatialIndex.QueryNearest(Location, Count, OutIDs, MaxDistance);
+}
+
+void UPSNReceiverSubsystem::SetSpatialCellSize(float CellSize)
+{
+	SpatialIndex.SetCellSize(CellSize);
+}
+
+void UPSNReceiverSubsystem::SetTrackerHistoryLength(int32 Samples)
+{
+	TrackerHistory.SetSamplesPerTracker(Samples);
+}
+
+bool UPSNReceiverSubsystem::GetTrackerStateAtTime(int32 ID, float SecondsAgo, FVector& OutPosition, FRotator& OutRotation) const
+{
+	FQuat Rotation;
+	if (!TrackerHistory.GetStateAtTime(ID, FPlatformTime::Seconds() - SecondsAgo, OutPosition, Rotation))
 	{
-		OnPSNDataPacketReceived.Broadcast(*Message);
+		return false;
 	}
+
+	OutRotation = Rotation.Rotator();
+	return true;
+}
+
+bool UPSNReceiverSubsystem::GetTrackerTrajectory(int32 ID, float Duration, TArray<FVector>& OutPositions) const
+{
+	const double Now = FPlatformTime::Seconds();
+	return TrackerHistory.GetTrajectory(ID, Now - Duration, Now, OutPositions);
+}
+
+bool UPSNReceiverSubsystem::GetTrackerVelocity(int32 ID, float Window, FVector& OutVelocity) const
+{
+	const double Now = FPlatformTime::Seconds();
+	return TrackerHistory.GetVelocity(ID, Now - Window, Now, OutVelocity);
+}
+
+void UPSNReceiverSubsystem::ClearTrackerSnapshot()
+{
+	TrackerSnapshot.Empty();
+	SpatialIndex.Reset();
+	TrackerHistory.Reset();
+	++SnapshotRevision;
 }
\ No newline at end of file
@@ -0,0 +1,98 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+
+#include "PSNRedundantMerge.h"
+#include "Hash/CityHash.h"
+
+FPSNRedundantMerge::FPSNRedundantMerge()
+{
+	Window.SetNum(InitialWindowSize);
+	Slots.Reserve(InitialWindowSize);
+}
+
+bool FPSNRedundantMerge::Push(const uint8* Data, int32 Size, uint32 SourceAddress, double Now, uint32& OutSourceKey)
+{
+	const uint64 Hash = CityHash64((const char*)Data, Size);
+
+	if (const int32* Slot = Slots.Find(Hash))
+	{
+		const FEntry& First = Window[*Slot];
+		if (Now - First.Time <= WindowSeconds)
+		{
+			// A copy from another address matches that address to the first one's stream
+			const uint32 FirstKey = GetSourceKey(First.SourceAddress);
+			if (FirstKey != SourceAddress && !SourceKeys.Contains(SourceAddress))
+			{
+				SourceKeys.Add(SourceAddress, FirstKey);
+			}
+			OutSourceKey = FirstKey;
+			return false;
+		}
+	}
+
+	// The oldest entry is still inside the time window, so the packet rate has outgrown the ring
+	if (Window[Head].Time > 0.0 && Now - Window[Head].Time <= WindowSeconds && Window.Num() < MaxWindowSize)
+	{
+		Grow();
+	}
+
+	FEntry& Entry = Window[Head];
+	const int32* EvictedSlot = Slots.Find(Entry.Hash);
+	if (EvictedSlot && *EvictedSlot == Head)
+	{
+		Slots.Remove(Entry.Hash);
+	}
+
+	Entry.Hash = Hash;
+	Entry.SourceAddress = SourceAddress;
+	Entry.Time = Now;
+	Slots.Add(Hash, Head);
+	Head = (Head + 1) % Window.Num();
+
+	OutSourceKey = GetSourceKey(SourceAddress);
+	return true;
+}
+
+void FPSNRedundantMerge::Grow()
+{
+	// Unrolled oldest first, so the new free slots follow the newest entry
+	TArray<FEntry> Grown;
+	Grown.Reserve(Window.Num() * 2);
+	Grown.Append(Window.GetData() + Head, Window.Num() - Head);
+	Grown.Append(Window.GetData(), Head);
+	Head = Grown.Num();
+	Grown.SetNum(Window.Num() * 2);
+	Window = MoveTemp(Grown);
+
+	// Newest last, so a hash seen twice maps to its latest slot as before
+	Slots.Reset();
+	for (int32 Index = 0; Index < Head; Index++)
+	{
+		Slots.Add(Window[Index].Hash, Index);
+	}
+}
+
+uint32 FPSNRedundantMerge::GetSourceKey(uint32 SourceAddress) const
+{
+	// A stream first seen from a third address can leave a short chain, so follow a few links
+	uint32 Key = SourceAddress;
+	for (int32 Link = 0; Link < 4; Link++)
+	{
+		const uint32* Next = SourceKeys.Find(Key);
+		if (!Next)
+		{
+			break;
+		}
+		Key = *Next;
+	}
+	return Key;
+}
+
+void FPSNRedundantMerge::Reset()
+{
+	Window.Reset();
+	Window.SetNum(InitialWindowSize);
+	Slots.Reset();
+	Head = 0;
+	SourceKeys.Reset();
+}
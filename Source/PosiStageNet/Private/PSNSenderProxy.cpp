@@ -4,15 +4,21 @@
 #include "PSNSenderProxy.h"
 #include "PosiStageNet.h"
 #include "PSNStream.h"
+#include "PSNTrace.h"
 #include "Common/UdpSocketReceiver.h"
 #include "Common/UdpSocketBuilder.h"
+#include "HAL/Event.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/Thread.h"
+#include "Misc/ScopeLock.h"
 
 
-FPSNSenderProxy::FPSNSenderProxy(const FString& InClientName)
-	: Socket(FUdpSocketBuilder(*InClientName).Build())
+FPSNSenderProxy::FPSNSenderProxy(const FString& InClientName, FPSNSenderStats& InStats)
+	: Stats(InStats)
 	, psn_encoder(MakeUnique<::psn::psn_encoder>(TCHAR_TO_ANSI(*InClientName)))
 {
 	SenderName = InClientName;
+	BuildSockets();
 }
 
 void FPSNSenderProxy::GetSendIPAddress(FString& InIPAddress, int32& Port) const
@@ -40,76 +46,395 @@ bool FPSNSenderProxy::SetSendIPAddress(const FString& InIPAddress, const int32 P
 	return bIsValidAddress;
 }
 
+bool FPSNSenderProxy::SetSendInterfaces(const TArray<FString>& LocalAddresses)
+{
+	if (LocalAddresses.Num() > FPSNSenderStats::MaxInterfaces)
+	{
+		UE_LOG(LogPSN, Error, TEXT("PSNClient '%s' can send on at most %d interfaces, %d given."), *SenderName, FPSNSenderStats::MaxInterfaces, LocalAddresses.Num());
+		return false;
+	}
+
+	TArray<FIPv4Address> NewInterfaces;
+	for (const FString& LocalAddress : LocalAddresses)
+	{
+		FIPv4Address Address;
+		if (!FIPv4Address::Parse(LocalAddress, Address))
+		{
+			UE_LOG(LogPSN, Error, TEXT("PSNClient '%s' invalid send interface '%s'. Interfaces not updated."), *SenderName, *LocalAddress);
+			return false;
+		}
+		NewInterfaces.AddUnique(Address);
+	}
+
+	FScopeLock Lock(&SendLock);
+	if (bStopping)
+	{
+		return false;
+	}
+
+	DestroySockets();
+	Interfaces = MoveTemp(NewInterfaces);
+	BuildSockets();
+	return true;
+}
+
+void FPSNSenderProxy::BuildSockets()
+{
+	if (Interfaces.Num() == 0)
+	{
+		if (FSocket* DefaultSocket = FUdpSocketBuilder(*SenderName).Build())
+		{
+			Sockets.Add({ DefaultSocket, FIPv4Address::Any });
+		}
+	}
+	const double Now = FPlatformTime::Seconds();
+	for (const FIPv4Address& LocalAddress : Interfaces)
+	{
+		FSendSocket& SendSocket = Sockets.AddDefaulted_GetRef();
+		SendSocket.LocalAddress = LocalAddress;
+		SendSocket.Socket = CreateInterfaceSocket(LocalAddress);
+		if (SendSocket.Socket)
+		{
+			UE_LOG(LogPSN, Display, TEXT("PSNClient '%s' sending on interface %s."), *SenderName, *LocalAddress.ToString());
+		}
+		else
+		{
+			// Kept without a socket so the interface shows as unhealthy rather than disappearing, and retried from SendPacket
+			UE_LOG(LogPSN, Error, TEXT("PSNClient '%s' failed to create a socket on interface %s, retrying: %s"), *SenderName, *LocalAddress.ToString(), ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->GetSocketError());
+			SendSocket.RetrySeconds = MinRetrySeconds;
+			SendSocket.NextRetryTime = Now + SendSocket.RetrySeconds;
+		}
+	}
+
+	// Counters start again with the new interfaces, as a slot may now hold a different one
+	for (int32 Index = 0; Index < FPSNSenderStats::MaxInterfaces; Index++)
+	{
+		FPSNSendInterfaceStats& InterfaceStats = Stats.Interfaces[Index];
+		InterfaceStats.bActive = Index < Sockets.Num();
+		InterfaceStats.Address = Index < Sockets.Num() ? Sockets[Index].LocalAddress.Value : 0;
+		InterfaceStats.bHealthy = Index < Sockets.Num() && Sockets[Index].Socket != nullptr;
+		InterfaceStats.PacketsSent = 0;
+		InterfaceStats.BytesSent = 0;
+		InterfaceStats.SocketErrors = 0;
+		InterfaceStats.LastSendTime = 0.0;
+	}
+}
+
+FSocket* FPSNSenderProxy::CreateInterfaceSocket(const FIPv4Address& LocalAddress) const
+{
+	// Bound to the interface's address so unicast leaves through it, with the multicast interface set to match
+	return FUdpSocketBuilder(*FString::Printf(TEXT("%s_%s"), *SenderName, *LocalAddress.ToString()))
+		.BoundToAddress(LocalAddress)
+		.WithMulticastInterface(LocalAddress)
+		.Build();
+}
+
+void FPSNSenderProxy::DestroySockets()
+{
+	for (FSendSocket& SendSocket : Sockets)
+	{
+		if (SendSocket.Socket)
+		{
+			ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(SendSocket.Socket);
+		}
+	}
+	Sockets.Reset();
+
+	for (FPSNSendInterfaceStats& InterfaceStats : Stats.Interfaces)
+	{
+		InterfaceStats.bActive = false;
+	}
+}
+
+FPSNSenderProxy::~FPSNSenderProxy()
+{
+	Stop();
+}
+
 void FPSNSenderProxy::SendPSNData(TArray<FPSNTracker> TrackerData, uint64 Lifetime)
 {
-	ensure(psn_encoder);
+	TArray<FPSNTrackerRecord> Records;
+	Records.SetNum(TrackerData.Num());
+	for (int32 Index = 0; Index < TrackerData.Num(); Index++)
+	{
+		Records[Index].SetFromTracker(TrackerData[Index]);
+	}
+	EncodeAndSendData(Records, Lifetime);
+}
 
-	// Check socket
-	if (!Socket)
+void FPSNSenderProxy::SendPSNInfo(TArray<FPSNTracker> TrackerData, uint64 Lifetime)
+{
+	::psn::tracker_map Trackers;
+	for (const FPSNTracker& Tracker : TrackerData)
+	{
+		Trackers.emplace(Tracker.Info.ID, Tracker.GetAsNativeTracker());
+	}
+	EncodeAndSendInfo(Trackers, Lifetime);
+}
+
+void FPSNSenderProxy::PublishPSNData(TArray<FPSNTrackerRecord>& TrackerData, uint64 Lifetime)
+{
+	StartWorker();
+	{
+		FScopeLock Lock(&PublishLock);
+		if (bHasPendingData)
+		{
+			Stats.FramesSuperseded++;
+		}
+		Swap(PendingData, TrackerData);
+		PendingDataLifetime = Lifetime;
+		bHasPendingData = true;
+	}
+	WorkAvailable->Trigger();
+}
+
+void FPSNSenderProxy::PublishPSNInfo(uint64 Lifetime)
+{
+	StartWorker();
+	{
+		FScopeLock Lock(&PublishLock);
+		PendingInfoLifetime = Lifetime;
+		bHasPendingInfo = true;
+	}
+	WorkAvailable->Trigger();
+}
+
+void FPSNSenderProxy::SetTrackerName(int32 ID, const FString& Name)
+{
+	::std::string Utf8Name(TCHAR_TO_UTF8(*Name));
+
+	FScopeLock Lock(&PublishLock);
+	TrackerNames.Add(ID, MoveTemp(Utf8Name));
+	bTrackerNamesChanged = true;
+}
+
+void FPSNSenderProxy::RemoveTrackerName(int32 ID)
+{
+	FScopeLock Lock(&PublishLock);
+	bTrackerNamesChanged |= TrackerNames.Remove(ID) > 0;
+}
+
+void FPSNSenderProxy::StartWorker()
+{
+	if (Worker || bStopping)
 	{
-		UE_LOG(LogPSN, Error, TEXT("Socket has been closed, unable to send PSN data"));
 		return;
 	}
 
-	// Create Stream
-	FPSNStream Stream = FPSNStream(TrackerData.Num());
+	WorkAvailable = FPlatformProcess::GetSynchEventFromPool(false);
+	Worker = MakeUnique<FThread>(TEXT("PSNSender"), [this]() { WorkerLoop(); });
+}
+
+void FPSNSenderProxy::WorkerLoop()
+{
+	::psn::tracker_map NamedTrackers;
 
-	// Create Packet Variables
-	strlist data_packets, info_packets;
-		
-	// Encode data and info packets to PSN
-	Stream.EncodeToPSN(TrackerData, psn_encoder.Get(), data_packets, info_packets, Lifetime, false);
+	while (!bStopping)
+	{
+		WorkAvailable->Wait();
 
-	// Send Data
-	SendPacket(data_packets);
+		bool bSendInfo = false;
+		bool bSendData = false;
+		uint64 InfoLifetime = 0;
+		uint64 DataLifetime = 0;
+		{
+			FScopeLock Lock(&PublishLock);
+			if (bHasPendingInfo)
+			{
+				// Names only change on registration, so the native info trackers are rebuilt only then
+				if (bTrackerNamesChanged)
+				{
+					NamedTrackers.clear();
+					for (const TPair<int32, ::std::string>& Name : TrackerNames)
+					{
+						NamedTrackers.emplace((uint16_t)Name.Key, ::psn::tracker((uint16_t)Name.Key, Name.Value));
+					}
+					bTrackerNamesChanged = false;
+				}
+				InfoLifetime = PendingInfoLifetime;
+				bHasPendingInfo = false;
+				bSendInfo = true;
+			}
+			if (bHasPendingData)
+			{
+				Swap(PendingData, SendingData);
+				DataLifetime = PendingDataLifetime;
+				bHasPendingData = false;
+				bSendData = true;
+			}
+		}
+
+		if (bStopping)
+		{
+			break;
+		}
 
+		// Info first, so receivers know the names before the data that uses them
+		if (bSendInfo)
+		{
+			EncodeAndSendInfo(NamedTrackers, InfoLifetime);
+		}
+		if (bSendData)
+		{
+			EncodeAndSendData(SendingData, DataLifetime);
+		}
+	}
 }
 
-void FPSNSenderProxy::SendPSNInfo(TArray<FPSNTracker> TrackerData, uint64 Lifetime)
+void FPSNSenderProxy::EncodeAndSendData(const TArray<FPSNTrackerRecord>& TrackerData, uint64 Lifetime)
 {
+	ensure(psn_encoder);
+	FScopeLock Lock(&SendLock);
+
 	// Check socket
-	if (!Socket)
+	if (Sockets.Num() == 0)
 	{
 		UE_LOG(LogPSN, Error, TEXT("Socket has been closed, unable to send PSN data"));
 		return;
 	}
 
-	// Create Stream
-	FPSNStream Stream = FPSNStream(TrackerData.Num());
-
-	// Create Packet Variables
-	strlist data_packets, info_packets;
+	// Encode data packets to PSN
+	strlist data_packets;
+	const uint64 EncodeStart = FPlatformTime::Cycles64();
+	{
+		SCOPE_CYCLE_COUNTER(STAT_PSNEncode);
+		CSV_SCOPED_TIMING_STAT(PSN, Encode);
+		PSN_TRACE_SCOPE(PSN_Encode);
+		FPSNStream::UpdateNativeTrackers(TrackerData, DataTrackers);
+		data_packets = psn_encoder->encode_data(DataTrackers, Lifetime);
+	}
+	Stats.EncodeCycles += FPlatformTime::Cycles64() - EncodeStart;
+	Stats.LastPacketsPerFrame = (uint32)data_packets.size();
+	Stats.FramesSent++;
 
-	// Encode data and info packets to PSN
-	Stream.EncodeToPSN(TrackerData, psn_encoder.Get(), data_packets, info_packets, Lifetime, true);
+	const uint8 FrameID = psn_encoder->get_last_data_frame_id();
+	PSNTrace::FrameEncoded(FrameID, data_packets.size(), TrackerData.Num());
 
 	// Send Data
-	SendPacket(info_packets);
+	const int32 BytesSent = SendPacket(data_packets);
+	PSNTrace::FrameSent(FrameID, data_packets.size(), BytesSent);
+}
+
+void FPSNSenderProxy::EncodeAndSendInfo(const ::psn::tracker_map& Trackers, uint64 Lifetime)
+{
+	ensure(psn_encoder);
+	FScopeLock Lock(&SendLock);
+
+	// Check socket
+	if (Sockets.Num() == 0)
+	{
+		UE_LOG(LogPSN, Error, TEXT("Socket has been closed, unable to send PSN data"));
+		return;
+	}
+
+	SendPacket(psn_encoder->encode_info(Trackers, Lifetime));
 }
 
 void FPSNSenderProxy::Stop()
 {
-	if (Socket)
+	if (Worker)
 	{
-		ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(Socket);
-		Socket = nullptr;
+		bStopping = true;
+		WorkAvailable->Trigger();
+		Worker->Join();
+		Worker.Reset();
+		FPlatformProcess::ReturnSynchEventToPool(WorkAvailable);
+		WorkAvailable = nullptr;
 	}
+
+	FScopeLock Lock(&SendLock);
+	DestroySockets();
 }
 
-void FPSNSenderProxy::SendPacket(strlist packet)
+int32 FPSNSenderProxy::SendPacket(const strlist& packet)
 {
-	int32 BytesSent = 0;
+	SCOPE_CYCLE_COUNTER(STAT_PSNSend);
+	CSV_SCOPED_TIMING_STAT(PSN, SendTo);
+	PSN_TRACE_SCOPE(PSN_SendTo);
+	const uint64 SendStart = FPlatformTime::Cycles64();
+
+	int32 TotalBytesSent = 0;
+	const double SendTime = FPlatformTime::Seconds();
 
-	for (auto it = packet.begin(); it != packet.end(); ++it)
+	// The same encoded packets go out on every interface, so receivers can take whichever copy arrives first
+	for (int32 Index = 0; Index < Sockets.Num(); Index++)
 	{
-		int Length = it->length();
-		const uint8* msg_t = (const uint8*)it->c_str();
+		FPSNSendInterfaceStats* InterfaceStats = Index < FPSNSenderStats::MaxInterfaces ? &Stats.Interfaces[Index] : nullptr;
 
-		const bool bSendInfo = Socket->SendTo(msg_t, Length, BytesSent, *IPAddress);
+		// An interface that could not be bound is retried with a backoff, e.g. until its adapter comes up
+		FSendSocket& Interface = Sockets[Index];
+		if (!Interface.Socket)
+		{
+			if (SendTime < Interface.NextRetryTime)
+			{
+				continue;
+			}
+
+			Interface.Socket = CreateInterfaceSocket(Interface.LocalAddress);
+			if (!Interface.Socket)
+			{
+				Interface.RetrySeconds = FMath::Min(Interface.RetrySeconds * 2.0, MaxRetrySeconds);
+				Interface.NextRetryTime = SendTime + Interface.RetrySeconds;
+				continue;
+			}
+			UE_LOG(LogPSN, Display, TEXT("PSNClient '%s' bound interface %s after retrying, sending on it again."), *SenderName, *Interface.LocalAddress.ToString());
+			if (InterfaceStats)
+			{
+				// Set here so the health check below does not log the recovery a second time
+				InterfaceStats->bHealthy = true;
+			}
+		}
+		FSocket* const SendSocket = Interface.Socket;
+
+		int32 InterfaceBytesSent = 0;
+		bool bInterfaceFailed = false;
 
-		if (!bSendInfo)
+		for (auto it = packet.begin(); it != packet.end(); ++it)
 		{
-			UE_LOG(LogPSN, Error, TEXT("Failed to send Packets"));
+			int32 BytesSent = 0;
+			if (SendSocket->SendTo((const uint8*)it->c_str(), (int32)it->length(), BytesSent, *IPAddress))
+			{
+				Stats.PacketsSent++;
+				Stats.BytesSent += BytesSent;
+				InterfaceBytesSent += BytesSent;
+				if (InterfaceStats)
+				{
+					InterfaceStats->PacketsSent++;
+					InterfaceStats->BytesSent += BytesSent;
+				}
+			}
+			else
+			{
+				Stats.SocketErrors++;
+				bInterfaceFailed = true;
+				if (InterfaceStats)
+				{
+					InterfaceStats->SocketErrors++;
+				}
+			}
+		}
+
+		// Logged when an interface goes down or comes back rather than per packet, as a redundant link can stay down for a while
+		const bool bWasHealthy = InterfaceStats ? InterfaceStats->bHealthy.exchange(!bInterfaceFailed) : true;
+		if (bInterfaceFailed && bWasHealthy)
+		{
+			UE_LOG(LogPSN, Error, TEXT("PSNClient '%s' failed to send packets on %s: %s"), *SenderName, *Sockets[Index].LocalAddress.ToString(), ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->GetSocketError());
+		}
+		else if (!bInterfaceFailed && !bWasHealthy)
+		{
+			UE_LOG(LogPSN, Display, TEXT("PSNClient '%s' is sending on %s again."), *SenderName, *Sockets[Index].LocalAddress.ToString());
+		}
+
+		if (!bInterfaceFailed && InterfaceStats)
+		{
+			InterfaceStats->LastSendTime = SendTime;
+		}
+		if (TotalBytesSent == 0)
+		{
+			TotalBytesSent = InterfaceBytesSent;
 		}
 	}
+
+	Stats.SendCycles += FPlatformTime::Cycles64() - SendStart;
+	return TotalBytesSent;
 }
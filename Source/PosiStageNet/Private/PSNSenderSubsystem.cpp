@@ -3,7 +3,10 @@
 
 #include "PSNSenderSubsystem.h"
 #include "PosiStageNet.h"
-#include "psn/psn_defs.hpp"
+#include "PSNTrace.h"
+#include "PSNOrientation.h"
+#include "PSNHealthEndpoint.h"
+#include "PSN/psn_defs.hpp"
 
 #include "Sockets.h"
 #include "IPAddress.h"
@@ -11,13 +14,85 @@
 
 #include "TimerManager.h"
 #include "Engine/World.h"
+#include "Engine/Level.h"
+#include "Physics/Experimental/PhysScene_Chaos.h"
 #include "Components/SceneComponent.h" // Scene Components for Tracker
 #include "Kismet/KismetSystemLibrary.h"
 #include "Kismet/KismetMathLibrary.h"
+#include "Async/ParallelFor.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/App.h"
+#include "Misc/ScopeExit.h"
+
+namespace PSNSender
+{
+	static int32 ParallelSampleThreshold = 128;
+	static FAutoConsoleVariableRef CVarParallelSampleThreshold(
+		TEXT("psn.Sender.ParallelSampleThreshold"),
+		ParallelSampleThreshold,
+		TEXT("Number of tracked components from which the sender reads transforms in parallel."));
+}
+
+void FPSNMotionHistory::Push(const FVector& Position, double Time)
+{
+	if (Count > 0 && Time <= Times[0])
+	{
+		Positions[0] = Position;
+		return;
+	}
+
+	for (int32 Index = NumSamples - 1; Index > 0; Index--)
+	{
+		Positions[Index] = Positions[Index - 1];
+		Times[Index] = Times[Index - 1];
+	}
+	Positions[0] = Position;
+	Times[0] = Time;
+	Count = FMath::Min(Count + 1, NumSamples);
+}
+
+FVector FPSNMotionHistory::GetVelocity() const
+{
+	if (Count < 2)
+	{
+		return FVector::ZeroVector;
+	}
+	return (Positions[0] - Positions[1]) / (Times[0] - Times[1]);
+}
+
+FVector FPSNMotionHistory::GetAcceleration() const
+{
+	if (Count < 3)
+	{
+		return FVector::ZeroVector;
+	}
+
+	// Second difference for unevenly spaced samples
+	const FVector Newer = (Positions[0] - Positions[1]) / (Times[0] - Times[1]);
+	const FVector Older = (Positions[1] - Positions[2]) / (Times[1] - Times[2]);
+	return (Newer - Older) / ((Times[0] - Times[2]) * 0.5);
+}
+
+void FPSNSenderTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (Target)
+	{
+		Target->OnSampleTick();
+	}
+}
+
+FString FPSNSenderTickFunction::DiagnosticMessage()
+{
+	return TEXT("UPSNSenderSubsystem::SampleTick");
+}
 
 UPSNSenderSubsystem::UPSNSenderSubsystem()
 	: SenderPtr(nullptr)
 {
+	SampleTickFunction.bCanEverTick = true;
+	SampleTickFunction.bStartWithTickEnabled = true;
+	SampleTickFunction.bTickEvenWhenPaused = true;
+	SampleTickFunction.bAllowTickOnDedicatedServer = true;
 }
 
 void UPSNSenderSubsystem::Tick(float DeltaTime)
@@ -30,7 +105,8 @@ void UPSNSenderSubsystem::Tick(float DeltaTime)
 
 bool UPSNSenderSubsystem::IsTickable() const
 {
-	return (TrackerMap.Num() > 0 || ComponentMap.Num() > 0) && SenderPtr && ChosenFrequency == EPSNFrequency::PSN_OnTick;
+	// Falls back to sending from here when there is no world to register the sample tick with
+	return (TrackerMap.Num() > 0 || ComponentTracks.Num() > 0) && SenderPtr && ChosenFrequency == EPSNFrequency::PSN_OnTick && !SampleTickFunction.IsTickFunctionRegistered();
 }
 
 TStatId UPSNSenderSubsystem::GetStatId() const
@@ -41,11 +117,22 @@ TStatId UPSNSenderSubsystem::GetStatId() const
 void UPSNSenderSubsystem::Initialize(FSubsystemCollectionBase& Collection)
 {
 	Super::Initialize(Collection);
+	ResetClockOrigin();
+	SampleTickFunction.Target = this;
+	WorldCleanupHandle = FWorldDelegates::OnWorldCleanup.AddUObject(this, &UPSNSenderSubsystem::OnWorldCleanup);
 }
 
 void UPSNSenderSubsystem::Deinitialize()
 {
 	Super::Deinitialize();
+	UnregisterSampling();
+	FWorldDelegates::OnWorldCleanup.Remove(WorldCleanupHandle);
+	FPSNHealthEndpoint::Get().UnregisterSender(&Stats);
+
+	if (SenderPtr)
+	{
+		SenderPtr->Stop();
+	}
 }
 
 void UPSNSenderSubsystem::StartPSNSender(FString IPAddress /*= TEXT("236.10.10.10")*/, int32 Port /*= 56565*/, const FString& SystemName /*= "Unreal Engine"*/, EPSNFrequency Frequency /*= EPSNFrequency::PSN_60Hz*/, bool ForceReset /*= true*/)
@@ -56,9 +143,16 @@ void UPSNSenderSubsystem::StartPSNSender(FString IPAddress /*= TEXT("236.10.10.1
 	}
 
 	ChosenSystemName = SystemName;
-	SenderPtr.Reset(new FPSNSenderProxy(SystemName));
+	SenderPtr.Reset(new FPSNSenderProxy(SystemName, Stats));
 	SenderPtr->SetSendIPAddress(IPAddress, Port);
+	if (SendInterfaces.Num() > 0)
+	{
+		SenderPtr->SetSendInterfaces(SendInterfaces);
+	}
+	RegisterTrackerNames();
 	ChosenFrequency = Frequency;
+	ResetClockOrigin();
+	FPSNHealthEndpoint::Get().RegisterSender(SystemName, &Stats);
 	
 	check(GetWorld());
 	FTimerManager& TimerManager = GetWorld()->GetTimerManager();
@@ -87,6 +181,12 @@ void UPSNSenderSubsystem::StartPSNSender(FString IPAddress /*= TEXT("236.10.10.1
 		// Start timer for Data Packet.
 		TimerManager.SetTimer(TimerDataPacket, this, &UPSNSenderSubsystem::SendData, TimerTime, true);
 	}
+	else
+	{
+		TimerManager.ClearTimer(TimerDataPacket);
+	}
+
+	RegisterSampling();
 
 	// Start Info Packet Timer. Hard-Coded at 1Hz
 	TimerManager.SetTimer(TimerInfoPacket, this, &UPSNSenderSubsystem::SendInfo, 1.f, true);
@@ -95,8 +195,49 @@ void UPSNSenderSubsystem::StartPSNSender(FString IPAddress /*= TEXT("236.10.10.1
 
 void UPSNSenderSubsystem::AddTracker(FPSNTrackerInfo TrackerInfo)
 {
+	const FName TrackerName(*TrackerInfo.Name);
+	const FPSNTracker* Existing = TrackerMap.Find(TrackerName);
+
+	// Adding a name again replaces that tracker, keeping or moving its ID
+	if (!Existing || Existing->Info.ID != TrackerInfo.ID)
+	{
+		if (!ClaimTrackerID(TrackerInfo))
+		{
+			return;
+		}
+		if (Existing)
+		{
+			TrackerIDs.Free(Existing->Info.ID);
+			if (SenderPtr)
+			{
+				SenderPtr->RemoveTrackerName(Existing->Info.ID);
+			}
+		}
+	}
+
 	TrackerInfo.SystemName = ChosenSystemName;
-	TrackerMap.Add(FName(*TrackerInfo.Name), FPSNTracker(TrackerInfo));
+	TrackerMap.Add(TrackerName, FPSNTracker(TrackerInfo));
+	if (SenderPtr)
+	{
+		SenderPtr->SetTrackerName(TrackerInfo.ID, TrackerInfo.Name);
+	}
+}
+
+bool UPSNSenderSubsystem::RemoveTracker(FName TrackerName)
+{
+	FPSNTracker Removed;
+	if (!TrackerMap.RemoveAndCopyValue(TrackerName, Removed))
+	{
+		return false;
+	}
+
+	TrackerIDs.Free(Removed.Info.ID);
+	if (SenderPtr)
+	{
+		SenderPtr->RemoveTrackerName(Removed.Info.ID);
+	}
+	RefreshInfo();
+	return true;
 }
 
 void UPSNSenderSubsystem::UpdateTracker(FName TrackerName, FPSNTrackerData NewData)
@@ -104,14 +245,8 @@ void UPSNSenderSubsystem::UpdateTracker(FName TrackerName, FPSNTrackerData NewDa
 	FPSNTracker* T = TrackerMap.Find(TrackerName);
 	if (T)
 	{
-		FPSNTrackerInfo NewMeta(T->Info.ID, T->Info.Name);
-		FPSNTracker NewTracker(NewMeta, NewData);
-		NewTracker.Header.Timestamp = GetTimestamp();
-
-		// Convert from CM to M
-		NewTracker.Data.Position *= 0.01;
-		NewTracker.Data.TargetPosition *= 0.01;
-		TrackerMap.Emplace(TrackerName, NewTracker);
+		// Kept in Unreal space, converted with the rest of the frame in BuildTrackerList
+		T->Data = NewData;
 	}
 }
 
@@ -119,25 +254,258 @@ void UPSNSenderSubsystem::AddComponentToTrack(FPSNTrackerInfo Meta, USceneCompon
 {
 	if (Component)
 	{
-		ComponentMap.Add(Meta, Component);
+		const int32* TrackIndex = ComponentTrackIndices.Find(Meta);
+		FPSNComponentTrack* Track = TrackIndex ? &ComponentTracks[*TrackIndex] : nullptr;
+		if (!Track)
+		{
+			if (!ClaimTrackerID(Meta))
+			{
+				return;
+			}
+			ComponentTrackIndices.Add(Meta, ComponentTracks.Num());
+			Track = &ComponentTracks.AddDefaulted_GetRef();
+			Track->Info = Meta;
+			if (SenderPtr)
+			{
+				SenderPtr->SetTrackerName(Meta.ID, Meta.Name);
+			}
+		}
+		Track->Component = Component;
+		Track->History = FPSNMotionHistory();
 	}
 }
 
-uint64 UPSNSenderSubsystem::GetTimestamp()
+void UPSNSenderSubsystem::SetCoordinateSpace(UPSNCoordinateSpace* Space)
+{
+	SendTransform = Space ? Space->MakeTransform().Inverse() : FPSNCoordinateTransform(0.01f);
+}
+
+void UPSNSenderSubsystem::SetTimestampSource(EPSNTimestampSource Source)
+{
+	TimestampSource = Source;
+	ResetClockOrigin();
+}
+
+void UPSNSenderSubsystem::ResetClockOrigin()
+{
+	MonotonicOrigin = FPlatformTime::Seconds();
+	CustomTimeStepOrigin = FApp::GetCurrentTime();
+}
+
+bool UPSNSenderSubsystem::RemoveComponentToTrack(USceneComponent* Component)
 {
-	return ((double)UKismetSystemLibrary::GetGameTimeInSeconds(this)) * 1e+6;
+	// Samples are parallel to the tracks, so remove from both while they are in step
+	const bool bSamplesInStep = ComponentTrackers.Num() == ComponentTracks.Num();
+
+	bool bRemoved = false;
+	for (int32 Index = ComponentTracks.Num() - 1; Index >= 0; Index--)
+	{
+		if (ComponentTracks[Index].Component.Get() == Component)
+		{
+			TrackerIDs.Free(ComponentTracks[Index].Info.ID);
+			if (SenderPtr)
+			{
+				SenderPtr->RemoveTrackerName(ComponentTracks[Index].Info.ID);
+			}
+			ComponentTracks.RemoveAt(Index);
+			if (bSamplesInStep)
+			{
+				ComponentTrackers.RemoveAt(Index);
+			}
+			bRemoved = true;
+		}
+	}
+
+	if (bRemoved)
+	{
+		// Removal shifts the tracks after it, so their indices are rebuilt
+		ComponentTrackIndices.Reset();
+		for (int32 Index = 0; Index < ComponentTracks.Num(); Index++)
+		{
+			ComponentTrackIndices.Add(ComponentTracks[Index].Info, Index);
+		}
+		RefreshInfo();
+	}
+	return bRemoved;
+}
+
+bool UPSNSenderSubsystem::ClaimTrackerID(const FPSNTrackerInfo& Info)
+{
+	if (TrackerIDs.Allocate(Info.ID))
+	{
+		return true;
+	}
+
+	if (Info.ID < 0 || Info.ID >= FPSNIDAllocator::NumIDs)
+	{
+		UE_LOG(LogPSN, Warning, TEXT("PSN tracker '%s' has ID %d, outside the PSN range 0-65535. It will not be sent."), *Info.Name, Info.ID);
+	}
+	else
+	{
+		UE_LOG(LogPSN, Warning, TEXT("PSN tracker '%s' has ID %d, which is already in use. It will not be sent. Use FindFreeID to pick an unused ID."), *Info.Name, Info.ID);
+	}
+	return false;
+}
+
+void UPSNSenderSubsystem::RegisterTrackerNames()
+{
+	for (const TPair<FName, FPSNTracker>& T : TrackerMap)
+	{
+		SenderPtr->SetTrackerName(T.Value.Info.ID, T.Value.Info.Name);
+	}
+	for (const FPSNComponentTrack& Track : ComponentTracks)
+	{
+		SenderPtr->SetTrackerName(Track.Info.ID, Track.Info.Name);
+	}
+}
+
+void UPSNSenderSubsystem::RefreshInfo()
+{
+	if (SenderPtr)
+	{
+		SendInfo();
+	}
+}
+
+uint64 UPSNSenderSubsystem::SampleTimestamp() const
+{
+	double Seconds = 0.0;
+	switch (TimestampSource)
+	{
+	case EPSNTimestampSource::PSN_Timecode:
+		Seconds = FApp::GetTimecode().ToTimespan(FApp::GetTimecodeFrameRate()).GetTotalSeconds();
+		break;
+	case EPSNTimestampSource::PSN_CustomTimeStep:
+		Seconds = FApp::GetCurrentTime() - CustomTimeStepOrigin;
+		break;
+	case EPSNTimestampSource::PSN_GameTime:
+		Seconds = UKismetSystemLibrary::GetGameTimeInSeconds(this);
+		break;
+	default:
+		Seconds = FPlatformTime::Seconds() - MonotonicOrigin;
+		break;
+	}
+
+	return (uint64)(FMath::Max(Seconds, 0.0) * 1e+6);
+}
+
+void UPSNSenderSubsystem::SetSampleTickGroup(TEnumAsByte<ETickingGroup> TickGroup)
+{
+	SampleTickGroup = TickGroup;
+	if (SampleTickFunction.IsTickFunctionRegistered())
+	{
+		UnregisterSampling();
+		RegisterSampling();
+	}
+}
+
+void UPSNSenderSubsystem::SetSampleOnPhysicsTick(bool bEnable)
+{
+	bSampleOnPhysicsTick = bEnable;
+	if (SampleTickFunction.IsTickFunctionRegistered())
+	{
+		UnregisterSampling();
+		RegisterSampling();
+	}
+}
+
+void UPSNSenderSubsystem::RegisterSampling()
+{
+	UWorld* World = GetWorld();
+	if (!SenderPtr || !World || !World->PersistentLevel || SamplingWorld.Get() == World)
+	{
+		return;
+	}
+
+	UnregisterSampling();
+	SamplingWorld = World;
+
+	SampleTickFunction.TickGroup = SampleTickGroup;
+	SampleTickFunction.EndTickGroup = SampleTickGroup;
+	SampleTickFunction.RegisterTickFunction(World->PersistentLevel);
+
+	if (bSampleOnPhysicsTick)
+	{
+		if (FPhysScene* PhysScene = World->GetPhysicsScene())
+		{
+			PhysicsPostTickHandle = PhysScene->OnPhysScenePostTick.AddUObject(this, &UPSNSenderSubsystem::OnPhysicsPostTick);
+		}
+		else
+		{
+			UE_LOG(LogPSN, Warning, TEXT("PSN Sender: world '%s' has no physics scene to sample on, sampling in the tick group instead."), *World->GetName());
+		}
+	}
+}
+
+void UPSNSenderSubsystem::UnregisterSampling()
+{
+	if (SampleTickFunction.IsTickFunctionRegistered())
+	{
+		SampleTickFunction.UnRegisterTickFunction();
+	}
+
+	if (UWorld* World = SamplingWorld.Get())
+	{
+		if (FPhysScene* PhysScene = World->GetPhysicsScene())
+		{
+			PhysScene->OnPhysScenePostTick.Remove(PhysicsPostTickHandle);
+		}
+	}
+	PhysicsPostTickHandle.Reset();
+	SamplingWorld.Reset();
+}
+
+void UPSNSenderSubsystem::OnWorldCleanup(UWorld* World, bool bSessionEnded, bool bCleanupResources)
+{
+	// The tick function lives in the world's level, so it has to go before the level does. The next send registers with the new world.
+	if (World == SamplingWorld.Get())
+	{
+		UnregisterSampling();
+	}
+}
+
+bool UPSNSenderSubsystem::IsSamplingEachFrame() const
+{
+	return SampleTickFunction.IsTickFunctionRegistered();
+}
+
+void UPSNSenderSubsystem::OnSampleTick()
+{
+	// Without a physics hook, e.g. in a world with no physics scene, nothing else would sample
+	if (!bSampleOnPhysicsTick || !PhysicsPostTickHandle.IsValid())
+	{
+		SampleFrame();
+	}
+
+	if (ChosenFrequency == EPSNFrequency::PSN_OnTick && SenderPtr && (TrackerMap.Num() > 0 || ComponentTracks.Num() > 0))
+	{
+		SendData();
+	}
+}
+
+void UPSNSenderSubsystem::OnPhysicsPostTick(FChaosScene* Scene)
+{
+	SampleFrame();
+}
+
+void UPSNSenderSubsystem::SampleFrame()
+{
+	FrameTimestamp = SampleTimestamp();
+	SampleComponents();
 }
 
 void UPSNSenderSubsystem::SendData()
 {
+	RegisterSampling();
 	BuildTrackerList();
-	SenderPtr->SendPSNData(TrackerList, GetTimestamp());
+	SenderPtr->PublishPSNData(TrackerList, FrameTimestamp);
+	Stats.Publish();
 }
 
 void UPSNSenderSubsystem::SendInfo()
 {
-	BuildTrackerList();
-	SenderPtr->SendPSNInfo(TrackerList, GetTimestamp());
+	RegisterSampling();
+	SenderPtr->PublishPSNInfo(SampleTimestamp());
 }
 
 bool UPSNSenderSubsystem::IsSenderRunning()
@@ -147,18 +515,63 @@ bool UPSNSenderSubsystem::IsSenderRunning()
 
 int UPSNSenderSubsystem::FindFreeID(int StartFrom)
 {
-	BuildTrackerList();
-	int Start = StartFrom--;
-	bool Checking = true;
-	int FoundID = -1;
+	return TrackerIDs.FindFirstFree(FMath::Max(StartFrom, 1));
+}
+
+bool UPSNSenderSubsystem::IsIDInUse(int ID) const
+{
+	return TrackerIDs.IsAllocated(ID);
+}
 
-	while (Checking)
+bool UPSNSenderSubsystem::SetSendInterfaces(const TArray<FString>& LocalAddresses)
+{
+	if (SenderPtr && !SenderPtr->SetSendInterfaces(LocalAddresses))
 	{
-		FoundID = CheckAvailableID(Start++);
-		Checking = FoundID < 1;
+		return false;
 	}
 
-	return FoundID;
+	SendInterfaces = LocalAddresses;
+	return true;
+}
+
+void UPSNSenderSubsystem::GetLocalInterfaceAddresses(TArray<FString>& OutAddresses) const
+{
+	OutAddresses.Reset();
+
+	TArray<TSharedPtr<FInternetAddr>> Addresses;
+	ISocketSubsystem* SocketSys = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+	if (SocketSys && SocketSys->GetLocalAdapterAddresses(Addresses))
+	{
+		const bool bAppendPort = false;
+		for (const TSharedPtr<FInternetAddr>& Address : Addresses)
+		{
+			if (Address.IsValid() && Address->GetProtocolType() == FNetworkProtocolTypes::IPv4)
+			{
+				OutAddresses.AddUnique(Address->ToString(bAppendPort));
+			}
+		}
+	}
+}
+
+void UPSNSenderSubsystem::GetSendInterfaceStatus(TArray<FPSNSendInterfaceStatus>& OutStatus) const
+{
+	OutStatus.Reset();
+	const double Now = FPlatformTime::Seconds();
+	for (const FPSNSendInterfaceStats& Interface : Stats.Interfaces)
+	{
+		if (!Interface.bActive)
+		{
+			continue;
+		}
+
+		FPSNSendInterfaceStatus& Status = OutStatus.AddDefaulted_GetRef();
+		Status.Address = FIPv4Address(Interface.Address.load()).ToString();
+		Status.bHealthy = Interface.bHealthy;
+		Status.PacketsSent = (int64)Interface.PacketsSent.load();
+		Status.SocketErrors = (int64)Interface.SocketErrors.load();
+		const double LastSendTime = Interface.LastSendTime.load();
+		Status.SecondsSinceLastSend = LastSendTime > 0.0 ? (float)(Now - LastSendTime) : -1.f;
+	}
 }
 
 bool UPSNSenderSubsystem::GetLocalHostAddress(FString& Address)
@@ -185,54 +598,89 @@ bool UPSNSenderSubsystem::GetLocalHostAddress(FString& Address)
 
 void UPSNSenderSubsystem::BuildTrackerList()
 {
+	PSN_TRACE_SCOPE(PSN_BuildTrackerList);
+	const uint64 BuildStart = FPlatformTime::Cycles64();
+	ON_SCOPE_EXIT
+	{
+		Stats.BuildCycles += FPlatformTime::Cycles64() - BuildStart;
+		Stats.TrackerListBuilds++;
+	};
+
 	// Temporary List for all our trackers, both components and manually added.
-	TrackerList.Empty();
+	TrackerList.Reset(TrackerMap.Num() + ComponentTracks.Num());
 
-	// Push the TrackerMap into the new TrackerList
-	TrackerMap.GenerateValueArray(TrackerList);
+	// Push the TrackerMap into the new TrackerList. Data frames carry IDs only, names go in the info packet.
+	for (const TPair<FName, FPSNTracker>& T : TrackerMap)
+	{
+		TrackerList.AddDefaulted_GetRef().SetFromTracker(T.Value);
+	}
 
-	// Run the Component system automation
-	for (TPair<FPSNTrackerInfo, USceneComponent*> C : ComponentMap)
+	// Run the Component system automation. When sampling each frame the latest samples are used, unless components were added since.
+	if (!IsSamplingEachFrame() || ComponentTrackers.Num() != ComponentTracks.Num())
 	{
-		if (const USceneComponent* Comp = C.Value)
-		{
-			FPSNTracker Tracker;
-			Tracker.Info = C.Key;
-			Tracker.Data.Position = (Comp->GetComponentLocation() * 0.01); // convert from cm to m
-			Tracker.Data.Orientation = Comp->GetComponentRotation();
-			Tracker.Data.Speed = Comp->GetComponentVelocity();
-			Tracker.Data.Acceleration = Comp->GetComponentVelocity();
-			Tracker.Data.Status = 1;
-			Tracker.Data.TargetPosition = FVector::ZeroVector;
-			Tracker.Header.Timestamp = GetTimestamp();
-			TrackerList.Add(Tracker);
-		}
-		// If component is NULL, send a default tracker with 0 status so that we keep the stream consistent
-		else
-		{
-			FPSNTracker Tracker;
-			Tracker.Info = C.Key;
-			FPSNTrackerData Data;
-			Data.Status = 0;
-			TrackerList.Add(Tracker);
-		}
+		SampleFrame();
 	}
+	TrackerList.Append(ComponentTrackers);
 
-	// Push the system name into the list. This could be done at other places in a future update
-	for (auto T : TrackerList)
+	// Push the frame timestamp into the list, so every tracker in a frame carries the same time
+	for (FPSNTrackerRecord& T : TrackerList)
 	{
-		T.Info.SystemName = ChosenSystemName;
+		T.Timestamp = FrameTimestamp;
 	}
+
+	// cm to meters and the receiver's coordinate space in one pass
+	SendTransform.Apply(TrackerList);
 }
 
-int UPSNSenderSubsystem::CheckAvailableID(int InID)
+void UPSNSenderSubsystem::SampleComponents()
 {
-	for (auto T : TrackerList)
+	PSN_TRACE_SCOPE(PSN_SampleComponents);
+
+	const int32 NumComponents = ComponentTracks.Num();
+	ComponentTrackers.SetNum(NumComponents, false);
+	ComponentRotations.SetNumUninitialized(NumComponents, false);
+	if (NumComponents == 0)
 	{
-		if (T.Info.ID == InID)
+		return;
+	}
+
+	// Weak pointers are resolved here, so the workers only read transforms
+	ResolvedComponents.SetNumUninitialized(NumComponents, false);
+	for (int32 Index = 0; Index < NumComponents; Index++)
+	{
+		ResolvedComponents[Index] = ComponentTracks[Index].Component.Get();
+	}
+
+	const double Time = FrameTimestamp * 1e-6;
+
+	ParallelFor(NumComponents, [this, Time](int32 Index)
+	{
+		FPSNComponentTrack& Track = ComponentTracks[Index];
+		FPSNTrackerRecord& Tracker = ComponentTrackers[Index];
+		Tracker = FPSNTrackerRecord();
+		Tracker.ID = (uint16)Track.Info.ID;
+		Tracker.Fields = EPSNTrackerField::All;
+
+		if (const USceneComponent* Comp = ResolvedComponents[Index])
 		{
-			return -1;
+			const FTransform& Transform = Comp->GetComponentTransform();
+			const FVector Position = Transform.GetLocation();
+			Tracker.Position = FVector3f(Position);
+			ComponentRotations[Index] = FQuat4f(Transform.GetRotation());
+
+			// Speed and acceleration are sent in m/s
+			Track.History.Push(Position * 0.01, Time);
+			Tracker.Speed = FVector3f(Track.History.GetVelocity());
+			Tracker.Acceleration = FVector3f(Track.History.GetAcceleration());
+			Tracker.Status = 1.f;
 		}
-	}
-	return InID;
+		// If component is NULL, send a default tracker with 0 status so that we keep the stream consistent
+		else
+		{
+			ComponentRotations[Index] = FQuat4f::Identity;
+			Track.History = FPSNMotionHistory();
+		}
+	}, NumComponents < PSNSender::ParallelSampleThreshold ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+
+	PSNOrientation::QuatsToAxisAngles(ComponentRotations.GetData(), &ComponentTrackers[0].Orientation, sizeof(FPSNTrackerRecord), NumComponents);
 }
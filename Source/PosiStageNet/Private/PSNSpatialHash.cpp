@@ -0,0 +1,277 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+
+#include "PSNSpatialHash.h"
+
+FPSNSpatialHash::FPSNSpatialHash(float InCellSize)
+{
+	CellSize = FMath::Max(InCellSize, 1.f);
+	InvCellSize = 1.f / CellSize;
+}
+
+void FPSNSpatialHash::SetCellSize(float InCellSize)
+{
+	InCellSize = FMath::Max(InCellSize, 1.f);
+	if (InCellSize == CellSize)
+	{
+		return;
+	}
+
+	TArray<FCellItem> Items;
+	Items.Reserve(Entries.Num());
+	for (const TPair<FIntVector, TArray<FCellItem>>& Cell : Cells)
+	{
+		Items.Append(Cell.Value);
+	}
+
+	Reset();
+	CellSize = InCellSize;
+	InvCellSize = 1.f / CellSize;
+	for (const FCellItem& Item : Items)
+	{
+		Update(Item.ID, Item.Position);
+	}
+}
+
+void FPSNSpatialHash::Update(int32 ID, const FVector3f& Position)
+{
+	const FIntVector Cell = ToCell(FVector(Position));
+	FEntry* Entry = Entries.Find(ID);
+	if (!Entry)
+	{
+		FEntry& Added = Entries.Add(ID);
+		Added.Cell = Cell;
+		AddToCell(ID, Position, Added);
+		return;
+	}
+
+	// Staying in the same cell only moves the stored position
+	if (Entry->Cell == Cell)
+	{
+		Cells.FindChecked(Cell)[Entry->Slot].Position = Position;
+		return;
+	}
+
+	RemoveFromCell(*Entry);
+	Entry->Cell = Cell;
+	AddToCell(ID, Position, *Entry);
+}
+
+void FPSNSpatialHash::Remove(int32 ID)
+{
+	FEntry Removed;
+	if (Entries.RemoveAndCopyValue(ID, Removed))
+	{
+		RemoveFromCell(Removed);
+	}
+}
+
+void FPSNSpatialHash::Reset()
+{
+	Entries.Reset();
+	Cells.Reset();
+}
+
+bool FPSNSpatialHash::GetPosition(int32 ID, FVector3f& OutPosition) const
+{
+	const FEntry* Entry = Entries.Find(ID);
+	if (!Entry)
+	{
+		return false;
+	}
+
+	OutPosition = Cells.FindChecked(Entry->Cell)[Entry->Slot].Position;
+	return true;
+}
+
+FIntVector FPSNSpatialHash::ToCell(const FVector& Position) const
+{
+	return FIntVector(
+		FMath::FloorToInt(Position.X * InvCellSize),
+		FMath::FloorToInt(Position.Y * InvCellSize),
+		FMath::FloorToInt(Position.Z * InvCellSize));
+}
+
+void FPSNSpatialHash::AddToCell(int32 ID, const FVector3f& Position, FEntry& Entry)
+{
+	Entry.Slot = Cells.FindOrAdd(Entry.Cell).Add({ ID, Position });
+}
+
+void FPSNSpatialHash::RemoveFromCell(const FEntry& Entry)
+{
+	TArray<FCellItem>& Items = Cells.FindChecked(Entry.Cell);
+	Items.RemoveAtSwap(Entry.Slot, 1, false);
+
+	// The last tracker of the cell took the freed slot
+	if (Entry.Slot < Items.Num())
+	{
+		Entries.FindChecked(Items[Entry.Slot].ID).Slot = Entry.Slot;
+	}
+	else if (Items.Num() == 0)
+	{
+		Cells.Remove(Entry.Cell);
+	}
+}
+
+template<typename VisitorType>
+void FPSNSpatialHash::ForEachInCells(const FIntVector& MinCell, const FIntVector& MaxCell, VisitorType&& Visitor) const
+{
+	const int64 NumCells = (int64)(MaxCell.X - MinCell.X + 1) * (MaxCell.Y - MinCell.Y + 1) * (MaxCell.Z - MinCell.Z + 1);
+
+	// A range larger than the occupied cells is cheaper to answer by walking the occupied cells
+	if (NumCells > Cells.Num())
+	{
+		for (const TPair<FIntVector, TArray<FCellItem>>& Cell : Cells)
+		{
+			const FIntVector& Key = Cell.Key;
+			if (Key.X >= MinCell.X && Key.X <= MaxCell.X && Key.Y >= MinCell.Y && Key.Y <= MaxCell.Y && Key.Z >= MinCell.Z && Key.Z <= MaxCell.Z)
+			{
+				for (const FCellItem& Item : Cell.Value)
+				{
+					Visitor(Item);
+				}
+			}
+		}
+		return;
+	}
+
+	for (int32 X = MinCell.X; X <= MaxCell.X; X++)
+	{
+		for (int32 Y = MinCell.Y; Y <= MaxCell.Y; Y++)
+		{
+			for (int32 Z = MinCell.Z; Z <= MaxCell.Z; Z++)
+			{
+				if (const TArray<FCellItem>* Items = Cells.Find(FIntVector(X, Y, Z)))
+				{
+					for (const FCellItem& Item : *Items)
+					{
+						Visitor(Item);
+					}
+				}
+			}
+		}
+	}
+}
+
+void FPSNSpatialHash::QueryRadius(const FVector& Center, float Radius, TArray<int32>& OutIDs) const
+{
+	OutIDs.Reset();
+	if (Radius < 0.f)
+	{
+		return;
+	}
+
+	const FVector3f Center3f(Center);
+	const float RadiusSq = Radius * Radius;
+	ForEachInCells(ToCell(Center - FVector(Radius)), ToCell(Center + FVector(Radius)), [&](const FCellItem& Item)
+	{
+		if (FVector3f::DistSquared(Item.Position, Center3f) <= RadiusSq)
+		{
+			OutIDs.Add(Item.ID);
+		}
+	});
+}
+
+void FPSNSpatialHash::QueryBox(const FBox& Box, TArray<int32>& OutIDs) const
+{
+	OutIDs.Reset();
+	if (!Box.IsValid)
+	{
+		return;
+	}
+
+	ForEachInCells(ToCell(Box.Min), ToCell(Box.Max), [&](const FCellItem& Item)
+	{
+		if (Box.IsInsideOrOn(FVector(Item.Position)))
+		{
+			OutIDs.Add(Item.ID);
+		}
+	});
+}
+
+void FPSNSpatialHash::QueryNearest(const FVector& Location, int32 Count, TArray<int32>& OutIDs, float MaxDistance) const
+{
+	OutIDs.Reset();
+	if (Count <= 0 || Entries.Num() == 0)
+	{
+		return;
+	}
+
+	const FVector3f Location3f(Location);
+	const float MaxDistSq = MaxDistance > 0.f ? MaxDistance * MaxDistance : MAX_flt;
+
+	// (squared distance, ID)
+	TArray<TPair<float, int32>, TInlineAllocator<32>> Candidates;
+	const auto Consider = [&](const FCellItem& Item)
+	{
+		const float DistSq = FVector3f::DistSquared(Item.Position, Location3f);
+		if (DistSq <= MaxDistSq)
+		{
+			Candidates.Emplace(DistSq, Item.ID);
+		}
+	};
+
+	// Search shells of cells outwards. Anything outside shell R is at least R cells away.
+	const FIntVector Center = ToCell(Location);
+	int32 Seen = 0;
+	for (int32 Ring = 0; ; Ring++)
+	{
+		// Once a shell holds more cells than are occupied, checking every tracker is cheaper
+		const int64 RingCells = Ring == 0 ? 1 : 24ll * Ring * Ring + 2;
+		if (RingCells > Cells.Num())
+		{
+			Candidates.Reset();
+			for (const TPair<FIntVector, TArray<FCellItem>>& Cell : Cells)
+			{
+				for (const FCellItem& Item : Cell.Value)
+				{
+					Consider(Item);
+				}
+			}
+			break;
+		}
+
+		for (int32 X = -Ring; X <= Ring; X++)
+		{
+			for (int32 Y = -Ring; Y <= Ring; Y++)
+			{
+				// Inside the shell only the top and bottom faces are new
+				const bool bOnSide = FMath::Abs(X) == Ring || FMath::Abs(Y) == Ring;
+				const int32 ZStep = bOnSide ? 1 : FMath::Max(2 * Ring, 1);
+				for (int32 Z = -Ring; Z <= Ring; Z += ZStep)
+				{
+					if (const TArray<FCellItem>* Items = Cells.Find(Center + FIntVector(X, Y, Z)))
+					{
+						Seen += Items->Num();
+						for (const FCellItem& Item : *Items)
+						{
+							Consider(Item);
+						}
+					}
+				}
+			}
+		}
+
+		const float Reach = Ring * CellSize;
+		if (Seen == Entries.Num() || Reach * Reach >= MaxDistSq)
+		{
+			break;
+		}
+		if (Candidates.Num() >= Count)
+		{
+			Candidates.Sort([](const TPair<float, int32>& A, const TPair<float, int32>& B) { return A.Key < B.Key; });
+			if (Candidates[Count - 1].Key <= Reach * Reach)
+			{
+				break;
+			}
+		}
+	}
+
+	Candidates.Sort([](const TPair<float, int32>& A, const TPair<float, int32>& B) { return A.Key < B.Key; });
+	const int32 NumResults = FMath::Min(Count, Candidates.Num());
+	OutIDs.Reserve(NumResults);
+	for (int32 Index = 0; Index < NumResults; Index++)
+	{
+		OutIDs.Add(Candidates[Index].Value);
+	}
+}
@@ -0,0 +1,288 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+
+#include "PSNStats.h"
+#include "PosiStageNet.h"
+#include "PSNReceiverSubsystem.h"
+#include "PSNSenderSubsystem.h"
+#include "PSNTrackerRecord.h"
+#include "HAL/IConsoleManager.h"
+#include "Interfaces/IPv4/IPv4Address.h"
+#include "UObject/UObjectIterator.h"
+
+DEFINE_STAT(STAT_PSNDecode);
+DEFINE_STAT(STAT_PSNDispatch);
+DEFINE_STAT(STAT_PSNPacketsPerSecond);
+DEFINE_STAT(STAT_PSNBytesPerSecond);
+DEFINE_STAT(STAT_PSNFramesCompleted);
+DEFINE_STAT(STAT_PSNFramesDropped);
+DEFINE_STAT(STAT_PSNFramesPartial);
+DEFINE_STAT(STAT_PSNFramesReordered);
+DEFINE_STAT(STAT_PSNPacketsDuplicated);
+DEFINE_STAT(STAT_PSNQueueDepth);
+DEFINE_STAT(STAT_PSNDispatchLatency);
+DEFINE_STAT(STAT_PSNEncode);
+DEFINE_STAT(STAT_PSNSend);
+DEFINE_STAT(STAT_PSNPacketsPerFrame);
+DEFINE_STAT(STAT_PSNSocketErrors);
+
+CSV_DEFINE_CATEGORY_MODULE(POSISTAGENET_API, PSN, true);
+
+namespace PSNStats
+{
+	// Length of the window rates are averaged over
+	static constexpr double RateWindowSeconds = 1.0;
+
+	// Returns the elapsed window length once it is complete, otherwise 0
+	static double RollWindow(double& WindowStart, double Now)
+	{
+		if (WindowStart == 0.0)
+		{
+			WindowStart = Now;
+			return 0.0;
+		}
+
+		const double Elapsed = Now - WindowStart;
+		if (Elapsed < RateWindowSeconds)
+		{
+			return 0.0;
+		}
+
+		WindowStart = Now;
+		return Elapsed;
+	}
+
+	static double CyclesToMicroseconds(uint64 Cycles, uint64 Count)
+	{
+		return Count > 0 ? FPlatformTime::ToMilliseconds64(Cycles) * 1000.0 / (double)Count : 0.0;
+	}
+}
+
+void FPSNSourceStats::MarkTrackersReceived(const TArray<FPSNTrackerRecord>& Trackers, double Time)
+{
+	for (const FPSNTrackerRecord& Tracker : Trackers)
+	{
+		const uint32 TrackerID = Tracker.ID;
+		const uint32 Start = (TrackerID * 2654435761u) % NumTrackerSlots;
+
+		bool bListed = false;
+		for (int32 Probe = 0; Probe < MaxTrackerProbes && !bListed; Probe++)
+		{
+			FTrackerSlot& Slot = TrackerSlots[(Start + Probe) % NumTrackerSlots];
+			uint32 Current = Slot.ID.load();
+
+			// Claim an empty slot, unless the table already holds as many trackers as it keeps
+			if (Current == EmptyTrackerSlot)
+			{
+				if (NumTrackersListed.load() >= MaxTrackers)
+				{
+					break;
+				}
+				if (Slot.ID.compare_exchange_strong(Current, TrackerID))
+				{
+					NumTrackersListed++;
+					Current = TrackerID;
+				}
+			}
+
+			// Either already ours, or another thread claimed this slot for the same tracker first
+			if (Current == TrackerID)
+			{
+				Slot.LastReceived = Time;
+				bListed = true;
+			}
+		}
+
+		if (!bListed)
+		{
+			TrackersNotListed++;
+		}
+	}
+}
+
+void FPSNSourceStats::GetTrackersReceived(TArray<TPair<uint16, double>>& OutTrackers) const
+{
+	OutTrackers.Reset(NumTrackersListed.load());
+	for (const FTrackerSlot& Slot : TrackerSlots)
+	{
+		// A slot is claimed before its time is written
+		const uint32 TrackerID = Slot.ID.load();
+		const double LastReceived = Slot.LastReceived.load();
+		if (TrackerID != EmptyTrackerSlot && LastReceived > 0.0)
+		{
+			OutTrackers.Emplace((uint16)TrackerID, LastReceived);
+		}
+	}
+}
+
+void FPSNReceiverStats::Publish()
+{
+	const uint64 Packets = PacketsReceived.load();
+	const uint64 Bytes = BytesReceived.load();
+	const double Now = FPlatformTime::Seconds();
+
+	if (const double Elapsed = PSNStats::RollWindow(WindowStart, Now))
+	{
+		PacketsPerSecond = (double)(Packets - WindowPackets) / Elapsed;
+		BytesPerSecond = (double)(Bytes - WindowBytes) / Elapsed;
+		WindowPackets = Packets;
+		WindowBytes = Bytes;
+	}
+
+	for (FPSNSourceStats& Source : Sources)
+	{
+		if (Source.Address.load() == 0)
+		{
+			continue;
+		}
+
+		const uint64 SourcePackets = Source.PacketsReceived.load();
+		if (const double Elapsed = PSNStats::RollWindow(Source.WindowStart, Now))
+		{
+			Source.PacketsPerSecond = (double)(SourcePackets - Source.WindowPackets) / Elapsed;
+			Source.WindowPackets = SourcePackets;
+		}
+	}
+
+	SET_FLOAT_STAT(STAT_PSNPacketsPerSecond, PacketsPerSecond.load());
+	SET_FLOAT_STAT(STAT_PSNBytesPerSecond, BytesPerSecond.load());
+	SET_DWORD_STAT(STAT_PSNFramesCompleted, FramesCompleted.load());
+	SET_DWORD_STAT(STAT_PSNFramesDropped, FramesDropped.load());
+	SET_DWORD_STAT(STAT_PSNFramesPartial, FramesPartial.load());
+	SET_DWORD_STAT(STAT_PSNFramesReordered, FramesReordered.load());
+	SET_DWORD_STAT(STAT_PSNPacketsDuplicated, PacketsDuplicated.load());
+	SET_DWORD_STAT(STAT_PSNQueueDepth, QueueDepth.load());
+	SET_FLOAT_STAT(STAT_PSNDispatchLatency, LastDispatchLatencyMs.load());
+
+	CSV_CUSTOM_STAT(PSN, PacketsPerSecond, (float)PacketsPerSecond.load(), ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(PSN, BytesPerSecond, (float)BytesPerSecond.load(), ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(PSN, FramesDropped, (int32)FramesDropped.load(), ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(PSN, FramesPartial, (int32)FramesPartial.load(), ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(PSN, FramesReordered, (int32)FramesReordered.load(), ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(PSN, PacketsDuplicated, (int32)PacketsDuplicated.load(), ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(PSN, QueueDepth, QueueDepth.load(), ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(PSN, DispatchLatencyMs, (float)LastDispatchLatencyMs.load(), ECsvCustomStatOp::Set);
+}
+
+double FPSNReceiverStats::GetAverageDecodeMicroseconds() const
+{
+	return PSNStats::CyclesToMicroseconds(DecodeCycles.load(), PacketsDecoded.load());
+}
+
+double FPSNReceiverStats::GetAverageDispatchLatencyMs() const
+{
+	return PSNStats::CyclesToMicroseconds(DispatchLatencyCycles.load(), TrackersDispatched.load()) / 1000.0;
+}
+
+FPSNSourceStats* FPSNReceiverStats::FindOrAddSource(uint32 Address)
+{
+	for (FPSNSourceStats& Source : Sources)
+	{
+		uint32 Current = Source.Address.load();
+		if (Current == 0 && Source.Address.compare_exchange_strong(Current, Address))
+		{
+			return &Source;
+		}
+
+		// Either already ours, or another thread claimed this slot first
+		if (Current == Address)
+		{
+			return &Source;
+		}
+	}
+	return nullptr;
+}
+
+void FPSNReceiverStats::Dump(FOutputDevice& Ar) const
+{
+	Ar.Logf(TEXT("  Packets: %llu received, %.1f/s, %.1f KB/s"), PacketsReceived.load(), PacketsPerSecond.load(), BytesPerSecond.load() / 1024.0);
+	Ar.Logf(TEXT("  Decode: %.2f us avg, %llu errors"), GetAverageDecodeMicroseconds(), DecodeErrors.load());
+	Ar.Logf(TEXT("  Frames: %llu completed, %llu dropped, %llu partial, %llu reordered"), FramesCompleted.load(), FramesDropped.load(), FramesPartial.load(), FramesReordered.load());
+	Ar.Logf(TEXT("  Packets discarded: %llu duplicated, %llu late, %llu redundant copies"), PacketsDuplicated.load(), PacketsLate.load(), PacketsRedundant.load());
+	Ar.Logf(TEXT("  Dispatch: %llu trackers, %llu unchanged not broadcast, %llu ID conflicts, queue depth %d, latency %.3f ms last / %.3f ms avg"), TrackersDispatched.load(), TrackersSuppressed.load(), TrackerIDConflicts.load(), QueueDepth.load(), LastDispatchLatencyMs.load(), GetAverageDispatchLatencyMs());
+
+	for (const FPSNSourceStats& Source : Sources)
+	{
+		if (const uint32 Address = Source.Address.load())
+		{
+			Ar.Logf(TEXT("  Source %s: %.1f packets/s, last frame %d, %llu decode errors"), *FIPv4Address(Address).ToString(), Source.PacketsPerSecond.load(), Source.LastFrameID.load(), Source.DecodeErrors.load());
+			Ar.Logf(TEXT("    Frames: %llu lost, %llu partial, %llu reordered. Packets: %llu duplicated, %llu late, %llu redundant copies"), Source.FramesLost.load(), Source.FramesPartial.load(), Source.FramesReordered.load(), Source.PacketsDuplicated.load(), Source.PacketsLate.load(), Source.PacketsRedundant.load());
+		}
+	}
+}
+
+void FPSNSenderStats::Publish()
+{
+	const uint64 Frames = FramesSent.load();
+	const uint64 Bytes = BytesSent.load();
+
+	if (const double Elapsed = PSNStats::RollWindow(WindowStart, FPlatformTime::Seconds()))
+	{
+		FramesPerSecond = (double)(Frames - WindowFrames) / Elapsed;
+		BytesPerSecond = (double)(Bytes - WindowBytes) / Elapsed;
+		WindowFrames = Frames;
+		WindowBytes = Bytes;
+	}
+
+	SET_DWORD_STAT(STAT_PSNPacketsPerFrame, LastPacketsPerFrame.load());
+	SET_DWORD_STAT(STAT_PSNSocketErrors, SocketErrors.load());
+
+	CSV_CUSTOM_STAT(PSN, FramesSentPerSecond, (float)FramesPerSecond.load(), ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(PSN, PacketsPerFrame, (int32)LastPacketsPerFrame.load(), ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(PSN, SocketErrors, (int32)SocketErrors.load(), ECsvCustomStatOp::Set);
+}
+
+double FPSNSenderStats::GetAverageBuildMicroseconds() const
+{
+	return PSNStats::CyclesToMicroseconds(BuildCycles.load(), TrackerListBuilds.load());
+}
+
+double FPSNSenderStats::GetAverageEncodeMicroseconds() const
+{
+	return PSNStats::CyclesToMicroseconds(EncodeCycles.load(), FramesSent.load());
+}
+
+double FPSNSenderStats::GetAverageSendMicroseconds() const
+{
+	return PSNStats::CyclesToMicroseconds(SendCycles.load(), FramesSent.load());
+}
+
+void FPSNSenderStats::Dump(FOutputDevice& Ar) const
+{
+	Ar.Logf(TEXT("  Frames: %llu sent, %.1f/s, %.1f KB/s"), FramesSent.load(), FramesPerSecond.load(), BytesPerSecond.load() / 1024.0);
+	Ar.Logf(TEXT("  Packets: %llu sent, %u in last frame, %llu socket errors"), PacketsSent.load(), LastPacketsPerFrame.load(), SocketErrors.load());
+	Ar.Logf(TEXT("  Send thread: %llu frames superseded before sending"), FramesSuperseded.load());
+	Ar.Logf(TEXT("  Timing: build %.2f us avg, encode %.2f us avg, send %.2f us avg"), GetAverageBuildMicroseconds(), GetAverageEncodeMicroseconds(), GetAverageSendMicroseconds());
+
+	for (const FPSNSendInterfaceStats& Interface : Interfaces)
+	{
+		if (Interface.bActive)
+		{
+			Ar.Logf(TEXT("  Interface %s: %s, %llu packets sent, %llu socket errors"), *FIPv4Address(Interface.Address.load()).ToString(), Interface.bHealthy ? TEXT("healthy") : TEXT("failing"), Interface.PacketsSent.load(), Interface.SocketErrors.load());
+		}
+	}
+}
+
+static FAutoConsoleCommandWithOutputDevice GPSNStatsCommand(
+	TEXT("psn.stats"),
+	TEXT("Print PSN receiver and sender statistics for every running game instance"),
+	FConsoleCommandWithOutputDeviceDelegate::CreateStatic([](FOutputDevice& Ar)
+	{
+		for (TObjectIterator<UPSNReceiverSubsystem> It; It; ++It)
+		{
+			if (!It->HasAnyFlags(RF_ClassDefaultObject))
+			{
+				Ar.Logf(TEXT("PSN Receiver (%s)"), *It->GetOuter()->GetName());
+				It->GetStats().Dump(Ar);
+			}
+		}
+
+		for (TObjectIterator<UPSNSenderSubsystem> It; It; ++It)
+		{
+			if (!It->HasAnyFlags(RF_ClassDefaultObject))
+			{
+				Ar.Logf(TEXT("PSN Sender (%s)"), *It->GetOuter()->GetName());
+				It->GetStats().Dump(Ar);
+			}
+		}
+	}));
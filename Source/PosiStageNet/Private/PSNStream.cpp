@@ -3,6 +3,8 @@
 #include "PSNStream.h"
 #include "PosiStageNet.h"
 #include "PSNMessage.h"
+#include "PSNTrackerRecord.h"
+#include "PSNInfoTable.h"
 
 #include "PSN/psn_lib.hpp"
 #include <sstream>
@@ -33,42 +35,49 @@ FPSNStream::FPSNStream(const uint8* InData, int32 InSize, uint8_t InLastFrameID)
 }
 
 
-void FPSNStream::DecodeToTrackers(TArray<FPSNTracker>& InTrackerMap, ::psn::psn_decoder* Decoder)
+bool FPSNStream::DecodeToTrackers(TArray<FPSNTrackerRecord>& OutTrackers, ::psn::psn_decoder* Decoder)
 {
 	check(Decoder);
-	InTrackerMap.Empty();
+	OutTrackers.Reset();
 
 	if (Decoder->decode((ANSICHAR*)Data.GetData(), Data.Num()))
 	{
+		StreamDataType = Decoder->DataType;
+
 		// Confirm New Frame
-		if (Decoder->get_data().header.frame_id != HeaderFrameID)
+		if (StreamDataType == EPSNPacketType::PSNType_Data && Decoder->get_data().header.frame_id != HeaderFrameID)
 		{
 			HeaderFrameID = Decoder->get_data().header.frame_id;
 
 			const ::psn::tracker_map& recv_trackers = Decoder->get_data().trackers;
-
-			// Header Information
-			const FString SystemName = StringToFString(Decoder->get_info().system_name);
-			const int FrameID = (int)HeaderFrameID;
-			const uint64_t Timestamp = Decoder->get_data().header.timestamp_usec;
-			const int TrackerCount = recv_trackers.size();
+			OutTrackers.Reserve(recv_trackers.size());
 
 			// Trackers
 			for (auto track = recv_trackers.begin(); track != recv_trackers.end(); ++track)
 			{
-				const ::psn::tracker& Tracker = track->second;
-				InTrackerMap.Add(FPSNTracker(Tracker));
+				OutTrackers.Add(FPSNTrackerRecord::FromNative(track->second, HeaderFrameID));
 			}
 		}
-		StreamDataType = Decoder->DataType;
+		return true;
 	}
-	else
+
+	UE_LOG(LogPSN, Error, TEXT("Failed to decode Data "));
+	return false;
+}
+
+void FPSNStream::ConvertInfo(const ::psn::psn_decoder& Decoder, FPSNSourceInfo& OutInfo)
+{
+	const ::psn::psn_decoder::info_t& Info = Decoder.get_info();
+	OutInfo.SystemName = StringToFString(Info.system_name);
+	OutInfo.TrackerNames.Reset();
+	OutInfo.TrackerNames.Reserve(Info.tracker_names.size());
+	for (const auto& Name : Info.tracker_names)
 	{
-		UE_LOG(LogPSN, Error, TEXT("Failed to decode Data "));
+		OutInfo.TrackerNames.Add(Name.first, StringToFString(Name.second));
 	}
 }
 
-void FPSNStream::EncodeToPSN(TArray<FPSNTracker> InTrackerMap, ::psn::psn_encoder* InEncoder, strlist& dataPacket, strlist& InfoPacket, uint64 TimespanMicroseconds, bool bIsHeader)
+void FPSNStream::EncodeToPSN(const TArray<FPSNTracker>& InTrackerMap, ::psn::psn_encoder* InEncoder, strlist& dataPacket, strlist& InfoPacket, uint64 TimespanMicroseconds, bool bIsHeader)
 {
 	psn::tracker_map Trackers;
 	for (int i = 0; i < InTrackerMap.Num(); i++)
@@ -86,12 +95,67 @@ void FPSNStream::EncodeToPSN(TArray<FPSNTracker> InTrackerMap, ::psn::psn_encode
 	}
 }
 
+void FPSNStream::UpdateNativeTrackers(const TArray<FPSNTrackerRecord>& InTrackers, ::psn::tracker_map& InOutNativeTrackers)
+{
+	for (const FPSNTrackerRecord& Tracker : InTrackers)
+	{
+		Tracker.WriteNative(InOutNativeTrackers.try_emplace(Tracker.ID, Tracker.ID).first->second);
+	}
+
+	// More entries than trackers means some were removed. Rebuild once to drop them.
+	if (InOutNativeTrackers.size() > (size_t)InTrackers.Num())
+	{
+		InOutNativeTrackers.clear();
+		UpdateNativeTrackers(InTrackers, InOutNativeTrackers);
+	}
+}
+
+bool FPSNStream::PeekHeader(const uint8* InData, int32 InSize, uint16& OutPacketID, uint8& OutFrameID, uint8& OutFramePacketCount)
+{
+	// Timestamp (8 bytes), version high, version low, frame ID, frame packet count
+	static constexpr int32 HeaderSize = 12;
+	static constexpr int32 FrameIDOffset = 10;
+	const int32 ChunkHeaderSize = sizeof(::psn::chunk_header);
+
+	if (InSize < ChunkHeaderSize)
+	{
+		return false;
+	}
+
+	::psn::chunk_header Packet;
+	FMemory::Memcpy(&Packet, InData, ChunkHeaderSize);
+	OutPacketID = Packet.id;
+
+	const int32 End = FMath::Min(InSize, ChunkHeaderSize + (int32)Packet.data_len);
+	int32 Offset = ChunkHeaderSize;
+	while (Offset + ChunkHeaderSize <= End)
+	{
+		::psn::chunk_header Child;
+		FMemory::Memcpy(&Child, InData + Offset, ChunkHeaderSize);
+		Offset += ChunkHeaderSize;
+
+		// Info and data packets both keep their header in chunk 0
+		if (Child.id == ::psn::DATA_PACKET_HEADER)
+		{
+			if (Child.data_len < HeaderSize || Offset + HeaderSize > End)
+			{
+				return false;
+			}
+			OutFrameID = InData[Offset + FrameIDOffset];
+			OutFramePacketCount = InData[Offset + FrameIDOffset + 1];
+			return true;
+		}
+		Offset += Child.data_len;
+	}
+	return false;
+}
+
 uint8_t FPSNStream::GetHeaderFrameID()
 {
 	return HeaderFrameID;
 }
 
-FString FPSNStream::StringToFString(std::string InString)
+FString FPSNStream::StringToFString(const std::string& InString)
 {
 	return UTF8_TO_TCHAR(InString.c_str());
 }
@@ -0,0 +1,113 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+
+#include "PSNTrace.h"
+
+#if UE_TRACE_ENABLED
+
+UE_TRACE_CHANNEL_DEFINE(PSNChannel);
+
+UE_TRACE_EVENT_BEGIN(PSN, FrameEncoded)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint8, FrameId)
+	UE_TRACE_EVENT_FIELD(uint32, PacketCount)
+	UE_TRACE_EVENT_FIELD(uint32, TrackerCount)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(PSN, FrameSent)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint8, FrameId)
+	UE_TRACE_EVENT_FIELD(uint32, PacketCount)
+	UE_TRACE_EVENT_FIELD(uint32, Bytes)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(PSN, PacketReceived)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint32, Bytes)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(PSN, FrameDecoded)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint8, FrameId)
+	UE_TRACE_EVENT_FIELD(uint32, PacketCount)
+	UE_TRACE_EVENT_FIELD(uint32, TrackerCount)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(PSN, FrameEnqueued)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint8, FrameId)
+	UE_TRACE_EVENT_FIELD(uint32, TrackerCount)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(PSN, FrameDispatched)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint8, FrameId)
+	UE_TRACE_EVENT_FIELD(uint32, TrackerCount)
+UE_TRACE_EVENT_END()
+
+#endif
+
+namespace PSNTrace
+{
+	void FrameEncoded(uint8 FrameID, uint32 PacketCount, uint32 TrackerCount)
+	{
+#if UE_TRACE_ENABLED
+		UE_TRACE_LOG(PSN, FrameEncoded, PSNChannel)
+			<< FrameEncoded.Cycle(FPlatformTime::Cycles64())
+			<< FrameEncoded.FrameId(FrameID)
+			<< FrameEncoded.PacketCount(PacketCount)
+			<< FrameEncoded.TrackerCount(TrackerCount);
+#endif
+	}
+
+	void FrameSent(uint8 FrameID, uint32 PacketCount, uint32 Bytes)
+	{
+#if UE_TRACE_ENABLED
+		UE_TRACE_LOG(PSN, FrameSent, PSNChannel)
+			<< FrameSent.Cycle(FPlatformTime::Cycles64())
+			<< FrameSent.FrameId(FrameID)
+			<< FrameSent.PacketCount(PacketCount)
+			<< FrameSent.Bytes(Bytes);
+#endif
+	}
+
+	void PacketReceived(uint32 Bytes)
+	{
+#if UE_TRACE_ENABLED
+		UE_TRACE_LOG(PSN, PacketReceived, PSNChannel)
+			<< PacketReceived.Cycle(FPlatformTime::Cycles64())
+			<< PacketReceived.Bytes(Bytes);
+#endif
+	}
+
+	void FrameDecoded(uint8 FrameID, uint32 PacketCount, uint32 TrackerCount)
+	{
+#if UE_TRACE_ENABLED
+		UE_TRACE_LOG(PSN, FrameDecoded, PSNChannel)
+			<< FrameDecoded.Cycle(FPlatformTime::Cycles64())
+			<< FrameDecoded.FrameId(FrameID)
+			<< FrameDecoded.PacketCount(PacketCount)
+			<< FrameDecoded.TrackerCount(TrackerCount);
+#endif
+	}
+
+	void FrameEnqueued(uint8 FrameID, uint32 TrackerCount)
+	{
+#if UE_TRACE_ENABLED
+		UE_TRACE_LOG(PSN, FrameEnqueued, PSNChannel)
+			<< FrameEnqueued.Cycle(FPlatformTime::Cycles64())
+			<< FrameEnqueued.FrameId(FrameID)
+			<< FrameEnqueued.TrackerCount(TrackerCount);
+#endif
+	}
+
+	void FrameDispatched(uint8 FrameID, uint32 TrackerCount)
+	{
+#if UE_TRACE_ENABLED
+		UE_TRACE_LOG(PSN, FrameDispatched, PSNChannel)
+			<< FrameDispatched.Cycle(FPlatformTime::Cycles64())
+			<< FrameDispatched.FrameId(FrameID)
+			<< FrameDispatched.TrackerCount(TrackerCount);
+#endif
+	}
+}
@@ -0,0 +1,258 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+
+#include "PSNTrackerHistory.h"
+#include "PosiStageNet.h"
+#include "PSNTrackerRecord.h"
+
+FPSNTrackerHistory::FPSNTrackerHistory(int32 InSamplesPerTracker)
+	: SamplesPerTracker(FMath::Max(InSamplesPerTracker, 0))
+{
+}
+
+void FPSNTrackerHistory::SetSamplesPerTracker(int32 InSamplesPerTracker)
+{
+	SamplesPerTracker = FMath::Max(InSamplesPerTracker, 0);
+	RingIndices.Empty();
+	Rings.Empty();
+	FreeRings.Empty();
+	Samples.Empty();
+	bHasOrigin = false;
+}
+
+void FPSNTrackerHistory::Reserve(int32 NumTrackers)
+{
+	RingIndices.Reserve(NumTrackers);
+	Rings.Reserve(NumTrackers);
+	Samples.Reserve(NumTrackers * SamplesPerTracker);
+}
+
+void FPSNTrackerHistory::Push(int32 ID, double Time, const FVector3f& Position, const FQuat4f& Rotation)
+{
+	if (SamplesPerTracker == 0)
+	{
+		return;
+	}
+
+	if (!bHasOrigin)
+	{
+		Origin = Time;
+		bHasOrigin = true;
+	}
+
+	// Ticks run out after about 119 hours, then the history starts over
+	double Ticks = FMath::Max(ToTicks(Time), 0.0);
+	if (Ticks > MAX_uint32)
+	{
+		UE_LOG(LogPSN, Log, TEXT("PSN tracker history has run out of time range and has been cleared."));
+		Reset();
+		Origin = Time;
+		bHasOrigin = true;
+		Ticks = 0.0;
+	}
+
+	int32* RingIndex = RingIndices.Find(ID);
+	if (!RingIndex)
+	{
+		RingIndex = &RingIndices.Add(ID, AllocateRing());
+	}
+
+	FRing& Ring = Rings[*RingIndex];
+	const uint32 SampleTime = (uint32)FMath::RoundToDouble(Ticks);
+	if (Ring.Count == 0 || SampleTime > Samples[Ring.Start + Ring.Head].Time)
+	{
+		Ring.Head = Ring.Count == 0 ? 0 : (Ring.Head + 1) % SamplesPerTracker;
+		Ring.Count = FMath::Min(Ring.Count + 1, SamplesPerTracker);
+	}
+
+	FSample& Sample = Samples[Ring.Start + Ring.Head];
+	Sample.Time = SampleTime;
+	for (int32 Axis = 0; Axis < 3; Axis++)
+	{
+		Sample.Position[Axis] = (int32)FMath::Clamp(FMath::RoundToDouble(Position[Axis] * PositionSteps), (double)MIN_int32, (double)MAX_int32);
+	}
+
+	const FQuat4f Normalized = Rotation.GetNormalized();
+	Sample.Rotation[0] = (int16)FMath::RoundToInt(Normalized.X * MAX_int16);
+	Sample.Rotation[1] = (int16)FMath::RoundToInt(Normalized.Y * MAX_int16);
+	Sample.Rotation[2] = (int16)FMath::RoundToInt(Normalized.Z * MAX_int16);
+	Sample.Rotation[3] = (int16)FMath::RoundToInt(Normalized.W * MAX_int16);
+}
+
+void FPSNTrackerHistory::Push(int32 ID, double Time, const FPSNTrackerRecord& Record)
+{
+	const FQuat4f Rotation = Record.HasField(EPSNTrackerField::Orientation) ? PSNOrientation::AxisAngleToQuat(Record.Orientation) : FQuat4f::Identity;
+	Push(ID, Time, Record.Position, Rotation);
+}
+
+void FPSNTrackerHistory::Remove(int32 ID)
+{
+	int32 RingIndex;
+	if (RingIndices.RemoveAndCopyValue(ID, RingIndex))
+	{
+		Rings[RingIndex].Count = 0;
+		FreeRings.Add(RingIndex);
+	}
+}
+
+void FPSNTrackerHistory::Reset()
+{
+	RingIndices.Reset();
+	FreeRings.Reset();
+	for (int32 RingIndex = Rings.Num() - 1; RingIndex >= 0; RingIndex--)
+	{
+		Rings[RingIndex].Count = 0;
+		FreeRings.Add(RingIndex);
+	}
+	bHasOrigin = false;
+}
+
+int32 FPSNTrackerHistory::NumSamples(int32 ID) const
+{
+	const int32* RingIndex = RingIndices.Find(ID);
+	return RingIndex ? Rings[*RingIndex].Count : 0;
+}
+
+bool FPSNTrackerHistory::GetStateAtTime(int32 ID, double Time, FVector& OutPosition, FQuat& OutRotation) const
+{
+	const int32* RingIndex = RingIndices.Find(ID);
+	if (!RingIndex || Rings[*RingIndex].Count == 0)
+	{
+		return false;
+	}
+
+	Interpolate(Rings[*RingIndex], ToTicks(Time), &OutPosition, &OutRotation);
+	return true;
+}
+
+bool FPSNTrackerHistory::GetTrajectory(int32 ID, double StartTime, double EndTime, TArray<FVector>& OutPositions, TArray<double>* OutTimes) const
+{
+	OutPositions.Reset();
+	if (OutTimes)
+	{
+		OutTimes->Reset();
+	}
+
+	const int32* RingIndex = RingIndices.Find(ID);
+	if (!RingIndex)
+	{
+		return false;
+	}
+
+	const FRing& Ring = Rings[*RingIndex];
+	const double StartTicks = ToTicks(StartTime);
+	const double EndTicks = ToTicks(EndTime);
+	for (int32 Index = 0; Index < Ring.Count; Index++)
+	{
+		const FSample& Sample = GetSample(Ring, Index);
+		if (Sample.Time >= StartTicks && Sample.Time <= EndTicks)
+		{
+			OutPositions.Add(ToPosition(Sample));
+			if (OutTimes)
+			{
+				OutTimes->Add(ToTime(Sample.Time));
+			}
+		}
+	}
+	return OutPositions.Num() > 0;
+}
+
+bool FPSNTrackerHistory::GetVelocity(int32 ID, double StartTime, double EndTime, FVector& OutVelocity) const
+{
+	const int32* RingIndex = RingIndices.Find(ID);
+	if (!RingIndex || Rings[*RingIndex].Count < 2)
+	{
+		return false;
+	}
+
+	const FRing& Ring = Rings[*RingIndex];
+	const double Oldest = GetSample(Ring, 0).Time;
+	const double Newest = GetSample(Ring, Ring.Count - 1).Time;
+	const double StartTicks = FMath::Clamp(ToTicks(StartTime), Oldest, Newest);
+	const double EndTicks = FMath::Clamp(ToTicks(EndTime), Oldest, Newest);
+	if (EndTicks <= StartTicks)
+	{
+		OutVelocity = FVector::ZeroVector;
+		return true;
+	}
+
+	FVector StartPosition, EndPosition;
+	Interpolate(Ring, StartTicks, &StartPosition, nullptr);
+	Interpolate(Ring, EndTicks, &EndPosition, nullptr);
+	OutVelocity = (EndPosition - StartPosition) * (TicksPerSecond / (EndTicks - StartTicks));
+	return true;
+}
+
+const FPSNTrackerHistory::FSample& FPSNTrackerHistory::GetSample(const FRing& Ring, int32 Index) const
+{
+	return Samples[Ring.Start + (Ring.Head - (Ring.Count - 1) + Index + SamplesPerTracker) % SamplesPerTracker];
+}
+
+void FPSNTrackerHistory::Interpolate(const FRing& Ring, double Ticks, FVector* OutPosition, FQuat* OutRotation) const
+{
+	const FSample* Before = &GetSample(Ring, 0);
+	const FSample* After = &GetSample(Ring, Ring.Count - 1);
+	double Alpha = 0.0;
+
+	if (Ticks <= Before->Time)
+	{
+		After = Before;
+	}
+	else if (Ticks >= After->Time)
+	{
+		Before = After;
+	}
+	else
+	{
+		// Sample times only increase, so search for the pair either side
+		int32 Low = 0;
+		int32 High = Ring.Count - 1;
+		while (High - Low > 1)
+		{
+			const int32 Mid = (Low + High) / 2;
+			if (GetSample(Ring, Mid).Time <= Ticks)
+			{
+				Low = Mid;
+			}
+			else
+			{
+				High = Mid;
+			}
+		}
+		Before = &GetSample(Ring, Low);
+		After = &GetSample(Ring, High);
+		Alpha = (Ticks - Before->Time) / (double)(After->Time - Before->Time);
+	}
+
+	if (OutPosition)
+	{
+		*OutPosition = FMath::Lerp(ToPosition(*Before), ToPosition(*After), Alpha);
+	}
+	if (OutRotation)
+	{
+		*OutRotation = FQuat::Slerp(ToRotation(*Before), ToRotation(*After), Alpha);
+	}
+}
+
+FVector FPSNTrackerHistory::ToPosition(const FSample& Sample)
+{
+	return FVector(Sample.Position[0], Sample.Position[1], Sample.Position[2]) / PositionSteps;
+}
+
+FQuat FPSNTrackerHistory::ToRotation(const FSample& Sample)
+{
+	return FQuat(Sample.Rotation[0], Sample.Rotation[1], Sample.Rotation[2], Sample.Rotation[3]).GetNormalized();
+}
+
+int32 FPSNTrackerHistory::AllocateRing()
+{
+	if (FreeRings.Num() > 0)
+	{
+		return FreeRings.Pop(false);
+	}
+
+	FRing& Ring = Rings.AddDefaulted_GetRef();
+	Ring.Start = Samples.Num();
+	Samples.AddUninitialized(SamplesPerTracker);
+	return Rings.Num() - 1;
+}
@@ -0,0 +1,115 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+
+#include "PSNTrackerVisualizerComponent.h"
+#include "PSNReceiverSubsystem.h"
+#include "PSNOrientation.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+
+UPSNTrackerVisualizerComponent::UPSNTrackerVisualizerComponent(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.TickGroup = TG_PrePhysics;
+	NumCustomDataFloats = 1;
+	SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	SetGenerateOverlapEvents(false);
+	SetCastShadow(false);
+}
+
+void UPSNTrackerVisualizerComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	if (const UPSNReceiverSubsystem* Receiver = GetReceiverSubsystem())
+	{
+		// Staleness and hiding change with time alone, everything else only when new data arrives
+		const bool bTimeDependent = ColorMode == EPSNVisualizerColorMode::PSN_Staleness || HideAfterSeconds > 0.f;
+		if (bTimeDependent || Receiver->GetSnapshotRevision() != LastSnapshotRevision)
+		{
+			LastSnapshotRevision = Receiver->GetSnapshotRevision();
+			UpdateInstances(*Receiver);
+		}
+	}
+}
+
+UPSNReceiverSubsystem* UPSNTrackerVisualizerComponent::GetReceiverSubsystem() const
+{
+	const UWorld* World = GetWorld();
+	const UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+	return GameInstance ? GameInstance->GetSubsystem<UPSNReceiverSubsystem>() : nullptr;
+}
+
+void UPSNTrackerVisualizerComponent::UpdateInstances(const UPSNReceiverSubsystem& Receiver)
+{
+	const TMap<int32, FPSNTrackerSnapshotEntry>& Snapshot = Receiver.GetTrackerSnapshot();
+	const double Now = FPlatformTime::Seconds();
+
+	InstanceTransforms.Reset(Snapshot.Num());
+	InstanceValues.Reset(Snapshot.Num());
+	InstanceOrientations.Reset(Snapshot.Num());
+
+	for (const TPair<int32, FPSNTrackerSnapshotEntry>& Pair : Snapshot)
+	{
+		const FPSNTrackerSnapshotEntry& Entry = Pair.Value;
+		const double Age = Now - Entry.LastReceivedTime;
+		if (HideAfterSeconds > 0.f && Age > HideAfterSeconds)
+		{
+			continue;
+		}
+
+		const FPSNTrackerRecord& Tracker = Entry.Tracker;
+		InstanceTransforms.Emplace(FQuat::Identity, FVector(Tracker.Position), InstanceScale);
+		InstanceOrientations.Add(Tracker.Orientation);
+
+		switch (ColorMode)
+		{
+		case EPSNVisualizerColorMode::PSN_Status:
+			InstanceValues.Add(Tracker.Status);
+			break;
+		case EPSNVisualizerColorMode::PSN_Staleness:
+			InstanceValues.Add(FMath::Clamp((float)(Age / StaleTime), 0.f, 1.f));
+			break;
+		default:
+			break;
+		}
+	}
+
+	// Orientations are converted in one batch once the visible trackers are known
+	const int32 Count = InstanceTransforms.Num();
+	if (bApplyOrientation && Count > 0)
+	{
+		InstanceRotations.SetNumUninitialized(Count, false);
+		PSNOrientation::AxisAnglesToQuats(InstanceOrientations.GetData(), sizeof(FVector3f), InstanceRotations.GetData(), Count);
+		for (int32 Index = 0; Index < Count; Index++)
+		{
+			InstanceTransforms[Index].SetRotation(FQuat(InstanceRotations[Index]));
+		}
+	}
+
+	// Rebuild only when the tracker count changes, otherwise move the existing instances in one batch
+	const bool bRebuild = GetInstanceCount() != Count;
+	if (bRebuild)
+	{
+		ClearInstances();
+		if (Count > 0)
+		{
+			AddInstances(InstanceTransforms, false);
+		}
+	}
+
+	// Written without marking the render state dirty; the rebuild above or the batched transform update below does that once
+	if (ColorMode != EPSNVisualizerColorMode::PSN_None && InstanceValues.Num() == Count && NumCustomDataFloats > 0)
+	{
+		for (int32 Index = 0; Index < Count; Index++)
+		{
+			SetCustomDataValue(Index, 0, InstanceValues[Index], false);
+		}
+	}
+
+	if (!bRebuild && Count > 0)
+	{
+		BatchUpdateInstancesTransforms(0, InstanceTransforms, false, true, true);
+	}
+}
@@ -0,0 +1,215 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+
+#include "PSNZones.h"
+#include "PSNSpatialHash.h"
+
+FPSNZone FPSNZone::MakeBox(FName Name, const FBox& Box, float DwellTime)
+{
+	FPSNZone Zone;
+	Zone.Name = Name;
+	Zone.Shape = EPSNZoneShape::PSN_Box;
+	Zone.Bounds = Box;
+	Zone.DwellTime = DwellTime;
+	return Zone;
+}
+
+FPSNZone FPSNZone::MakeSphere(FName Name, const FVector& Center, float Radius, float DwellTime)
+{
+	FPSNZone Zone;
+	Zone.Name = Name;
+	Zone.Shape = EPSNZoneShape::PSN_Sphere;
+	Zone.Center = Center;
+	Zone.Radius = FMath::Max(Radius, 0.f);
+	Zone.Bounds = FBox(Center - FVector(Zone.Radius), Center + FVector(Zone.Radius));
+	Zone.DwellTime = DwellTime;
+	return Zone;
+}
+
+FPSNZone FPSNZone::MakePolygon(FName Name, const TArray<FVector2D>& Points, float MinZ, float MaxZ, float DwellTime)
+{
+	FPSNZone Zone;
+	Zone.Name = Name;
+	Zone.Shape = EPSNZoneShape::PSN_Polygon;
+	Zone.Points = Points;
+	Zone.DwellTime = DwellTime;
+
+	// An outline of under three points has no area, and its bounds stay invalid so nothing is ever inside
+	if (Points.Num() >= 3)
+	{
+		for (const FVector2D& Point : Points)
+		{
+			Zone.Bounds += FVector(Point.X, Point.Y, FMath::Min(MinZ, MaxZ));
+			Zone.Bounds += FVector(Point.X, Point.Y, FMath::Max(MinZ, MaxZ));
+		}
+	}
+	return Zone;
+}
+
+bool FPSNZone::Contains(const FVector3f& Position) const
+{
+	const FVector Point(Position);
+	if (!Bounds.IsValid || !Bounds.IsInsideOrOn(Point))
+	{
+		return false;
+	}
+
+	switch (Shape)
+	{
+	case EPSNZoneShape::PSN_Sphere:
+		return FVector::DistSquared(Point, Center) <= Radius * Radius;
+
+	case EPSNZoneShape::PSN_Polygon:
+	{
+		// Crossing number: count the edges a ray towards +X crosses
+		bool bInside = false;
+		for (int32 Index = 0, Previous = Points.Num() - 1; Index < Points.Num(); Previous = Index++)
+		{
+			const FVector2D& A = Points[Index];
+			const FVector2D& B = Points[Previous];
+			if ((A.Y > Point.Y) != (B.Y > Point.Y) && Point.X < A.X + (Point.Y - A.Y) * (B.X - A.X) / (B.Y - A.Y))
+			{
+				bInside = !bInside;
+			}
+		}
+		return bInside;
+	}
+
+	default:
+		return true;
+	}
+}
+
+void FPSNZoneSet::AddZone(const FPSNZone& Zone)
+{
+	bZonesChanged = true;
+	for (FZoneState& State : Zones)
+	{
+		if (State.Zone.Name == Zone.Name)
+		{
+			State.Zone = Zone;
+			return;
+		}
+	}
+
+	Zones.AddDefaulted_GetRef().Zone = Zone;
+}
+
+bool FPSNZoneSet::RemoveZone(FName Name, TArray<FPSNZoneEvent>& OutEvents)
+{
+	for (int32 Index = 0; Index < Zones.Num(); Index++)
+	{
+		if (Zones[Index].Zone.Name == Name)
+		{
+			for (const FOccupant& Occupant : Zones[Index].Occupants)
+			{
+				OutEvents.Add({ EPSNZoneEventType::PSN_Exit, Name, Occupant.ID });
+			}
+			Zones.RemoveAt(Index);
+			return true;
+		}
+	}
+	return false;
+}
+
+void FPSNZoneSet::Reset(TArray<FPSNZoneEvent>& OutEvents)
+{
+	for (const FZoneState& State : Zones)
+	{
+		for (const FOccupant& Occupant : State.Occupants)
+		{
+			OutEvents.Add({ EPSNZoneEventType::PSN_Exit, State.Zone.Name, Occupant.ID });
+		}
+	}
+	Zones.Reset();
+}
+
+void FPSNZoneSet::Evaluate(const FPSNSpatialHash& Index, double Now, bool bPositionsChanged, TArray<FPSNZoneEvent>& OutEvents)
+{
+	const bool bTestOccupancy = bPositionsChanged || bZonesChanged;
+	bZonesChanged = false;
+
+	for (FZoneState& State : Zones)
+	{
+		const FPSNZone& Zone = State.Zone;
+
+		if (bTestOccupancy)
+		{
+			// Broad phase from the grid, then the exact shape test
+			Candidates.Reset();
+			if (Zone.Bounds.IsValid)
+			{
+				if (Zone.Shape == EPSNZoneShape::PSN_Sphere)
+				{
+					Index.QueryRadius(Zone.Center, Zone.Radius, Candidates);
+				}
+				else
+				{
+					Index.QueryBox(Zone.Bounds, Candidates);
+				}
+			}
+
+			if (Zone.Shape == EPSNZoneShape::PSN_Polygon)
+			{
+				FVector3f Position;
+				Candidates.RemoveAllSwap([&](int32 ID) { return !Index.GetPosition(ID, Position) || !Zone.Contains(Position); }, false);
+			}
+			Candidates.Sort();
+
+			// Merge the sorted lists: only in the old one is an exit, only in the new one an enter
+			NextOccupants.Reset();
+			int32 Old = 0;
+			for (const int32 ID : Candidates)
+			{
+				while (Old < State.Occupants.Num() && State.Occupants[Old].ID < ID)
+				{
+					OutEvents.Add({ EPSNZoneEventType::PSN_Exit, Zone.Name, State.Occupants[Old++].ID });
+				}
+
+				if (Old < State.Occupants.Num() && State.Occupants[Old].ID == ID)
+				{
+					NextOccupants.Add(State.Occupants[Old++]);
+				}
+				else
+				{
+					OutEvents.Add({ EPSNZoneEventType::PSN_Enter, Zone.Name, ID });
+					NextOccupants.Add({ ID, Now, false });
+				}
+			}
+			while (Old < State.Occupants.Num())
+			{
+				OutEvents.Add({ EPSNZoneEventType::PSN_Exit, Zone.Name, State.Occupants[Old++].ID });
+			}
+			Swap(State.Occupants, NextOccupants);
+		}
+
+		if (Zone.DwellTime > 0.f)
+		{
+			for (FOccupant& Occupant : State.Occupants)
+			{
+				if (!Occupant.bDwellReported && Now - Occupant.EnteredTime >= Zone.DwellTime)
+				{
+					Occupant.bDwellReported = true;
+					OutEvents.Add({ EPSNZoneEventType::PSN_Dwell, Zone.Name, Occupant.ID });
+				}
+			}
+		}
+	}
+}
+
+bool FPSNZoneSet::GetOccupants(FName Name, TArray<int32>& OutIDs) const
+{
+	OutIDs.Reset();
+	for (const FZoneState& State : Zones)
+	{
+		if (State.Zone.Name == Name)
+		{
+			for (const FOccupant& Occupant : State.Occupants)
+			{
+				OutIDs.Add(Occupant.ID);
+			}
+			return true;
+		}
+	}
+	return false;
+}
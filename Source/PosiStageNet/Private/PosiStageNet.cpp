@@ -1,6 +1,7 @@
 // Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
 
 #include "PosiStageNet.h"
+#include "PSNHealthEndpoint.h"
 #include "Core.h"
 #include "Modules/ModuleManager.h"
 #include "PSN/psn_lib.hpp"
@@ -9,12 +10,37 @@
 DEFINE_LOG_CATEGORY(LogPSN);
 #define LOCTEXT_NAMESPACE "FPosiStageNetModule"
 
+// Route diagnostics from the engine-free PSN codec into LogPSN
+static void PSNCodecLog(::psn::log_level Level, const char* Message)
+{
+	switch (Level)
+	{
+	case ::psn::log_level::error:
+		UE_LOG(LogPSN, Error, TEXT("%s"), UTF8_TO_TCHAR(Message));
+		break;
+	case ::psn::log_level::warning:
+		UE_LOG(LogPSN, Warning, TEXT("%s"), UTF8_TO_TCHAR(Message));
+		break;
+	default:
+		UE_LOG(LogPSN, Verbose, TEXT("%s"), UTF8_TO_TCHAR(Message));
+		break;
+	}
+}
+
 void FPosiStageNetModule::StartupModule()
 {
+	::psn::set_log_callback(&PSNCodecLog);
+
+	if (PSNHealthEndpoint::GetConfiguredPort() > 0)
+	{
+		FPSNHealthEndpoint::Get().Start(PSNHealthEndpoint::GetConfiguredPort());
+	}
 }
 
 void FPosiStageNetModule::ShutdownModule()
 {
+	::psn::set_log_callback(nullptr);
+	FPSNHealthEndpoint::Get().Stop();
 }
 
 #undef LOCTEXT_NAMESPACE
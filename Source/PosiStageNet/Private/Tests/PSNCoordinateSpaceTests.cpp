@@ -0,0 +1,89 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+#include "PSNCoordinateSpace.h"
+#include "PSNTrackerRecord.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPSNCoordinateSpaceTest, "PosiStageNet.CoordinateSpace", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPSNCoordinateSpaceTest::RunTest(const FString& Parameters)
+{
+	const float Tolerance = 1e-3f;
+
+	FPSNTrackerRecord Source;
+	Source.Position = FVector3f(1.f, 2.f, 3.f);
+	Source.Speed = FVector3f(0.5f, 0.f, 0.f);
+	Source.Orientation = FVector3f(0.f, 0.f, 0.25f);
+	Source.Fields = EPSNTrackerField::Position | EPSNTrackerField::Speed | EPSNTrackerField::Orientation;
+
+	// No preset converts meters to cm only
+	FPSNTrackerRecord Plain = Source;
+	FPSNCoordinateTransform().Apply(&Plain, 1);
+	TestTrue(TEXT("Meters to cm"), Plain.Position.Equals(FVector3f(100.f, 200.f, 300.f), Tolerance));
+	TestTrue(TEXT("Speed stays in m/s"), Plain.Speed.Equals(Source.Speed, Tolerance));
+
+	// Swapped X and Y, as used by MA Lighting consoles, with an offset
+	UPSNCoordinateSpace* Swapped = NewObject<UPSNCoordinateSpace>();
+	Swapped->UnrealX = EPSNAxis::PSN_Y;
+	Swapped->UnrealY = EPSNAxis::PSN_X;
+	Swapped->Offset = FVector(0.0, 0.0, 50.0);
+
+	const FPSNCoordinateTransform Transform = Swapped->MakeTransform();
+	FPSNTrackerRecord Mapped = Source;
+	Transform.Apply(&Mapped, 1);
+	TestTrue(TEXT("Swapped position"), Mapped.Position.Equals(FVector3f(200.f, 100.f, 350.f), Tolerance));
+	TestTrue(TEXT("Swapped speed"), Mapped.Speed.Equals(FVector3f(0.f, 0.5f, 0.f), Tolerance));
+
+	// Swapping two axes mirrors the space, which reverses the direction of rotation
+	TestTrue(TEXT("Mirrored orientation"), Mapped.Orientation.Equals(FVector3f(0.f, 0.f, -0.25f), Tolerance));
+
+	// A tracker without a position does not pick up the offset
+	FPSNTrackerRecord Unplaced;
+	Unplaced.Orientation = Source.Orientation;
+	Unplaced.Fields = EPSNTrackerField::Orientation;
+	Transform.Apply(&Unplaced, 1);
+	TestTrue(TEXT("Unset position left alone"), Unplaced.Position.IsZero() && Unplaced.TargetPosition.IsZero());
+	TestFalse(TEXT("Unset position stays unset"), Unplaced.HasField(EPSNTrackerField::Position));
+
+	// The sender applies the inverse and gets the original back
+	Transform.Inverse().Apply(&Mapped, 1);
+	TestTrue(TEXT("Inverse position"), Mapped.Position.Equals(Source.Position, Tolerance));
+	TestTrue(TEXT("Inverse speed"), Mapped.Speed.Equals(Source.Speed, Tolerance));
+	TestTrue(TEXT("Inverse orientation"), Mapped.Orientation.Equals(Source.Orientation, Tolerance));
+
+	// A rotated space turns the rotation axis with it
+	UPSNCoordinateSpace* Rotated = NewObject<UPSNCoordinateSpace>();
+	Rotated->Rotation = FRotator(0.0, 90.0, 0.0);
+	FPSNTrackerRecord Turned;
+	Turned.Orientation = FVector3f(0.25f, 0.f, 0.f);
+	Rotated->MakeTransform().Apply(&Turned, 1);
+	TestTrue(TEXT("Rotated orientation axis"), Turned.Orientation.Equals(FVector3f(0.f, 0.25f, 0.f), Tolerance));
+
+	// A negative scale mirrors positions, and speeds and orientations with them
+	UPSNCoordinateSpace* Mirrored = NewObject<UPSNCoordinateSpace>();
+	Mirrored->Scale = FVector(-2.0, 1.0, 1.0);
+
+	const FPSNCoordinateTransform MirrorTransform = Mirrored->MakeTransform();
+	FPSNTrackerRecord Flipped = Source;
+	MirrorTransform.Apply(&Flipped, 1);
+	TestTrue(TEXT("Negative scale position"), Flipped.Position.Equals(FVector3f(-200.f, 200.f, 300.f), Tolerance));
+	TestTrue(TEXT("Negative scale speed"), Flipped.Speed.Equals(FVector3f(-0.5f, 0.f, 0.f), Tolerance));
+	TestTrue(TEXT("Negative scale orientation"), Flipped.Orientation.Equals(FVector3f(0.f, 0.f, -0.25f), Tolerance));
+
+	// Rotation about the mirrored axis itself keeps its direction
+	FPSNTrackerRecord AboutMirrorAxis;
+	AboutMirrorAxis.Orientation = FVector3f(0.25f, 0.f, 0.f);
+	MirrorTransform.Apply(&AboutMirrorAxis, 1);
+	TestTrue(TEXT("Negative scale orientation about the mirrored axis"), AboutMirrorAxis.Orientation.Equals(FVector3f(0.25f, 0.f, 0.f), Tolerance));
+
+	MirrorTransform.Inverse().Apply(&Flipped, 1);
+	TestTrue(TEXT("Negative scale inverse position"), Flipped.Position.Equals(Source.Position, Tolerance));
+	TestTrue(TEXT("Negative scale inverse speed"), Flipped.Speed.Equals(Source.Speed, Tolerance));
+	TestTrue(TEXT("Negative scale inverse orientation"), Flipped.Orientation.Equals(Source.Orientation, Tolerance));
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,91 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+#include "PSNFrameSequence.h"
+#include "PSNStream.h"
+#include "PSN/psn_lib.hpp"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPSNFrameSequenceTest, "PosiStageNet.FrameSequence", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPSNFrameSequenceTest::RunTest(const FString& Parameters)
+{
+	FPSNFrameSequence Sequence;
+	double Now = 10.0;
+
+	FPSNFrameSequenceResult Result = Sequence.Push(250, 1, Now);
+	TestTrue(TEXT("First frame accepted"), Result.bAccept && Result.bNewFrame && Result.FramesLost == 0);
+
+	// Across the wrap from 255 to 0, skipping 254 and 0
+	Sequence.Push(251, 1, Now);
+	Sequence.Push(252, 1, Now);
+	Sequence.Push(253, 1, Now);
+	Sequence.Push(255, 1, Now);
+	Result = Sequence.Push(1, 1, Now);
+	TestTrue(TEXT("Newer across the wrap"), Result.bAccept && Result.bNewFrame);
+	TestEqual(TEXT("One frame lost across the wrap"), (int32)Result.FramesLost, 1);
+
+	// Frame 0 turns up after frame 1: dropped, and reported as reordered once
+	Result = Sequence.Push(0, 1, Now);
+	TestTrue(TEXT("Late frame dropped"), !Result.bAccept && Result.bReordered);
+	Result = Sequence.Push(0, 1, Now);
+	TestTrue(TEXT("Repeated late frame is a duplicate, not reordered again"), !Result.bAccept && !Result.bReordered && Result.bDuplicate);
+
+	// A received frame sent again
+	Result = Sequence.Push(1, 1, Now);
+	TestTrue(TEXT("Duplicate of the current frame"), !Result.bAccept && Result.bDuplicate);
+	Result = Sequence.Push(255, 1, Now);
+	TestTrue(TEXT("Duplicate of an older frame is dropped and counted as a duplicate"), !Result.bAccept && !Result.bReordered && Result.bDuplicate);
+
+	// A three packet frame that only gets two packets
+	Sequence.Push(2, 3, Now);
+	Result = Sequence.Push(2, 3, Now);
+	TestTrue(TEXT("Second packet of a frame"), Result.bAccept && !Result.bNewFrame);
+	Result = Sequence.Push(3, 1, Now);
+	TestTrue(TEXT("Previous frame was partial"), Result.bAccept && Result.bPreviousPartial);
+	Result = Sequence.Push(4, 1, Now);
+	TestFalse(TEXT("Complete frame is not partial"), Result.bPreviousPartial);
+
+	// The missing packet of the partial frame is late rather than a repeat
+	Result = Sequence.Push(2, 3, Now);
+	TestTrue(TEXT("Late packet of a partial frame is not a duplicate"), !Result.bAccept && !Result.bReordered && !Result.bDuplicate);
+
+	// After a long silence the sender may have restarted, so the jump is not counted as loss
+	Now += FPSNFrameSequence::ResyncSeconds * 2.0;
+	Result = Sequence.Push(100, 1, Now);
+	TestTrue(TEXT("Resync after silence"), Result.bAccept && Result.FramesLost == 0);
+
+	// A jump far backwards is a restart rather than a late packet
+	Result = Sequence.Push(10, 1, Now);
+	TestTrue(TEXT("Restarted IDs accepted"), Result.bAccept && Result.bNewFrame);
+
+	// A packet from just before the restart was never counted as lost, so it is late but not reordered
+	Result = Sequence.Push(9, 1, Now);
+	TestTrue(TEXT("Late packet from before a restart is neither reordered nor a duplicate"), !Result.bAccept && !Result.bReordered && !Result.bDuplicate);
+
+	// Likewise when joining a stream mid way
+	FPSNFrameSequence Joined;
+	Joined.Push(50, 1, Now);
+	Result = Joined.Push(49, 1, Now);
+	TestTrue(TEXT("Late packet from before the first one is not reordered"), !Result.bAccept && !Result.bReordered);
+
+	// Frame ID and packet count read straight from an encoded packet
+	::psn::psn_encoder Encoder("Test");
+	::psn::tracker_map Trackers;
+	Trackers.emplace(1, ::psn::tracker(1));
+	Encoder.encode_data(Trackers, 0);
+	const std::list<std::string> Packets = Encoder.encode_data(Trackers, 0);
+	uint16 PacketID = 0;
+	uint8 FrameID = 0;
+	uint8 PacketCount = 0;
+	TestTrue(TEXT("Header found"), FPSNStream::PeekHeader((const uint8*)Packets.front().data(), (int32)Packets.front().size(), PacketID, FrameID, PacketCount));
+	TestEqual(TEXT("Data packet"), (int32)PacketID, (int32)::psn::DATA_PACKET);
+	TestEqual(TEXT("Frame ID"), (int32)FrameID, (int32)Encoder.get_last_data_frame_id());
+	TestEqual(TEXT("Packet count"), (int32)PacketCount, (int32)Packets.size());
+	TestFalse(TEXT("Truncated packet"), FPSNStream::PeekHeader((const uint8*)Packets.front().data(), 6, PacketID, FrameID, PacketCount));
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,43 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+#include "PSNIDAllocator.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPSNIDAllocatorTest, "PosiStageNet.Sender.IDAllocator", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPSNIDAllocatorTest::RunTest(const FString& Parameters)
+{
+	TUniquePtr<FPSNIDAllocator> IDs = MakeUnique<FPSNIDAllocator>();
+
+	TestTrue(TEXT("Claim a specific ID"), IDs->Allocate(5));
+	TestFalse(TEXT("Claiming it again fails"), IDs->Allocate(5));
+	TestFalse(TEXT("Out of range IDs are refused"), IDs->Allocate(FPSNIDAllocator::NumIDs));
+	TestEqual(TEXT("First free skips used IDs"), IDs->FindFirstFree(5), 6);
+
+	// Fill a whole word and the start of the next, so the search has to cross words
+	for (int32 ID = 1; ID < 130; ID++)
+	{
+		IDs->Allocate(ID);
+	}
+	TestEqual(TEXT("First free after a full word"), IDs->AllocateFirstFree(1), 130);
+
+	IDs->Free(64);
+	TestFalse(TEXT("Freed ID is not in use"), IDs->IsAllocated(64));
+	TestEqual(TEXT("Freed ID is reused first"), IDs->FindFirstFree(1), 64);
+
+	// Exhaust the range
+	while (IDs->AllocateFirstFree(0) != INDEX_NONE)
+	{
+	}
+	TestEqual(TEXT("Every ID in use"), IDs->Num(), FPSNIDAllocator::NumIDs);
+	TestEqual(TEXT("No free ID when full"), IDs->FindFirstFree(1), (int32)INDEX_NONE);
+
+	IDs->Free(FPSNIDAllocator::NumIDs - 1);
+	TestEqual(TEXT("Last ID found through the summary"), IDs->FindFirstFree(1), FPSNIDAllocator::NumIDs - 1);
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,71 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+#include "PSNInfoTable.h"
+#include "PSNStream.h"
+#include "PSN/psn_lib.hpp"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPSNInfoTableTest, "PosiStageNet.InfoTable", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPSNInfoTableTest::RunTest(const FString& Parameters)
+{
+	const uint32 SourceA = 0x0A000001;
+	const uint32 SourceB = 0x0A000002;
+
+	const auto MakeInfo = [](const TCHAR* SystemName, TMap<int32, FString> Names)
+	{
+		FPSNSourceInfo Info;
+		Info.SystemName = SystemName;
+		Info.TrackerNames = MoveTemp(Names);
+		return Info;
+	};
+
+	FPSNInfoTable Table;
+	TArray<FPSNTrackerInfo> Changed;
+	Table.SetSource(SourceA, MakeInfo(TEXT("Desk"), { { 1, TEXT("Lead") }, { 2, TEXT("Chorus") } }), Changed);
+	TestEqual(TEXT("Every tracker of a new source is reported"), Changed.Num(), 2);
+	TestTrue(TEXT("Reported with the system name"), Changed.Num() > 0 && Changed[0].SystemName == TEXT("Desk"));
+
+	Changed.Reset();
+	Table.SetSource(SourceA, MakeInfo(TEXT("Desk"), { { 1, TEXT("Lead") }, { 2, TEXT("Chorus") } }), Changed);
+	TestEqual(TEXT("Nothing reported when unchanged"), Changed.Num(), 0);
+
+	Table.SetSource(SourceA, MakeInfo(TEXT("Desk"), { { 1, TEXT("Lead") }, { 2, TEXT("Understudy") } }), Changed);
+	TestTrue(TEXT("Only the renamed tracker is reported"), Changed.Num() == 1 && Changed[0].ID == 2 && Changed[0].Name == TEXT("Understudy"));
+
+	// Two sources announcing the same ID: the merged name follows the latest, and falls back when it is dropped
+	Changed.Reset();
+	Table.SetSource(SourceB, MakeInfo(TEXT("Backup"), { { 1, TEXT("Lead B") } }), Changed);
+	TestTrue(TEXT("Latest source wins"), Table.FindName(1) && *Table.FindName(1) == TEXT("Lead B"));
+	TestTrue(TEXT("Per source name kept"), Table.FindName(SourceA, 1) && *Table.FindName(SourceA, 1) == TEXT("Lead"));
+	Table.SetSource(SourceB, MakeInfo(TEXT("Backup"), {}), Changed);
+	TestTrue(TEXT("Falls back to the other source"), Table.FindName(1) && *Table.FindName(1) == TEXT("Lead"));
+	Table.SetSource(SourceA, MakeInfo(TEXT("Desk"), { { 1, TEXT("Lead") } }), Changed);
+	TestNull(TEXT("Dropped name is forgotten"), Table.FindName(2));
+	TestTrue(TEXT("System name per source"), Table.FindSource(SourceB) && Table.FindSource(SourceB)->SystemName == TEXT("Backup"));
+
+	// Names come from the info frame, and decoded data trackers carry none
+	::psn::psn_encoder Encoder("Stage");
+	::psn::tracker_map Trackers;
+	Trackers.emplace(7, ::psn::tracker(7, "Flown"));
+	::psn::psn_decoder Decoder;
+	for (const std::string& Packet : Encoder.encode_info(Trackers, 0))
+	{
+		Decoder.decode(Packet.data(), Packet.size());
+	}
+	for (const std::string& Packet : Encoder.encode_data(Trackers, 0))
+	{
+		Decoder.decode(Packet.data(), Packet.size());
+	}
+	FPSNSourceInfo Converted;
+	FPSNStream::ConvertInfo(Decoder, Converted);
+	TestEqual(TEXT("System name converted"), Converted.SystemName, FString(TEXT("Stage")));
+	TestTrue(TEXT("Tracker name converted"), Converted.TrackerNames.FindRef(7) == TEXT("Flown"));
+	TestTrue(TEXT("Data tracker has no name"), Decoder.get_data().trackers.count(7) == 1 && Decoder.get_data().trackers.at(7).get_name().empty());
+
+	return true;
+}
+
+#endif
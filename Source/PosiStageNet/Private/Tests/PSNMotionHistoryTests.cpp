@@ -0,0 +1,36 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+#include "PSNSenderSubsystem.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPSNMotionHistoryTest, "PosiStageNet.Sender.MotionHistory", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPSNMotionHistoryTest::RunTest(const FString& Parameters)
+{
+	// x = 0.5 * a * t^2 + v0 * t with a = 4 m/s^2 and v0 = 1 m/s, sampled at uneven intervals
+	const auto PositionAt = [](double T) { return FVector(2.0 * T * T + T, 0.0, 1.0); };
+
+	FPSNMotionHistory History;
+	History.Push(PositionAt(0.0), 0.0);
+	TestEqual(TEXT("No speed from one sample"), History.GetVelocity(), FVector::ZeroVector);
+
+	History.Push(PositionAt(0.02), 0.02);
+	TestEqual(TEXT("No acceleration from two samples"), History.GetAcceleration(), FVector::ZeroVector);
+
+	History.Push(PositionAt(0.05), 0.05);
+	TestTrue(TEXT("Acceleration from uneven samples"), History.GetAcceleration().Equals(FVector(4.0, 0.0, 0.0), 1e-3));
+
+	// Backward difference is the speed halfway between the last two samples
+	TestTrue(TEXT("Speed"), History.GetVelocity().Equals(FVector(4.0 * 0.035 + 1.0, 0.0, 0.0), 1e-3));
+
+	// A repeated time (paused clock) must not divide by zero
+	History.Push(PositionAt(0.05), 0.05);
+	TestFalse(TEXT("Repeated time keeps a finite speed"), History.GetVelocity().ContainsNaN());
+	TestFalse(TEXT("Repeated time keeps a finite acceleration"), History.GetAcceleration().ContainsNaN());
+
+	return true;
+}
+
+#endif
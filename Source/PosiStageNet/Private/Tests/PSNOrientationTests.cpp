@@ -0,0 +1,55 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+#include "PSNOrientation.h"
+#include "Math/RandomStream.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPSNOrientationTest, "PosiStageNet.Orientation", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPSNOrientationTest::RunTest(const FString& Parameters)
+{
+	const float Tolerance = 1e-4f;
+
+	// A quarter turn about Z
+	const FVector3f QuarterTurn(0.f, 0.f, HALF_PI);
+	const FQuat4f Expected(FVector3f::UpVector, HALF_PI);
+	TestTrue(TEXT("Axis-angle to quaternion"), PSNOrientation::AxisAngleToQuat(QuarterTurn).Equals(Expected, Tolerance));
+	TestTrue(TEXT("Quaternion to axis-angle"), PSNOrientation::QuatToAxisAngle(Expected).Equals(QuarterTurn, Tolerance));
+	TestTrue(TEXT("Negated quaternion is the same rotation"), PSNOrientation::QuatToAxisAngle(Expected * -1.f).Equals(QuarterTurn, Tolerance));
+	TestTrue(TEXT("Zero rotation"), PSNOrientation::QuatToAxisAngle(FQuat4f::Identity).IsNearlyZero(Tolerance));
+
+	// Roll survives the round trip through a rotator
+	const FRotator Rotator(20.0, -35.0, 60.0);
+	TestTrue(TEXT("Rotator round trip keeps roll"), PSNOrientation::AxisAngleToRotator(PSNOrientation::RotatorToAxisAngle(Rotator)).Equals(Rotator, 0.01));
+
+	// Batches match the single conversions, including the tail that does not fill a vector
+	FRandomStream Random(1);
+	const int32 Num = 23;
+	TArray<FQuat4f> Quats;
+	for (int32 Index = 0; Index < Num; Index++)
+	{
+		const FQuat4f Quat(FRotator3f(Random.FRandRange(-89.f, 89.f), Random.FRandRange(-180.f, 180.f), Random.FRandRange(-180.f, 180.f)));
+		Quats.Add(Index % 3 == 0 ? Quat * -1.f : Quat);
+	}
+
+	TArray<FVector3f> AxisAngles;
+	AxisAngles.SetNumUninitialized(Num);
+	PSNOrientation::QuatsToAxisAngles(Quats.GetData(), AxisAngles.GetData(), sizeof(FVector3f), Num);
+
+	TArray<FQuat4f> RoundTrip;
+	RoundTrip.SetNumUninitialized(Num);
+	PSNOrientation::AxisAnglesToQuats(AxisAngles.GetData(), sizeof(FVector3f), RoundTrip.GetData(), Num);
+
+	for (int32 Index = 0; Index < Num; Index++)
+	{
+		TestTrue(FString::Printf(TEXT("Batch axis-angle %d"), Index), AxisAngles[Index].Equals(PSNOrientation::QuatToAxisAngle(Quats[Index]), Tolerance));
+		TestTrue(FString::Printf(TEXT("Batch quaternion %d"), Index), RoundTrip[Index].Equals(PSNOrientation::AxisAngleToQuat(AxisAngles[Index]), Tolerance));
+		TestTrue(FString::Printf(TEXT("Batch round trip %d"), Index), FQuat(RoundTrip[Index]).AngularDistance(FQuat(Quats[Index])) < Tolerance * 10.0);
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,81 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+#include "PSNRedundantMerge.h"
+#include "PSN/psn_lib.hpp"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPSNRedundantMergeTest, "PosiStageNet.RedundantMerge", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPSNRedundantMergeTest::RunTest(const FString& Parameters)
+{
+	// The same sender on two networks
+	const uint32 PrimaryAddress = 0x0A000105;
+	const uint32 BackupAddress = 0x0A000205;
+	double Now = 100.0;
+
+	::psn::psn_encoder Encoder("Redundant");
+	::psn::tracker_map Trackers;
+	for (uint16 ID = 1; ID <= 3; ID++)
+	{
+		Trackers.emplace(ID, ::psn::tracker(ID));
+	}
+	const auto Encode = [&Encoder, &Trackers](uint64 Timestamp)
+	{
+		const std::list<std::string> Packets = Encoder.encode_data(Trackers, Timestamp);
+		return Packets.front();
+	};
+
+	FPSNRedundantMerge Merge;
+	uint32 SourceKey = 0;
+
+	const std::string First = Encode(1000);
+	TestTrue(TEXT("First copy passed on"), Merge.Push((const uint8*)First.data(), (int32)First.size(), PrimaryAddress, Now, SourceKey));
+	TestEqual(TEXT("Keyed by its own address"), (int64)SourceKey, (int64)PrimaryAddress);
+	TestFalse(TEXT("Second copy dropped"), Merge.Push((const uint8*)First.data(), (int32)First.size(), BackupAddress, Now + 0.001, SourceKey));
+	TestEqual(TEXT("Backup merged under the primary"), (int64)Merge.GetSourceKey(BackupAddress), (int64)PrimaryAddress);
+
+	// The backup network wins the next frame, which still belongs to the primary's stream
+	const std::string Second = Encode(2000);
+	TestTrue(TEXT("Backup copy first"), Merge.Push((const uint8*)Second.data(), (int32)Second.size(), BackupAddress, Now + 0.01, SourceKey));
+	TestEqual(TEXT("Backup first arrival keeps the stream's key"), (int64)SourceKey, (int64)PrimaryAddress);
+	TestFalse(TEXT("Late primary copy dropped"), Merge.Push((const uint8*)Second.data(), (int32)Second.size(), PrimaryAddress, Now + 0.012, SourceKey));
+
+	// Another sender is never merged
+	const uint32 OtherAddress = 0x0A000109;
+	const std::string Other = Encode(2000);
+	TestTrue(TEXT("Different packet passed on"), Merge.Push((const uint8*)Other.data(), (int32)Other.size(), OtherAddress, Now + 0.02, SourceKey));
+	TestEqual(TEXT("Other sender keeps its own key"), (int64)SourceKey, (int64)OtherAddress);
+
+	// The same bytes long after the first copy are a new packet
+	TestTrue(TEXT("Outside the window"), Merge.Push((const uint8*)First.data(), (int32)First.size(), PrimaryAddress, Now + FPSNRedundantMerge::WindowSeconds * 2.0, SourceKey));
+
+	// At a high packet rate the ring grows rather than forgetting a packet still inside the time window
+	Now += 10.0;
+	const std::string Oldest = Encode(3000);
+	Merge.Push((const uint8*)Oldest.data(), (int32)Oldest.size(), PrimaryAddress, Now, SourceKey);
+	for (int32 Index = 0; Index < FPSNRedundantMerge::InitialWindowSize * 4; Index++)
+	{
+		const std::string Packet = Encode(4000 + Index);
+		Merge.Push((const uint8*)Packet.data(), (int32)Packet.size(), PrimaryAddress, Now + Index * 1e-5, SourceKey);
+	}
+	TestTrue(TEXT("Ring grew"), Merge.GetWindowSize() > FPSNRedundantMerge::InitialWindowSize * 4);
+	TestFalse(TEXT("Copy within the time window still dropped"), Merge.Push((const uint8*)Oldest.data(), (int32)Oldest.size(), BackupAddress, Now + 0.1, SourceKey));
+
+	// At a low packet rate the oldest entries have left the time window before the ring wraps, so it stays small
+	FPSNRedundantMerge Slow;
+	for (int32 Index = 0; Index < FPSNRedundantMerge::InitialWindowSize * 2; Index++)
+	{
+		const std::string Packet = Encode(8000 + Index);
+		Slow.Push((const uint8*)Packet.data(), (int32)Packet.size(), PrimaryAddress, Now + Index * 0.01, SourceKey);
+	}
+	TestEqual(TEXT("Ring not grown at a low rate"), Slow.GetWindowSize(), FPSNRedundantMerge::InitialWindowSize);
+
+	Merge.Reset();
+	TestEqual(TEXT("Reset forgets merged sources"), (int64)Merge.GetSourceKey(BackupAddress), (int64)BackupAddress);
+
+	return true;
+}
+
+#endif
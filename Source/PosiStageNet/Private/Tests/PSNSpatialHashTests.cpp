@@ -0,0 +1,127 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+#include "PSNSpatialHash.h"
+#include "Misc/AutomationTest.h"
+#include "Math/RandomStream.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPSNSpatialHashTest, "PosiStageNet.SpatialHash", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPSNSpatialHashTest::RunTest(const FString& Parameters)
+{
+	FRandomStream Random(1234);
+	const auto RandomPosition = [&Random]()
+	{
+		return FVector3f(Random.FRandRange(-2000.f, 2000.f), Random.FRandRange(-2000.f, 2000.f), Random.FRandRange(0.f, 500.f));
+	};
+
+	FPSNSpatialHash Hash(150.f);
+	TMap<int32, FVector3f> Positions;
+	for (int32 ID = 0; ID < 500; ID++)
+	{
+		const FVector3f Position = RandomPosition();
+		Hash.Update(ID, Position);
+		Positions.Add(ID, Position);
+	}
+
+	// Move some trackers across cells, nudge others within theirs, and drop a few
+	for (int32 ID = 0; ID < 500; ID += 3)
+	{
+		const FVector3f Position = RandomPosition();
+		Hash.Update(ID, Position);
+		Positions[ID] = Position;
+	}
+	for (int32 ID = 1; ID < 500; ID += 7)
+	{
+		const FVector3f Position = Positions[ID] + FVector3f(1.f, 0.f, 0.f);
+		Hash.Update(ID, Position);
+		Positions[ID] = Position;
+	}
+	for (int32 ID = 2; ID < 500; ID += 11)
+	{
+		Hash.Remove(ID);
+		Positions.Remove(ID);
+	}
+	TestEqual(TEXT("Tracker count"), Hash.Num(), Positions.Num());
+
+	const auto CheckQueries = [&](const TCHAR* Stage)
+	{
+		for (int32 Query = 0; Query < 20; Query++)
+		{
+			const FVector Center(RandomPosition());
+			const float Radius = Random.FRandRange(0.f, 800.f);
+
+			TArray<int32> Found;
+			Hash.QueryRadius(Center, Radius, Found);
+			TArray<int32> Expected;
+			for (const TPair<int32, FVector3f>& Pair : Positions)
+			{
+				if (FVector::DistSquared(FVector(Pair.Value), Center) <= Radius * Radius)
+				{
+					Expected.Add(Pair.Key);
+				}
+			}
+			Found.Sort();
+			Expected.Sort();
+			TestTrue(FString::Printf(TEXT("%s: radius query matches brute force"), Stage), Found == Expected);
+
+			const FBox Box = FBox(Center - FVector(Radius), Center + FVector(Radius * 0.5f));
+			Hash.QueryBox(Box, Found);
+			Expected.Reset();
+			for (const TPair<int32, FVector3f>& Pair : Positions)
+			{
+				if (Box.IsInsideOrOn(FVector(Pair.Value)))
+				{
+					Expected.Add(Pair.Key);
+				}
+			}
+			Found.Sort();
+			Expected.Sort();
+			TestTrue(FString::Printf(TEXT("%s: box query matches brute force"), Stage), Found == Expected);
+
+			// Compare distances rather than IDs, as equally distant trackers may come back in either order
+			const int32 Count = 8;
+			Hash.QueryNearest(Center, Count, Found);
+			TArray<float> Distances;
+			for (const TPair<int32, FVector3f>& Pair : Positions)
+			{
+				Distances.Add(FVector::Dist(FVector(Pair.Value), Center));
+			}
+			Distances.Sort();
+			bool bNearestMatches = Found.Num() == FMath::Min(Count, Distances.Num());
+			for (int32 Index = 0; bNearestMatches && Index < Found.Num(); Index++)
+			{
+				bNearestMatches = FMath::IsNearlyEqual(FVector::Dist(FVector(Positions[Found[Index]]), Center), Distances[Index], 0.01);
+			}
+			TestTrue(FString::Printf(TEXT("%s: nearest query matches brute force"), Stage), bNearestMatches);
+
+			Hash.QueryNearest(Center, Count, Found, Radius);
+			bool bWithinMax = true;
+			for (const int32 ID : Found)
+			{
+				bWithinMax &= FVector::Dist(FVector(Positions[ID]), Center) <= Radius + 0.01;
+			}
+			TestTrue(FString::Printf(TEXT("%s: nearest query respects the max distance"), Stage), bWithinMax);
+		}
+	};
+
+	CheckQueries(TEXT("Initial cell size"));
+
+	// Re-bucketing must keep every tracker
+	Hash.SetCellSize(40.f);
+	TestEqual(TEXT("Tracker count after resizing"), Hash.Num(), Positions.Num());
+	CheckQueries(TEXT("Small cells"));
+
+	Hash.SetCellSize(5000.f);
+	CheckQueries(TEXT("Single cell"));
+
+	Hash.Reset();
+	TArray<int32> Found;
+	Hash.QueryNearest(FVector::ZeroVector, 4, Found);
+	TestEqual(TEXT("Nothing found after reset"), Found.Num(), 0);
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,399 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+#include "PSNTestHarness.h"
+#include "Misc/AutomationTest.h"
+#include "HAL/IConsoleManager.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace PSNTests
+{
+	static float BudgetScale = 1.f;
+	static FAutoConsoleVariableRef CVarBudgetScale(
+		TEXT("psn.Tests.BudgetScale"),
+		BudgetScale,
+		TEXT("Multiplier applied to the PSN pipeline timing budgets, for slower test machines."));
+
+	// Per frame budget: a fixed overhead plus a cost per tracker, in microseconds
+	struct FBudget
+	{
+		const TCHAR* Stage;
+		double FixedMicroseconds;
+		double PerTrackerMicroseconds;
+
+		double For(int32 TrackerCount) const
+		{
+			return (FixedMicroseconds + PerTrackerMicroseconds * TrackerCount) * BudgetScale;
+		}
+	};
+
+	// Generous enough for a development build on a shared CI machine, tight enough to catch a quadratic regression
+	static const FBudget BuildBudget = { TEXT("BuildTrackerList"), 200.0, 2.0 };
+	static const FBudget EncodeBudget = { TEXT("Encode"), 200.0, 2.0 };
+	static const FBudget DecodeBudget = { TEXT("Decode"), 200.0, 3.0 };
+	static const FBudget DispatchBudget = { TEXT("Dispatch"), 200.0, 10.0 };
+
+	static const int32 MeasuredFrames = 10;
+
+	// Frames of the measured run allowed to go missing over loopback, and how long to wait before calling one lost
+	static const int32 MaxLostFrames = 2;
+	static const double FrameTimeout = 0.5;
+
+	static FString TrackerName(int32 ID)
+	{
+		return FString::Printf(TEXT("Tracker_%d"), ID);
+	}
+
+	// Register Count trackers on the sender, IDs starting at 1
+	static void AddTrackers(UPSNSenderSubsystem& Sender, int32 Count)
+	{
+		for (int32 ID = 1; ID <= Count; ID++)
+		{
+			Sender.AddTracker(FPSNTrackerInfo(ID, TrackerName(ID)));
+
+			FPSNTrackerData Data;
+			Data.Position = FVector(ID * 10.0, ID * -5.0, 180.0);
+			Data.Status = 1.f;
+			Sender.UpdateTracker(FName(*TrackerName(ID)), Data);
+		}
+	}
+
+	static void CheckBudget(FAutomationTestBase& Test, const FBudget& Budget, int32 TrackerCount, double MeasuredMicroseconds)
+	{
+		const double Allowed = Budget.For(TrackerCount);
+		Test.AddInfo(FString::Printf(TEXT("%s: %.1f us per frame for %d trackers (budget %.1f us)"), Budget.Stage, MeasuredMicroseconds, TrackerCount, Allowed));
+		if (MeasuredMicroseconds > Allowed)
+		{
+			Test.AddError(FString::Printf(TEXT("%s exceeded its budget: %.1f us > %.1f us for %d trackers"), Budget.Stage, MeasuredMicroseconds, Allowed, TrackerCount));
+		}
+	}
+
+	static double CyclesToMicroseconds(uint64 Cycles)
+	{
+		return FPlatformTime::ToMilliseconds64(Cycles) * 1000.0;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPSNRoundTripTest, "PosiStageNet.Subsystems.RoundTrip", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPSNRoundTripTest::RunTest(const FString& Parameters)
+{
+	FPSNTestHarness Harness;
+	if (!TestTrue(TEXT("Sender and receiver started"), Harness.IsValid()))
+	{
+		return false;
+	}
+
+	const int32 TrackerCount = 3;
+	TArray<FPSNTrackerData> Sent;
+	for (int32 ID = 1; ID <= TrackerCount; ID++)
+	{
+		Harness.Sender->AddTracker(FPSNTrackerInfo(ID, PSNTests::TrackerName(ID)));
+
+		FPSNTrackerData Data;
+		Data.Position = FVector(123.4 * ID, -56.7, 890.1);
+		Data.Speed = FVector(1.5, -2.5, 0.25 * ID);
+		Data.Orientation = FRotator(10.0 * ID, 45.0 - 20.0 * ID, 30.0 * ID - 75.0);
+		Data.Status = 0.5f * ID;
+		Data.Acceleration = FVector(0.1, 0.2, 0.3);
+		Data.TargetPosition = FVector(-300.0, 250.0 * ID, 0.0);
+		Harness.Sender->UpdateTracker(FName(*PSNTests::TrackerName(ID)), Data);
+		Sent.Add(Data);
+	}
+
+	// Names travel in the info packet, so it must arrive before the data
+	Harness.Sender->SendInfo();
+	if (!TestTrue(TEXT("Info packet received over multicast loopback"), Harness.WaitForPackets(1)))
+	{
+		return false;
+	}
+
+	Harness.Sender->SendData();
+	if (!TestTrue(TEXT("Data packet dispatched"), Harness.WaitForDispatched(TrackerCount)))
+	{
+		return false;
+	}
+
+	TArray<FPSNTracker> Received;
+	Harness.Receiver->GetLatestTrackers(Received);
+	TestEqual(TEXT("Tracker count"), Received.Num(), TrackerCount);
+
+	// The frame is stamped once, so every tracker in it carries the same time
+	for (const FPSNTracker& Tracker : Received)
+	{
+		TestEqual(FString::Printf(TEXT("Tracker %d timestamp matches the frame"), Tracker.Info.ID), Tracker.Header.Timestamp, (int64)Harness.Sender->GetTimestamp());
+	}
+
+	const float UnitTolerance = 0.01f;
+	const float AngleTolerance = 0.01f;
+
+	for (const FPSNTracker& Tracker : Received)
+	{
+		const int32 ID = Tracker.Info.ID;
+		if (!TestTrue(FString::Printf(TEXT("Tracker %d was sent"), ID), ID >= 1 && ID <= TrackerCount))
+		{
+			continue;
+		}
+
+		const FPSNTrackerData& Expected = Sent[ID - 1];
+		const FPSNTrackerData& Actual = Tracker.Data;
+
+		TestEqual(FString::Printf(TEXT("Tracker %d name"), ID), Tracker.Info.Name, PSNTests::TrackerName(ID));
+		TestTrue(FString::Printf(TEXT("Tracker %d position round trips through meters"), ID), Actual.Position.Equals(Expected.Position, UnitTolerance));
+		TestTrue(FString::Printf(TEXT("Tracker %d target position round trips through meters"), ID), Actual.TargetPosition.Equals(Expected.TargetPosition, UnitTolerance));
+		TestTrue(FString::Printf(TEXT("Tracker %d speed"), ID), Actual.Speed.Equals(Expected.Speed, UnitTolerance));
+		TestTrue(FString::Printf(TEXT("Tracker %d acceleration"), ID), Actual.Acceleration.Equals(Expected.Acceleration, UnitTolerance));
+		TestTrue(FString::Printf(TEXT("Tracker %d orientation"), ID), Actual.Orientation.Equals(Expected.Orientation, AngleTolerance));
+		TestEqual(FString::Printf(TEXT("Tracker %d roll"), ID), Actual.Orientation.Roll, Expected.Orientation.Roll, AngleTolerance);
+		TestEqual(FString::Printf(TEXT("Tracker %d status"), ID), Actual.Status, Expected.Status);
+	}
+
+	return true;
+}
+
+IMPLEMENT_COMPLEX_AUTOMATION_TEST(FPSNPipelineBudgetTest, "PosiStageNet.Subsystems.PipelineBudget", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+void FPSNPipelineBudgetTest::GetTests(TArray<FString>& OutBeautifiedNames, TArray<FString>& OutTestCommands) const
+{
+	for (const int32 TrackerCount : { 100, 1000, 5000 })
+	{
+		OutBeautifiedNames.Add(FString::Printf(TEXT("%d Trackers"), TrackerCount));
+		OutTestCommands.Add(FString::FromInt(TrackerCount));
+	}
+}
+
+bool FPSNPipelineBudgetTest::RunTest(const FString& Parameters)
+{
+	const int32 TrackerCount = FCString::Atoi(*Parameters);
+
+	FPSNTestHarness Harness;
+	if (!TestTrue(TEXT("Sender and receiver started"), Harness.IsValid()))
+	{
+		return false;
+	}
+
+	PSNTests::AddTrackers(*Harness.Sender, TrackerCount);
+
+	Harness.Sender->SendInfo();
+	if (!TestTrue(TEXT("Info packet received over multicast loopback"), Harness.WaitForPackets(1)))
+	{
+		return false;
+	}
+
+	// Warm up frame, so first use allocations are not measured. Loopback UDP may still drop a packet, so retry.
+	bool bWarmedUp = false;
+	for (int32 Attempt = 0; Attempt < PSNTests::MaxLostFrames + 1 && !bWarmedUp; Attempt++)
+	{
+		Harness.Sender->SendData();
+		bWarmedUp = Harness.WaitForDispatched(TrackerCount, PSNTests::FrameTimeout);
+	}
+	if (!TestTrue(TEXT("Warm up frame dispatched"), bWarmedUp))
+	{
+		return false;
+	}
+
+	const FPSNSenderStats& SenderStats = Harness.Sender->GetStats();
+	const FPSNReceiverStats& ReceiverStats = Harness.Receiver->GetStats();
+
+	const uint64 BuildStart = SenderStats.BuildCycles.load();
+	const uint64 BuildsStart = SenderStats.TrackerListBuilds.load();
+	const uint64 EncodeStart = SenderStats.EncodeCycles.load();
+	const uint64 DecodeStart = ReceiverStats.DecodeCycles.load();
+	const uint64 CompletedStart = ReceiverStats.FramesCompleted.load();
+	const uint64 DispatchStart = ReceiverStats.DispatchCycles.load();
+	const uint64 DispatchedStart = ReceiverStats.TrackersDispatched.load();
+
+	// Wait for each frame before sending the next so the socket buffer never overflows. A frame of thousands of
+	// trackers spans many datagrams and loopback UDP gives no delivery guarantee, so a few lost frames are allowed.
+	int32 FramesLost = 0;
+	uint64 ExpectedDispatched = DispatchedStart;
+	for (int32 Frame = 1; Frame <= PSNTests::MeasuredFrames; Frame++)
+	{
+		Harness.Sender->SendData();
+		ExpectedDispatched += TrackerCount;
+		if (!Harness.WaitForDispatched(ExpectedDispatched, PSNTests::FrameTimeout))
+		{
+			FramesLost++;
+			ExpectedDispatched = ReceiverStats.TrackersDispatched.load();
+		}
+	}
+
+	AddInfo(FString::Printf(TEXT("%d of %d frames of %d trackers lost over loopback"), FramesLost, PSNTests::MeasuredFrames, TrackerCount));
+	if (!TestTrue(FString::Printf(TEXT("At most %d of %d frames lost"), PSNTests::MaxLostFrames, PSNTests::MeasuredFrames), FramesLost <= PSNTests::MaxLostFrames))
+	{
+		return false;
+	}
+
+	// Sender costs are per frame sent, receiver costs per frame that actually arrived
+	const double FramesSent = PSNTests::MeasuredFrames;
+	const double FramesDecoded = (double)FMath::Max<uint64>(ReceiverStats.FramesCompleted.load() - CompletedStart, 1);
+	const double FramesDispatched = FMath::Max((double)(ReceiverStats.TrackersDispatched.load() - DispatchedStart) / TrackerCount, 1.0);
+	const uint64 Builds = SenderStats.TrackerListBuilds.load() - BuildsStart;
+
+	PSNTests::CheckBudget(*this, PSNTests::BuildBudget, TrackerCount, PSNTests::CyclesToMicroseconds(SenderStats.BuildCycles.load() - BuildStart) / FMath::Max<uint64>(Builds, 1));
+	PSNTests::CheckBudget(*this, PSNTests::EncodeBudget, TrackerCount, PSNTests::CyclesToMicroseconds(SenderStats.EncodeCycles.load() - EncodeStart) / FramesSent);
+	PSNTests::CheckBudget(*this, PSNTests::DecodeBudget, TrackerCount, PSNTests::CyclesToMicroseconds(ReceiverStats.DecodeCycles.load() - DecodeStart) / FramesDecoded);
+	PSNTests::CheckBudget(*this, PSNTests::DispatchBudget, TrackerCount, PSNTests::CyclesToMicroseconds(ReceiverStats.DispatchCycles.load() - DispatchStart) / FramesDispatched);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPSNZoneTimeoutTest, "PosiStageNet.Subsystems.ZoneTimeout", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPSNZoneTimeoutTest::RunTest(const FString& Parameters)
+{
+	FPSNStandaloneGameInstance Game;
+	UPSNReceiverSubsystem* Receiver = Game.GetSubsystem<UPSNReceiverSubsystem>();
+	if (!TestNotNull(TEXT("Receiver subsystem"), Receiver))
+	{
+		return false;
+	}
+
+	Receiver->SetTrackerTimeout(0.05f);
+	Receiver->AddBoxZone(TEXT("Stage"), FBox(FVector(-100.0), FVector(100.0)));
+
+	FPSNTrackerRecord Record;
+	Record.ID = 7;
+	Record.Position = FVector3f::ZeroVector;
+	Record.Fields = EPSNTrackerField::Position;
+	Receiver->DispatchTracker(Record, 0, FPlatformTime::Seconds());
+
+	TArray<int32> Occupants;
+	Receiver->Tick(0.f);
+	Receiver->GetZoneOccupants(TEXT("Stage"), Occupants);
+	TestEqual(TEXT("Tracker entered"), Occupants.Num(), 1);
+
+	// No packets past the timeout is an exit, even though the tracker never moved out
+	FPlatformProcess::Sleep(0.1f);
+	Receiver->Tick(0.f);
+	Receiver->GetZoneOccupants(TEXT("Stage"), Occupants);
+	TestEqual(TEXT("Stale tracker exited"), Occupants.Num(), 0);
+
+	TestTrue(TEXT("Last state kept in the snapshot"), Receiver->GetTrackerSnapshot().Contains(7));
+
+	// Received again, it is back in the zone
+	Receiver->DispatchTracker(Record, 0, FPlatformTime::Seconds());
+	Receiver->Tick(0.f);
+	Receiver->GetZoneOccupants(TEXT("Stage"), Occupants);
+	TestEqual(TEXT("Tracker re-entered"), Occupants.Num(), 1);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPSNSourceNamesTest, "PosiStageNet.Subsystems.SourceNames", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPSNSourceNamesTest::RunTest(const FString& Parameters)
+{
+	FPSNStandaloneGameInstance Game;
+	UPSNReceiverSubsystem* Receiver = Game.GetSubsystem<UPSNReceiverSubsystem>();
+	if (!TestNotNull(TEXT("Receiver subsystem"), Receiver))
+	{
+		return false;
+	}
+
+	const uint32 SourceA = 0x0A000001;
+	const uint32 SourceB = 0x0A000002;
+
+	// Both sources use ID 1, and B announces it last
+	FPSNSourceInfo InfoA;
+	InfoA.SystemName = TEXT("Desk A");
+	InfoA.TrackerNames.Add(1, TEXT("Lead A"));
+	Receiver->DispatchSourceInfo(SourceA, MoveTemp(InfoA));
+
+	FPSNSourceInfo InfoB;
+	InfoB.SystemName = TEXT("Desk B");
+	InfoB.TrackerNames.Add(1, TEXT("Lead B"));
+	Receiver->DispatchSourceInfo(SourceB, MoveTemp(InfoB));
+
+	TestEqual(TEXT("Before any data, the latest announcement names the ID"), Receiver->GetTrackerName(1), FString(TEXT("Lead B")));
+
+	FPSNTrackerRecord Record;
+	Record.ID = 1;
+	Record.Fields = EPSNTrackerField::Position;
+	Receiver->DispatchTracker(Record, SourceA, FPlatformTime::Seconds());
+
+	FPSNTracker Tracker;
+	TestTrue(TEXT("Tracker received"), Receiver->GetLatestTracker(1, Tracker));
+	TestEqual(TEXT("Named by the source it came from"), Tracker.Info.Name, FString(TEXT("Lead A")));
+	TestEqual(TEXT("Tracker name follows its source"), Receiver->GetTrackerName(1), FString(TEXT("Lead A")));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPSNSourceConflictTest, "PosiStageNet.Subsystems.SourceConflict", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPSNSourceConflictTest::RunTest(const FString& Parameters)
+{
+	FPSNStandaloneGameInstance Game;
+	UPSNReceiverSubsystem* Receiver = Game.GetSubsystem<UPSNReceiverSubsystem>();
+	if (!TestNotNull(TEXT("Receiver subsystem"), Receiver))
+	{
+		return false;
+	}
+
+	const uint32 SourceA = 0x0A000001;
+	const uint32 SourceB = 0x0A000002;
+	Receiver->SetTrackerTimeout(2.f);
+
+	FPSNTrackerRecord RecordA;
+	RecordA.ID = 1;
+	RecordA.Position = FVector3f(100.f, 0.f, 0.f);
+	RecordA.Fields = EPSNTrackerField::Position;
+
+	FPSNTrackerRecord RecordB = RecordA;
+	RecordB.Position = FVector3f(-100.f, 0.f, 0.f);
+
+	const double Start = FPlatformTime::Seconds();
+	const uint64 ConflictsStart = Receiver->GetStats().TrackerIDConflicts.load();
+	Receiver->DispatchTracker(RecordA, SourceA, Start);
+
+	// A second source with the same ID does not overwrite the first while it is live
+	Receiver->DispatchTracker(RecordB, SourceB, Start + 0.1);
+	const FPSNTrackerSnapshotEntry* Entry = Receiver->GetTrackerSnapshot().Find(1);
+	TestTrue(TEXT("ID held by the first source"), Entry && Entry->SourceAddress == SourceA && Entry->Tracker.Position.X == 100.f);
+	TestEqual(TEXT("Conflict counted"), (int32)(Receiver->GetStats().TrackerIDConflicts.load() - ConflictsStart), 1);
+
+	FVector3f Position;
+	TestTrue(TEXT("Spatial index keeps the first source's position"), Receiver->GetSpatialIndex().GetPosition(1, Position) && Position.X == 100.f);
+
+	// Once the holder has timed out, the other source takes the ID over
+	Receiver->DispatchTracker(RecordB, SourceB, Start + 3.0);
+	Entry = Receiver->GetTrackerSnapshot().Find(1);
+	TestTrue(TEXT("ID taken over after the timeout"), Entry && Entry->SourceAddress == SourceB && Entry->Tracker.Position.X == -100.f);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPSNSendInterfacesTest, "PosiStageNet.Subsystems.SendInterfaces", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPSNSendInterfacesTest::RunTest(const FString& Parameters)
+{
+	FPSNTestHarness Harness;
+	if (!TestTrue(TEXT("Sender and receiver started"), Harness.IsValid()))
+	{
+		return false;
+	}
+
+	TArray<FPSNSendInterfaceStatus> Status;
+	Harness.Sender->GetSendInterfaceStatus(Status);
+	TestTrue(TEXT("Default route until interfaces are chosen"), Status.Num() == 1 && Status[0].Address == TEXT("0.0.0.0"));
+
+	TestFalse(TEXT("Invalid address rejected"), Harness.Sender->SetSendInterfaces({ TEXT("not an address") }));
+	TestFalse(TEXT("Too many interfaces rejected"), Harness.Sender->SetSendInterfaces({ TEXT("127.0.0.1"), TEXT("127.0.0.2"), TEXT("127.0.0.3"), TEXT("127.0.0.4"), TEXT("127.0.0.5") }));
+
+	TestTrue(TEXT("Loopback interface bound"), Harness.Sender->SetSendInterfaces({ TEXT("127.0.0.1") }));
+	Harness.Sender->GetSendInterfaceStatus(Status);
+	TestTrue(TEXT("One status per interface"), Status.Num() == 1 && Status[0].Address == TEXT("127.0.0.1") && Status[0].bHealthy);
+
+	// Back to the default route, and frames still reach the receiver
+	TestTrue(TEXT("Default route restored"), Harness.Sender->SetSendInterfaces({}));
+	Harness.Sender->AddTracker(FPSNTrackerInfo(1, PSNTests::TrackerName(1)));
+	Harness.Sender->SendData();
+	TestTrue(TEXT("Data received on the default route"), Harness.WaitForDispatched(1));
+	Harness.Sender->GetSendInterfaceStatus(Status);
+	TestTrue(TEXT("Default route counted"), Status.Num() == 1 && Status[0].PacketsSent > 0 && Status[0].SecondsSinceLastSend >= 0.f);
+
+	return true;
+}
+
+#endif
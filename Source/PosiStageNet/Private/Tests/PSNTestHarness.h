@@ -0,0 +1,124 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PSNReceiverSubsystem.h"
+#include "PSNSenderSubsystem.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "Engine/Engine.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+#include "HAL/PlatformProcess.h"
+
+/*
+* Standalone game instance and world for running the PSN subsystems outside a map, torn down when it goes out of scope.
+* Shared by the automation tests and the PSN commandlets, so it is built whether or not automation tests are.
+*/
+class FPSNStandaloneGameInstance
+{
+public:
+
+	UE_NONCOPYABLE(FPSNStandaloneGameInstance);
+
+	FPSNStandaloneGameInstance()
+	{
+		GameInstance = NewObject<UGameInstance>(GEngine);
+		GameInstance->AddToRoot();
+		GameInstance->InitializeStandalone();
+	}
+
+	~FPSNStandaloneGameInstance()
+	{
+		if (UPSNReceiverSubsystem* Receiver = GameInstance->GetSubsystem<UPSNReceiverSubsystem>())
+		{
+			Receiver->StopReceiver();
+		}
+
+		// Drain dispatch tasks that still reference the receiver
+		FTaskGraphInterface::Get().ProcessThreadUntilIdle(ENamedThreads::GameThread);
+
+		UWorld* World = GameInstance->GetWorld();
+		GameInstance->Shutdown();
+		if (World)
+		{
+			GEngine->DestroyWorldContext(World);
+			World->DestroyWorld(false);
+		}
+		GameInstance->RemoveFromRoot();
+	}
+
+	template <typename SubsystemType>
+	SubsystemType* GetSubsystem() const
+	{
+		return GameInstance->GetSubsystem<SubsystemType>();
+	}
+
+	UGameInstance* GameInstance = nullptr;
+};
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/*
+* Standalone game instance running a PSN sender and receiver against each other over multicast loopback.
+* Used by the automation tests; everything runs on the game thread, pumping the receiver's dispatch tasks while waiting.
+*/
+class FPSNTestHarness
+{
+public:
+
+	// Port used by the tests, away from the default so a running show is never disturbed
+	static constexpr int32 TestPort = 56600;
+
+	FPSNTestHarness(const FString& InAddress = TEXT("236.10.10.10"), int32 InPort = TestPort)
+	{
+		Sender = Game.GetSubsystem<UPSNSenderSubsystem>();
+		Receiver = Game.GetSubsystem<UPSNReceiverSubsystem>();
+
+		if (Sender && Receiver)
+		{
+			Receiver->StartPSNReceiver(TEXT("PSN Test Receiver"), InAddress, InPort, true, true);
+			Sender->StartPSNSender(InAddress, InPort, TEXT("PSN Test Sender"), EPSNFrequency::PSN_OnTick, true);
+		}
+	}
+
+	bool IsValid() const
+	{
+		return Sender && Receiver && Sender->IsSenderRunning();
+	}
+
+	// Pump game thread tasks until Condition holds or the timeout passes
+	template <typename ConditionType>
+	bool WaitFor(ConditionType&& Condition, double TimeoutSeconds = 2.0)
+	{
+		const double EndTime = FPlatformTime::Seconds() + TimeoutSeconds;
+		while (!Condition())
+		{
+			if (FPlatformTime::Seconds() > EndTime)
+			{
+				return false;
+			}
+			FPlatformProcess::Sleep(0.0005f);
+			FTaskGraphInterface::Get().ProcessThreadUntilIdle(ENamedThreads::GameThread);
+		}
+		return true;
+	}
+
+	// Wait until the receiver has dispatched at least this many trackers in total
+	bool WaitForDispatched(uint64 TrackerCount, double TimeoutSeconds = 2.0)
+	{
+		return WaitFor([this, TrackerCount]() { return Receiver->GetStats().TrackersDispatched.load() >= TrackerCount; }, TimeoutSeconds);
+	}
+
+	// Wait until the receiver has read at least this many packets in total
+	bool WaitForPackets(uint64 PacketCount, double TimeoutSeconds = 2.0)
+	{
+		return WaitFor([this, PacketCount]() { return Receiver->GetStats().PacketsReceived.load() >= PacketCount; }, TimeoutSeconds);
+	}
+
+	FPSNStandaloneGameInstance Game;
+	UPSNSenderSubsystem* Sender = nullptr;
+	UPSNReceiverSubsystem* Receiver = nullptr;
+};
+
+#endif
@@ -0,0 +1,72 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+#include "PSNTrackerHistory.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPSNTrackerHistoryTest, "PosiStageNet.TrackerHistory", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPSNTrackerHistoryTest::RunTest(const FString& Parameters)
+{
+	// Moves along X at 200 cm/s and turns about Z at 90 degrees/s, sampled at 50 Hz from an arbitrary start time
+	const double Start = 1000.0;
+	const auto PositionAt = [](double T) { return FVector3f(200.f * T, 10.f, 150.f); };
+	const auto RotationAt = [](double T) { return FQuat4f(FVector3f::UpVector, FMath::DegreesToRadians(90.f * T)); };
+
+	FPSNTrackerHistory History(10);
+	FVector Position;
+	FQuat Rotation;
+	TestFalse(TEXT("No state before any sample"), History.GetStateAtTime(1, Start, Position, Rotation));
+
+	for (int32 Step = 0; Step < 25; Step++)
+	{
+		const double T = Step * 0.02;
+		History.Push(1, Start + T, PositionAt(T), RotationAt(T));
+	}
+	TestEqual(TEXT("Capacity is fixed"), History.NumSamples(1), 10);
+
+	// Halfway between two samples
+	TestTrue(TEXT("State found"), History.GetStateAtTime(1, Start + 0.43, Position, Rotation));
+	TestTrue(TEXT("Interpolated position"), Position.Equals(FVector(PositionAt(0.43)), 0.05));
+	TestTrue(TEXT("Interpolated rotation"), Rotation.Equals(FQuat(RotationAt(0.43)), 1e-3));
+
+	// Times before the oldest kept sample or after the newest are clamped
+	History.GetStateAtTime(1, Start, Position, Rotation);
+	TestTrue(TEXT("Clamped to the oldest kept sample"), Position.Equals(FVector(PositionAt(0.30)), 0.05));
+	History.GetStateAtTime(1, Start + 10.0, Position, Rotation);
+	TestTrue(TEXT("Clamped to the newest sample"), Position.Equals(FVector(PositionAt(0.48)), 0.05));
+
+	TArray<FVector> Trajectory;
+	TArray<double> Times;
+	TestTrue(TEXT("Trajectory found"), History.GetTrajectory(1, Start + 0.35, Start + 0.45, Trajectory, &Times));
+	TestEqual(TEXT("Trajectory samples in the window"), Trajectory.Num(), 5);
+	TestTrue(TEXT("Trajectory is oldest first"), Times.Num() == 5 && Times[0] < Times[4] && FMath::IsNearlyEqual(Times[0], Start + 0.36, 1e-3));
+
+	FVector Velocity;
+	TestTrue(TEXT("Velocity found"), History.GetVelocity(1, Start + 0.3, Start + 0.48, Velocity));
+	TestTrue(TEXT("Velocity in cm/s"), Velocity.Equals(FVector(200.0, 0.0, 0.0), 0.5));
+
+	// A repeated time replaces the newest sample rather than adding one
+	History.Push(1, Start + 0.48, FVector3f(0.f), FQuat4f::Identity);
+	History.GetStateAtTime(1, Start + 0.48, Position, Rotation);
+	TestTrue(TEXT("Repeated time replaces the newest"), Position.IsNearlyZero(0.01));
+	TestEqual(TEXT("Replacing keeps the count"), History.NumSamples(1), 10);
+
+	// A removed tracker's ring is reused by the next one
+	History.Remove(1);
+	TestEqual(TEXT("Removed tracker has no samples"), History.NumSamples(1), 0);
+	History.Push(2, Start + 1.0, FVector3f(-1234.5678f, 0.f, 0.f), FQuat4f::Identity);
+	TestEqual(TEXT("Reused ring starts empty"), History.NumSamples(2), 1);
+	TestFalse(TEXT("No velocity from one sample"), History.GetVelocity(2, Start, Start + 1.0, Velocity));
+	History.GetStateAtTime(2, Start + 1.0, Position, Rotation);
+	TestTrue(TEXT("Quantised to 0.1 mm"), FMath::IsNearlyEqual(Position.X, -1234.5678, 0.006));
+
+	History.SetSamplesPerTracker(0);
+	History.Push(3, Start, FVector3f(0.f), FQuat4f::Identity);
+	TestEqual(TEXT("No history when turned off"), History.NumSamples(3), 0);
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,71 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+#include "PSNTrackerRecord.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPSNTrackerRecordTest, "PosiStageNet.TrackerRecord", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPSNTrackerRecordTest::RunTest(const FString& Parameters)
+{
+	// Only the fields set on the wire are marked, and the name stays behind
+	::psn::tracker Native(42, "Named");
+	Native.set_speed(::psn::float3(1.f, 2.f, 3.f));
+	Native.set_status(0.5f);
+	Native.set_timestamp(123456789ull);
+
+	const FPSNTrackerRecord Record = FPSNTrackerRecord::FromNative(Native, 7);
+	TestEqual(TEXT("ID"), (int32)Record.ID, 42);
+	TestEqual(TEXT("Frame ID"), (int32)Record.FrameID, 7);
+	TestEqual(TEXT("Fields"), (int32)Record.Fields, (int32)(EPSNTrackerField::Position | EPSNTrackerField::Speed | EPSNTrackerField::Status | EPSNTrackerField::Timestamp));
+	TestTrue(TEXT("Speed"), Record.Speed.Equals(FVector3f(1.f, 2.f, 3.f)));
+	TestEqual(TEXT("Timestamp"), (int64)Record.Timestamp, (int64)123456789);
+
+	// Unset fields are not written back
+	::psn::tracker Written(42);
+	Record.WriteNative(Written);
+	TestTrue(TEXT("Speed written"), Written.is_speed_set());
+	TestFalse(TEXT("Orientation not written"), Written.is_ori_set());
+	TestFalse(TEXT("Acceleration not written"), Written.is_accel_set());
+	TestEqual(TEXT("Status written"), Written.get_status(), 0.5f);
+
+	// Blueprint trackers convert with every field set
+	FPSNTracker Tracker(FPSNTrackerInfo(9, TEXT("Edge")));
+	Tracker.Data.Position = FVector(1.0, -2.0, 3.0);
+	Tracker.Header.Timestamp = 99;
+
+	FPSNTrackerRecord FromTracker;
+	FromTracker.SetFromTracker(Tracker);
+	TestEqual(TEXT("All fields from a Blueprint tracker"), (int32)FromTracker.Fields, (int32)EPSNTrackerField::All);
+
+	FPSNTracker Back;
+	FromTracker.ToTracker(Back);
+	TestEqual(TEXT("ID back"), Back.Info.ID, 9);
+	TestTrue(TEXT("Position back"), Back.Data.Position.Equals(Tracker.Data.Position));
+	TestEqual(TEXT("Timestamp back"), Back.Header.Timestamp, (int64)99);
+
+	// Change detection: small moves stay within tolerance, the timestamp and frame are ignored
+	const float PositionTolerance = 0.1f;
+	const float ValueTolerance = 0.001f;
+	FPSNTrackerRecord Still = FromTracker;
+	Still.Timestamp += 1000;
+	Still.FrameID++;
+	TestTrue(TEXT("Unchanged when only the time changes"), Still.NearlyEquals(FromTracker, PositionTolerance, ValueTolerance));
+
+	FPSNTrackerRecord Jitter = FromTracker;
+	Jitter.Position.X += 0.05f;
+	TestTrue(TEXT("Jitter within tolerance"), Jitter.NearlyEquals(FromTracker, PositionTolerance, ValueTolerance));
+
+	FPSNTrackerRecord Moved = FromTracker;
+	Moved.Position.Y += 1.f;
+	TestFalse(TEXT("Move beyond tolerance"), Moved.NearlyEquals(FromTracker, PositionTolerance, ValueTolerance));
+
+	FPSNTrackerRecord Fewer = FromTracker;
+	Fewer.Fields &= ~EPSNTrackerField::Speed;
+	TestFalse(TEXT("Different fields set"), Fewer.NearlyEquals(FromTracker, PositionTolerance, ValueTolerance));
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,83 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+#include "PSNZones.h"
+#include "PSNSpatialHash.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPSNZoneTest, "PosiStageNet.Zones", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FPSNZoneTest::RunTest(const FString& Parameters)
+{
+	const FName Box(TEXT("Box"));
+	const FName Sphere(TEXT("Sphere"));
+	const FName Stage(TEXT("Stage"));
+
+	FPSNZone Polygon = FPSNZone::MakePolygon(Stage, { FVector2D(0.0, 0.0), FVector2D(400.0, 0.0), FVector2D(400.0, 400.0), FVector2D(200.0, 100.0), FVector2D(0.0, 400.0) }, 0.f, 300.f);
+	TestTrue(TEXT("Inside the polygon"), Polygon.Contains(FVector3f(100.f, 50.f, 100.f)));
+	TestFalse(TEXT("In the polygon's notch"), Polygon.Contains(FVector3f(200.f, 300.f, 100.f)));
+	TestFalse(TEXT("Above the polygon"), Polygon.Contains(FVector3f(100.f, 50.f, 400.f)));
+
+	FPSNSpatialHash Index(100.f);
+	FPSNZoneSet Zones;
+	Zones.AddZone(FPSNZone::MakeBox(Box, FBox(FVector(-100.0), FVector(100.0)), 2.f));
+	Zones.AddZone(FPSNZone::MakeSphere(Sphere, FVector(1000.0, 0.0, 0.0), 150.f));
+	Zones.AddZone(Polygon);
+
+	TArray<FPSNZoneEvent> Events;
+	const auto CountEvents = [&Events](EPSNZoneEventType Type, FName Zone, int32 ID)
+	{
+		return Events.FilterByPredicate([&](const FPSNZoneEvent& Event) { return Event.Type == Type && Event.Zone == Zone && Event.TrackerID == ID; }).Num();
+	};
+
+	Index.Update(1, FVector3f(0.f, 0.f, 0.f));
+	Index.Update(2, FVector3f(1050.f, 0.f, 0.f));
+	Index.Update(3, FVector3f(5000.f, 0.f, 0.f));
+	Zones.Evaluate(Index, 0.0, true, Events);
+	TestEqual(TEXT("Two enters"), Events.Num(), 2);
+	TestEqual(TEXT("Tracker 1 enters the box"), CountEvents(EPSNZoneEventType::PSN_Enter, Box, 1), 1);
+	TestEqual(TEXT("Tracker 2 enters the sphere"), CountEvents(EPSNZoneEventType::PSN_Enter, Sphere, 2), 1);
+
+	// Nothing moves, so only dwell times are checked
+	Events.Reset();
+	Zones.Evaluate(Index, 1.0, false, Events);
+	TestEqual(TEXT("No events before the dwell time"), Events.Num(), 0);
+	Zones.Evaluate(Index, 2.5, false, Events);
+	TestEqual(TEXT("Dwell after two seconds"), CountEvents(EPSNZoneEventType::PSN_Dwell, Box, 1), 1);
+	Events.Reset();
+	Zones.Evaluate(Index, 5.0, false, Events);
+	TestEqual(TEXT("Dwell is sent once per visit"), Events.Num(), 0);
+
+	// Tracker 1 moves from the box onto the stage, tracker 2 leaves the sphere
+	Index.Update(1, FVector3f(150.f, 50.f, 50.f));
+	Index.Update(2, FVector3f(1200.f, 0.f, 0.f));
+	Zones.Evaluate(Index, 6.0, true, Events);
+	TestEqual(TEXT("Tracker 1 exits the box"), CountEvents(EPSNZoneEventType::PSN_Exit, Box, 1), 1);
+	TestEqual(TEXT("Tracker 1 enters the stage"), CountEvents(EPSNZoneEventType::PSN_Enter, Stage, 1), 1);
+	TestEqual(TEXT("Tracker 2 exits the sphere"), CountEvents(EPSNZoneEventType::PSN_Exit, Sphere, 2), 1);
+	TestEqual(TEXT("Only those three"), Events.Num(), 3);
+
+	TArray<int32> Occupants;
+	TestTrue(TEXT("Stage occupants"), Zones.GetOccupants(Stage, Occupants));
+	TestTrue(TEXT("Tracker 1 on stage"), Occupants.Num() == 1 && Occupants[0] == 1);
+
+	// A tracker dropped from the index leaves every zone
+	Events.Reset();
+	Index.Remove(1);
+	Zones.Evaluate(Index, 7.0, true, Events);
+	TestEqual(TEXT("Removed tracker exits"), CountEvents(EPSNZoneEventType::PSN_Exit, Stage, 1), 1);
+
+	// Removing a zone reports its occupants leaving
+	Events.Reset();
+	Index.Update(4, FVector3f(10.f, 10.f, 10.f));
+	Zones.Evaluate(Index, 8.0, true, Events);
+	Events.Reset();
+	TestTrue(TEXT("Zone removed"), Zones.RemoveZone(Box, Events));
+	TestEqual(TEXT("Exit on removal"), CountEvents(EPSNZoneEventType::PSN_Exit, Box, 4), 1);
+	TestFalse(TEXT("Unknown zone"), Zones.RemoveZone(Box, Events));
+
+	return true;
+}
+
+#endif
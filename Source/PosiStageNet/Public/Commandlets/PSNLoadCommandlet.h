@@ -0,0 +1,31 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "PSNLoadCommandlet.generated.h"
+
+/**
+ * Synthetic PSN load generator.
+ * Simulates a number of independent PSN servers, each with its own socket, encoder, frame rate and set of moving trackers,
+ * and can drop, reorder and duplicate packets to exercise a receiver's reassembly. Packet decisions come from a seeded
+ * random stream per source so a run is repeatable.
+ *
+ *   UnrealEditor-Cmd <Project>.uproject -run=PSNLoad -sources=8 -trackers=200 -rates=60,120 -motion=circle -loss=0.01 -reorder=0.01 -duplicate=0.005
+ *
+ * On Linux pass -bind=127.0.0.2 to bind source N to 127.0.0.(2+N), so a receiver on the same machine sees each source as its own address.
+ */
+UCLASS()
+class POSISTAGENET_API UPSNLoadCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	UPSNLoadCommandlet();
+
+	//~ Begin UCommandlet Interface
+	virtual int32 Main(const FString& Params) override;
+	//~ End UCommandlet Interface
+};
@@ -0,0 +1,93 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "PSNMessage.h"
+#include "PSNSenderProxy.h"
+#include "PSNStats.h"
+#include "PSNSoakCommandlet.generated.h"
+
+class UPSNReceiverSubsystem;
+
+/**
+ * Long running end to end latency soak over loopback.
+ * Every frame is stamped with a monotonic send time, the receiver measures send to dispatch latency on arrival,
+ * and a report of latency percentiles, lost, out of order and over threshold frames and memory growth is logged at a fixed interval.
+ *
+ * Run sender and receiver in one process, or in two processes on the same machine with -role=sender / -role=receiver:
+ *   UnrealEditor-Cmd <Project>.uproject -run=PSNSoak -trackers=500 -rate=60 -duration=28800 -report=60 -csv=Saved/PSNSoak.csv
+ */
+UCLASS()
+class POSISTAGENET_API UPSNSoakCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	UPSNSoakCommandlet();
+
+	//~ Begin UCommandlet Interface
+	virtual int32 Main(const FString& Params) override;
+	//~ End UCommandlet Interface
+
+private:
+
+	UFUNCTION()
+	void OnTrackerReceived(const FPSNTracker& Tracker);
+
+	void SendFrame(double Now);
+	void Report(double Now, bool bFinal);
+
+	/** Fixed width latency histogram, 10us buckets up to 100ms plus an overflow bucket */
+	struct FLatencyHistogram
+	{
+		static constexpr double BucketMicroseconds = 10.0;
+		static constexpr int32 NumBuckets = 10000;
+
+		TArray<uint64> Buckets;
+		uint64 Count = 0;
+		double MaxMicroseconds = 0.0;
+
+		FLatencyHistogram() { Reset(); }
+		void Reset();
+		void Add(double Microseconds);
+		double Percentile(double Fraction) const;
+	};
+
+	// Options
+	bool bSend = true;
+	bool bReceive = true;
+	int32 TrackerCount = 100;
+	double FrameRate = 60.0;
+	double LateMilliseconds = 10.0;
+	FString CsvPath;
+
+	// Sender
+	TUniquePtr<FPSNSenderProxy> SenderProxy;
+	FPSNSenderStats SenderStats;
+	TArray<FPSNTracker> Trackers;
+	uint64 FramesSent = 0;
+
+	// Receiver, owned by the standalone game instance Main creates
+	UPROPERTY()
+	UPSNReceiverSubsystem* Receiver = nullptr;
+
+	int32 LastFrameID = INDEX_NONE;
+	uint64 FramesReceived = 0;
+	uint64 FramesLost = 0;
+
+	/** Frames older than one already received, discarded without a latency sample */
+	uint64 FramesOutOfOrder = 0;
+
+	/** Frames received in order but with a latency over LateMilliseconds */
+	uint64 FramesOverLatency = 0;
+
+	FLatencyHistogram IntervalLatency;
+	FLatencyHistogram TotalLatency;
+
+	// Memory growth
+	double StartTime = 0.0;
+	uint64 StartUsedPhysical = 0;
+};
@@ -35,7 +35,7 @@
 #include <map>
 #include <string>
 
-enum class EPSNPacketType : uint8
+enum class EPSNPacketType : uint8_t
 {
     PSNType_Invalid,
     PSNType_Info,
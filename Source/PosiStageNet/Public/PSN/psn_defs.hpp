@@ -29,6 +29,8 @@
 #ifndef PSN_DEFS_HPP
 #define PSN_DEFS_HPP
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <map>
 #include <string>
@@ -67,6 +69,34 @@ const uint16_t DATA_TRACKER_STATUS    = 0x0003 ;
 const uint16_t DATA_TRACKER_ACCEL     = 0x0004 ;
 const uint16_t DATA_TRACKER_TRGTPOS   = 0x0005 ;
 const uint16_t DATA_TRACKER_TIMESTAMP = 0x0006 ;
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+// log
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+// The codec has no engine dependency. Hosts that want its diagnostics install
+// a callback with set_log_callback(), otherwise messages are dropped.
+enum class log_level
+{
+    info ,
+    warning ,
+    error
+} ;
+
+typedef void ( * log_callback_t )( log_level level , const char * message ) ;
+
+inline log_callback_t & log_callback( void )
+{
+    static log_callback_t callback = nullptr ;
+    return callback ;
+}
+
+inline void set_log_callback( log_callback_t callback ) { log_callback() = callback ; }
+
+inline void log( log_level level , const char * message )
+{
+    if ( log_callback_t callback = log_callback() )
+        callback( level , message ) ;
+}
     
 //::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
 // float3
@@ -27,5 +27,5 @@
 #pragma once
 
 #include "psn_defs.hpp"
-#include "psn_encoder_impl.hpp"
-#include "psn_decoder_impl.hpp"
\ No newline at end of file
+#include "psn_encoder.hpp"
+#include "psn_decoder.hpp"
@@ -0,0 +1,86 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "PSNCoordinateSpace.generated.h"
+
+struct FPSNTrackerRecord;
+
+/** A PSN axis, and its direction, as seen from Unreal */
+UENUM(BlueprintType)
+enum class EPSNAxis : uint8
+{
+	PSN_X		UMETA(DisplayName = "X"),
+	PSN_NegX	UMETA(DisplayName = "-X"),
+	PSN_Y		UMETA(DisplayName = "Y"),
+	PSN_NegY	UMETA(DisplayName = "-Y"),
+	PSN_Z		UMETA(DisplayName = "Z"),
+	PSN_NegZ	UMETA(DisplayName = "-Z"),
+};
+
+/**
+ * Mapping from PSN space (meters) to Unreal space (cm), applied natively to every tracker.
+ * Positions go from meters to cm, then through the axis swap, scale, rotation and offset. Senders apply the inverse.
+ */
+struct POSISTAGENET_API FPSNCoordinateTransform
+{
+	/** Positions and target positions */
+	FMatrix44f Matrix;
+
+	/** Speeds, accelerations and orientations. Axis swap, scale sign and rotation only, so they stay in m/s and radians. */
+	FMatrix44f DirectionMatrix;
+
+	/** -1 when the axis swap and scale signs mirror, as orientations are axial vectors and flip with it */
+	float OrientationSign = 1.f;
+
+	/** Plain unit conversion between PSN and Unreal, with no remapping */
+	FPSNCoordinateTransform(float UnitScale = 100.f);
+
+	FPSNCoordinateTransform Inverse() const;
+
+	/** Transform the positions, speeds, accelerations, target positions and orientations of every tracker in place */
+	void Apply(FPSNTrackerRecord* Trackers, int32 Num) const;
+
+	void Apply(TArray<FPSNTrackerRecord>& Trackers) const { Apply(Trackers.GetData(), Trackers.Num()); }
+};
+
+/**
+ * Coordinate space preset for a PSN source, e.g. a lighting console whose X and Y are swapped compared to Unreal.
+ * Replaces running the PSN Helper Blueprint on each tracker.
+ */
+UCLASS(BlueprintType)
+class POSISTAGENET_API UPSNCoordinateSpace : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+
+	/** PSN axis that becomes Unreal X */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "PSN|Axes")
+	EPSNAxis UnrealX = EPSNAxis::PSN_X;
+
+	/** PSN axis that becomes Unreal Y */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "PSN|Axes")
+	EPSNAxis UnrealY = EPSNAxis::PSN_Y;
+
+	/** PSN axis that becomes Unreal Z */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "PSN|Axes")
+	EPSNAxis UnrealZ = EPSNAxis::PSN_Z;
+
+	/** Scale on top of the meters to cm conversion, per Unreal axis. A negative scale mirrors the axis, directions included. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "PSN|Transform")
+	FVector Scale = FVector::OneVector;
+
+	/** Rotation of the PSN space in Unreal */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "PSN|Transform")
+	FRotator Rotation = FRotator::ZeroRotator;
+
+	/** Position of the PSN origin in Unreal, in cm */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "PSN|Transform")
+	FVector Offset = FVector::ZeroVector;
+
+	/** PSN to Unreal transform for the receiver. Use Inverse() for the sender. */
+	FPSNCoordinateTransform MakeTransform() const;
+};
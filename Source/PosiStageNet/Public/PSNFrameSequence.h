@@ -0,0 +1,68 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** What a single data packet did to a source's frame sequence */
+struct FPSNFrameSequenceResult
+{
+	/** False if the packet should be dropped: a repeat, or part of a frame older than the newest one */
+	bool bAccept = true;
+
+	/** The packet started a new frame */
+	bool bNewFrame = false;
+
+	/** Frame IDs skipped between the previous frame and this one */
+	uint32 FramesLost = 0;
+
+	/** The previous frame was closed with fewer packets than its header announced */
+	bool bPreviousPartial = false;
+
+	/** More packets than the frame announced arrived for it, for the current frame or a complete older one */
+	bool bDuplicate = false;
+
+	/** A frame counted as lost has arrived after a newer one. It is still dropped. */
+	bool bReordered = false;
+};
+
+/**
+ * Tracks the 8 bit frame IDs and packet counts of one PSN source.
+ * IDs are compared with serial number arithmetic, so a frame up to 127 IDs ahead is newer and anything
+ * behind is older, across the wrap from 255 to 0. The last 64 frames are remembered so a frame arriving
+ * after a newer one can be told apart from a repeat.
+ */
+class POSISTAGENET_API FPSNFrameSequence
+{
+public:
+
+	/** A source silent for longer than this is assumed to have restarted, and its next frame is not a gap */
+	static constexpr double ResyncSeconds = 1.0;
+
+	/** Record a data packet's header, received at FPlatformTime::Seconds() Now */
+	FPSNFrameSequenceResult Push(uint8 FrameID, uint8 FramePacketCount, double Now);
+
+	void Reset() { bStarted = false; }
+
+	uint8 GetCurrentFrameID() const { return CurrentFrameID; }
+
+private:
+
+	void StartFrame(uint8 FrameID, uint8 FramePacketCount);
+
+	// Forget every earlier frame and start counting from this one
+	void Resync(uint8 FrameID, uint8 FramePacketCount);
+
+	bool bStarted = false;
+	uint8 CurrentFrameID = 0;
+	uint8 ExpectedPackets = 0;
+	uint8 ReceivedPackets = 0;
+	double LastPacketTime = 0.0;
+
+	// Frames since the last (re)sync, up to 64. Older frames were never counted as lost or received.
+	int32 FramesSinceSync = 0;
+
+	// Bit N is set if frame CurrentFrameID - N has arrived, and in CompleteFrames if every packet it announced did
+	uint64 ReceivedFrames = 0;
+	uint64 CompleteFrames = 0;
+};
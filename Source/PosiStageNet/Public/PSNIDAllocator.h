@@ -0,0 +1,51 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Tracks which of the 65536 PSN tracker IDs are in use.
+ * A bit per ID, plus a bit per 64 IDs marking full words, so allocate, free and lookup never scan more than a few words.
+ */
+class POSISTAGENET_API FPSNIDAllocator
+{
+public:
+
+	static constexpr int32 NumIDs = 65536;
+
+	FPSNIDAllocator();
+
+	/** Whether the ID is in use. Out of range IDs are never in use. */
+	bool IsAllocated(int32 ID) const;
+
+	/** Claim a specific ID. Returns false if it is out of range or already in use. */
+	bool Allocate(int32 ID);
+
+	/** Claim the lowest free ID at or above StartFrom. Returns INDEX_NONE when none is left. */
+	int32 AllocateFirstFree(int32 StartFrom = 1);
+
+	/** The lowest free ID at or above StartFrom, without claiming it. Returns INDEX_NONE when none is left. */
+	int32 FindFirstFree(int32 StartFrom = 1) const;
+
+	/** Release an ID. Freeing an unused ID does nothing. */
+	void Free(int32 ID);
+
+	void Reset();
+
+	/** Number of IDs in use */
+	int32 Num() const { return NumAllocated; }
+
+private:
+
+	static constexpr int32 NumWords = NumIDs / 64;
+	static constexpr int32 NumSummaryWords = NumWords / 64;
+
+	// Set bit = ID in use
+	uint64 Words[NumWords];
+
+	// Set bit = every ID in that word is in use
+	uint64 FullWords[NumSummaryWords];
+
+	int32 NumAllocated = 0;
+};
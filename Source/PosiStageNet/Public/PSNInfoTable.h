@@ -0,0 +1,43 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PSNMessage.h"
+
+/** System and tracker names announced by one PSN source, converted from UTF-8 once */
+struct FPSNSourceInfo
+{
+	FString SystemName;
+	TMap<int32, FString> TrackerNames;
+};
+
+/**
+ * Tracker names from info packets, per source address.
+ * The receive thread only queues a source's names when its info packet differs from the last one, so a table is
+ * replaced once per change rather than once a second. Data records carry only IDs and are named by lookup here.
+ */
+class POSISTAGENET_API FPSNInfoTable
+{
+public:
+
+	/** Replace the names of a source. Trackers that are new or renamed are added to OutChanged. */
+	void SetSource(uint32 SourceAddress, FPSNSourceInfo&& Info, TArray<FPSNTrackerInfo>& OutChanged);
+
+	/** Name of a tracker from whichever source last announced its ID */
+	const FString* FindName(int32 ID) const { return Names.Find(ID); }
+
+	/** Name of a tracker as announced by one source */
+	const FString* FindName(uint32 SourceAddress, int32 ID) const;
+
+	const FPSNSourceInfo* FindSource(uint32 SourceAddress) const { return Sources.Find(SourceAddress); }
+
+	void Reset();
+
+private:
+
+	TMap<uint32, FPSNSourceInfo> Sources;
+
+	// Every source merged, for records that carry only an ID
+	TMap<int32, FString> Names;
+};
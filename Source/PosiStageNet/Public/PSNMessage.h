@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 
+#include "PSNOrientation.h"
 #include "PSN/psn_encoder.hpp"
 #include "PSN/psn_decoder.hpp"
 #include "PSNMessage.generated.h"
@@ -17,6 +18,20 @@ enum class EPSNFrequency : uint8
 	PSN_OnTick      UMETA(DisplayName = "Tick"),
 };
 
+/** Clock used to stamp outgoing frames. Sampled once per frame and applied to the packet header and every tracker. */
+UENUM(BlueprintType)
+enum class EPSNTimestampSource : uint8
+{
+	/** High resolution platform clock, microseconds since the sender started. Unaffected by pause and time dilation. */
+	PSN_Monotonic		UMETA(DisplayName = "Monotonic Clock"),
+	/** Engine timecode as time of day, so senders sharing a timecode source agree. */
+	PSN_Timecode		UMETA(DisplayName = "Engine Timecode"),
+	/** Engine frame time, driven by the custom time step (genlock) when one is set. */
+	PSN_CustomTimeStep	UMETA(DisplayName = "Custom Time Step"),
+	/** Game time in seconds. Stops while paused and scales with time dilation. */
+	PSN_GameTime		UMETA(DisplayName = "Game Time"),
+};
+
 USTRUCT(BlueprintType)
 struct FPSNTrackerData
 {
@@ -223,7 +238,7 @@ public:
 	}
 
 	// Convert FVector into PSN's float3 format
-	FORCEINLINE psn::float3 Conv_UnrealVectorToFloat3(FVector V)
+	FORCEINLINE psn::float3 Conv_UnrealVectorToFloat3(FVector V) const
 	{
 		return psn::float3(V.X, V.Y, V.Z);
 	}
@@ -236,7 +251,7 @@ public:
 
 		Data.Position = Conv_Float3ToUnrealVector(InTracker.get_pos());
 		Data.Speed = Conv_Float3ToUnrealVector(InTracker.get_speed());
-		Data.Orientation = Conv_Float3ToUnrealVector(InTracker.get_ori()).Rotation(); // might be broken!
+		Data.Orientation = PSNOrientation::AxisAngleToRotator(FVector3f(Conv_Float3ToUnrealVector(InTracker.get_ori())));
 		Data.Status = InTracker.get_status();
 		Data.Acceleration = Conv_Float3ToUnrealVector(InTracker.get_accel());
 		Data.TargetPosition = Conv_Float3ToUnrealVector(InTracker.get_target_pos());
@@ -244,20 +259,26 @@ public:
 	}
 
 	// Export Tracker as Native PSN::Tracker
-	psn::tracker GetAsNativeTracker()
+	psn::tracker GetAsNativeTracker() const
 	{
 		psn::tracker NewTracker = psn::tracker(Info.ID, TCHAR_TO_UTF8(*Info.Name));
-
-		NewTracker.set_pos(Conv_UnrealVectorToFloat3(Data.Position));
-		NewTracker.set_speed(Conv_UnrealVectorToFloat3(Data.Speed));
-		NewTracker.set_ori(Conv_UnrealVectorToFloat3(Data.Orientation.Vector()));
-		NewTracker.set_status(Data.Status);
-		NewTracker.set_accel(Conv_UnrealVectorToFloat3(Data.Acceleration));
-		NewTracker.set_target_pos(Conv_UnrealVectorToFloat3(Data.TargetPosition));
-		NewTracker.set_timestamp(Header.Timestamp);
+		WriteNativeData(NewTracker);
 		return NewTracker;
 	}
 
+	// Write the data fields into an existing native tracker, leaving its ID and name alone. No string work.
+	void WriteNativeData(psn::tracker& NativeTracker) const
+	{
+		NativeTracker.set_pos(Conv_UnrealVectorToFloat3(Data.Position));
+		NativeTracker.set_speed(Conv_UnrealVectorToFloat3(Data.Speed));
+		const FVector3f AxisAngle = PSNOrientation::RotatorToAxisAngle(Data.Orientation);
+		NativeTracker.set_ori(::psn::float3(AxisAngle.X, AxisAngle.Y, AxisAngle.Z));
+		NativeTracker.set_status(Data.Status);
+		NativeTracker.set_accel(Conv_UnrealVectorToFloat3(Data.Acceleration));
+		NativeTracker.set_target_pos(Conv_UnrealVectorToFloat3(Data.TargetPosition));
+		NativeTracker.set_timestamp(Header.Timestamp);
+	}
+
 
 };
 
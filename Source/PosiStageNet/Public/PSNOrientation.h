@@ -0,0 +1,37 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/*
+* PSN orientation is an axis-angle rotation vector: the axis of rotation scaled by the angle in radians.
+* It uses the same axes as the positions, so no swizzle is applied, and converts to and from quaternions
+* without going through Euler angles, keeping roll.
+*
+* The batch functions convert four trackers at a time with VectorRegister math. Strides are in bytes,
+* so the rotation vectors can be read from or written into an array of records in place.
+*/
+namespace PSNOrientation
+{
+	POSISTAGENET_API FQuat4f AxisAngleToQuat(const FVector3f& AxisAngle);
+
+	/** The shorter of the two equivalent rotations is returned, so the angle is at most PI */
+	POSISTAGENET_API FVector3f QuatToAxisAngle(const FQuat4f& Quat);
+
+	POSISTAGENET_API void AxisAnglesToQuats(const FVector3f* AxisAngles, int32 AxisAngleStride, FQuat4f* OutQuats, int32 Num);
+
+	POSISTAGENET_API void QuatsToAxisAngles(const FQuat4f* Quats, FVector3f* OutAxisAngles, int32 AxisAngleStride, int32 Num);
+
+	/** Blueprint rotator to PSN orientation */
+	FORCEINLINE FVector3f RotatorToAxisAngle(const FRotator& Rotator)
+	{
+		return QuatToAxisAngle(FQuat4f(Rotator.Quaternion()));
+	}
+
+	/** PSN orientation to Blueprint rotator */
+	FORCEINLINE FRotator AxisAngleToRotator(const FVector3f& AxisAngle)
+	{
+		return FQuat(AxisAngleToQuat(AxisAngle)).Rotator();
+	}
+}
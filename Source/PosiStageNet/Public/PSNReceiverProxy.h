@@ -3,11 +3,16 @@
 #pragma once
 
 #include "PSNReceiverSubsystem.h"
+#include "PSNCoordinateSpace.h"
+#include "PSNFrameSequence.h"
+#include "PSNRedundantMerge.h"
 #include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
 #include "UObject/NoExportTypes.h"
 #include "Common/UdpSocketReceiver.h"
 #include "Interfaces/IPv4/IPv4Address.h"
 #include "Interfaces/IPv4/IPv4Endpoint.h"
+#include <atomic>
 
 class UPSNReceiverSubsystem;
 
@@ -20,9 +25,11 @@ public:
 	virtual bool IsActive() const = 0;
 	virtual void Listen(const FString& ServerName) = 0;
 	virtual bool SetAddress(const FString& InReceiveIPAddress, int32 InPort) = 0;
+	virtual bool SetRedundantPaths(const TArray<FPSNReceivePath>& InPaths) = 0;
 	virtual void SetMulticastLoopback(bool bInMulticastLoopback) = 0;
 	virtual void Stop() = 0;
 	virtual EPSNPacketType GetLastPacketType() = 0;
+	virtual void SetCoordinateTransforms(const FPSNCoordinateTransform& DefaultTransform, const TMap<FIPv4Address, FPSNCoordinateTransform>& SourceTransforms) = 0;
 };
 
 
@@ -44,6 +51,9 @@ public:
 
 	bool SetAddress(const FString& InReceiveIPAddress, int32 InPort) override;
 
+	/** Also listen on these paths, on the same port, and merge them with the main address. Not while listening. */
+	bool SetRedundantPaths(const TArray<FPSNReceivePath>& InPaths) override;
+
 	void SetMulticastLoopback(bool InMulticastLoopback) override;
 
 	void Stop() override;
@@ -52,31 +62,78 @@ public:
 	void OnPacketReceived(const FArrayReaderPtr& RawData, const FIPv4Endpoint& Endpoint);
 
 	EPSNPacketType GetLastPacketType() override { return LastPacketType; }
+
+	/** Replace the PSN to Unreal transforms, applied to each decoded packet before it is queued. Safe to call while listening. */
+	void SetCoordinateTransforms(const FPSNCoordinateTransform& InDefaultTransform, const TMap<FIPv4Address, FPSNCoordinateTransform>& InSourceTransforms) override;
 	
 private:
 
+	/** Add a data packet's place in its frame sequence to the stats. False if the packet is to be dropped. */
+	bool RecordSequence(const FPSNFrameSequenceResult& Sequence, FPSNSourceStats* SourceStats);
+
+	/** Bind a socket for one path and start its receive thread. False if the socket could not be bound. */
+	bool ListenOn(const FString& ServerName, const FPSNReceivePath& Path, bool bReusable);
+
 	/** Receiver Object */
 	UPSNReceiverSubsystem* ReceiverSubsystem;
-	
-	/** Socket used to listen for PSN packets. */
-	FSocket* Socket;
-	
-	/** UDP receiver. */
-	FUdpSocketReceiver* SocketReceiver;
+
+	/** A bound socket and the thread receiving on it */
+	struct FListenSocket
+	{
+		FSocket* Socket = nullptr;
+		FUdpSocketReceiver* Receiver = nullptr;
+	};
+
+	/** One per path while listening */
+	TArray<FListenSocket> ListenSockets;
 
 	/** IPAddress to listen for PSN packets on.  If unset, defaults to LocalHost */
 	FIPv4Address ReceiveIPAddress;
 
+	/** Further paths carrying the same stream over other networks */
+	TArray<FPSNReceivePath> RedundantPaths;
+
+	/** First arrival deduplication across paths, used when there are redundant paths */
+	FPSNRedundantMerge RedundantMerge;
+
+	/** Guards RedundantMerge and SourceStates between the receive threads of several paths. Not held while decoding. */
+	FCriticalSection ReceiveLock;
+
 	/** Port to listen for PSN packets on. */
 	int32 Port;
 
 	/** Whether or not to loopback if address provided is multicast */
 	bool bMulticastLoopback;
 
-	uint8_t LastFrameID;
+	std::atomic<EPSNPacketType> LastPacketType;
+
+	/** Decoder and frame sequence of one sending host. Only used on the socket threads, under its own Lock. */
+	struct FSourceState
+	{
+		/** Held from sequencing to enqueue, so a source's packets are decoded one at a time and queued in order */
+		FCriticalSection Lock;
+
+		::psn::psn_decoder Decoder;
+		FPSNFrameSequence Sequence;
+
+		/** Last frame decoded into trackers */
+		uint8_t LastFrameID = 0;
+		bool bHasDataFrame = false;
+
+		/** Names of the last info frame queued, kept as received so an unchanged one is skipped without converting it */
+		::std::string SystemName;
+		::std::map<int, ::std::string> TrackerNames;
+	};
 
-	EPSNPacketType LastPacketType;
+	/**
+	 * Keyed by source address, so frames interleaved from several hosts are reassembled and sequenced separately. Redundant copies share the key of the first.
+	 * The map is guarded by ReceiveLock; states are never removed while receiving, so one can be used after the lock is released.
+	 */
+	TMap<uint32, TUniquePtr<FSourceState>> SourceStates;
 
-	::psn::psn_decoder* psn_decoder;
+	/** Transforms for sources without their own, and per source address. Guarded by TransformLock. */
+	FPSNCoordinateTransform DefaultTransform;
+	TMap<FIPv4Address, FPSNCoordinateTransform> SourceTransforms;
+	FCriticalSection TransformLock;
 
 };
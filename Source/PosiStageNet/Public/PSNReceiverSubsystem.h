@@ -7,12 +7,22 @@
 #include "Engine/EngineTypes.h"
 #include "Subsystems/GameInstanceSubsystem.h"
 #include "PSNMessage.h"
+#include "PSNTrackerRecord.h"
+#include "PSNCoordinateSpace.h"
+#include "PSNSpatialHash.h"
+#include "PSNZones.h"
+#include "PSNTrackerHistory.h"
+#include "PSNInfoTable.h"
+#include "Interfaces/IPv4/IPv4Address.h"
 #include "PSNReceiverProxy.h"
+#include "PSNStats.h"
 //#include "UObject/Object.h"
 #include "Async/TaskGraphInterfaces.h"
 #include "Containers/Queue.h"
+#include "Containers/Ticker.h"
+#include "Misc/Optional.h"
 #include "Templates/UniquePtr.h"
-//#include "Tickable.h" // may not be needed
+#include "Tickable.h"
 #include "PSNReceiverSubsystem.generated.h"
 
 class FSocket;
@@ -28,14 +38,54 @@ DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FPSNInfoPacketReceivedEvent, const F
 // On Data Packet Received.
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FPSNDataPacketReceivedEvent, const FPSNTracker&, Message);
 
-// Stat Group, Mainly for Packet Queuing.
-DECLARE_STATS_GROUP(TEXT("PSN Commands"), STATGROUP_PSNNetworkCommands, STATCAT_Advanced);
+// On a tracker entering, leaving or dwelling in a zone.
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FPSNZoneTrackerEvent, FName, Zone, int32, TrackerID);
+
+/** Decoded packet waiting in the receive queue, stamped with the time it arrived */
+struct FPSNQueuedPacket
+{
+	/** Data packets: the trackers of the completed frame */
+	TArray<FPSNTrackerRecord> Trackers;
+
+	/** Info packets: every name announced by the source, set only when they differ from its previous info frame */
+	TOptional<FPSNSourceInfo> SourceInfo;
+
+	/** Address of the source the trackers or names came from, the merged source key with redundant paths */
+	uint32 SourceAddress = 0;
+
+	EPSNPacketType PacketType = EPSNPacketType::PSNType_Invalid;
+
+	/** FPlatformTime::Cycles64() when the packet was received */
+	uint64 ReceiveCycles = 0;
+};
+
+/** Latest known state of a single tracker, as held in the receiver snapshot */
+struct FPSNTrackerSnapshotEntry
+{
+	/** Last dispatched tracker, already converted to Unreal units */
+	FPSNTrackerRecord Tracker;
+
+	/** Address of the source that holds the tracker's ID, to name it from that source's info */
+	uint32 SourceAddress = 0;
+
+	/** Another source last seen sending the same ID, 0 if none, so the conflict is logged once */
+	uint32 ConflictAddress = 0;
+
+	/** FPlatformTime::Seconds() at which the tracker was last received */
+	double LastReceivedTime = 0.0;
+
+	/** With change suppression, the state last broadcast to the delegates */
+	FPSNTrackerRecord Delivered;
+
+	/** FPlatformTime::Seconds() at which the tracker was last broadcast with change suppression on, 0 if never */
+	double LastDeliveredTime = 0.0;
+};
 
 /**
  * PSN Receiver Subsystem
  */
 UCLASS()
-class POSISTAGENET_API UPSNReceiverSubsystem : public UGameInstanceSubsystem
+class POSISTAGENET_API UPSNReceiverSubsystem : public UGameInstanceSubsystem, public FTickableGameObject
 {
 	GENERATED_BODY()
 
@@ -43,6 +93,12 @@ public:
 
 	UPSNReceiverSubsystem();
 
+	//~ Begin FTickableGameObject Interface
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	//~ End FTickableGameObject Interface
+
 	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
 	virtual void Deinitialize() override;
 
@@ -53,6 +109,26 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Posi Stage Net")
 	void StopReceiver();
 
+	/**
+	 * Also listen for the same stream on IPAddress, through the local interface at InterfaceAddress if given, for redundant networks.
+	 * Every path uses the receiver's port. Each packet is passed on from whichever path delivers it first and later copies are dropped.
+	 * Takes effect the next time the receiver starts. False if an address is invalid.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "PSN|Redundancy")
+	bool AddRedundantPath(const FString& IPAddress, const FString& InterfaceAddress = TEXT(""));
+
+	/** Listen on the main address only from the next start */
+	UFUNCTION(BlueprintCallable, Category = "PSN|Redundancy")
+	void ClearRedundantPaths();
+
+	/** Map every source from PSN space into Unreal with this preset. None converts meters to cm only. */
+	UFUNCTION(BlueprintCallable, Category = "PSN")
+	void SetCoordinateSpace(UPSNCoordinateSpace* Space);
+
+	/** Map one source, by IP address, with its own preset. None returns it to the shared space. False if the address is invalid. */
+	UFUNCTION(BlueprintCallable, Category = "PSN")
+	bool SetSourceCoordinateSpace(const FString& SourceAddress, UPSNCoordinateSpace* Space);
+
 	/** Event OnPacketReceived. Catch-All for both data and info packets */
 	UPROPERTY(BlueprintAssignable, Category = "Posi Stage Net")
 	FPSNPacketReceivedEvent OnPSNPacketReceived;
@@ -65,19 +141,213 @@ public:
 	UPROPERTY(BlueprintAssignable, Category = "Posi Stage Net")
 	FPSNDataPacketReceivedEvent OnPSNDataPacketReceived;
 
+	/**
+	 * Only broadcast trackers that have changed by more than a tolerance since they were last broadcast. The snapshot, history and zones still see every frame.
+	 * PositionTolerance is in cm and covers position and target position. ValueTolerance covers speed, acceleration, orientation and status.
+	 * HeartbeatSeconds re-broadcasts unchanged trackers at least that often, 0 for never.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "PSN")
+	void SetChangeSuppression(bool bEnable, float PositionTolerance = 0.1f, float ValueTolerance = 0.001f, float HeartbeatSeconds = 1.f);
+
+	/** Add or replace a box trigger zone. DwellTime of 0 sends no dwell event. */
+	UFUNCTION(BlueprintCallable, Category = "PSN|Zones")
+	void AddBoxZone(FName Zone, FBox Box, float DwellTime = 0.f);
+
+	/** Add or replace a sphere trigger zone. DwellTime of 0 sends no dwell event. */
+	UFUNCTION(BlueprintCallable, Category = "PSN|Zones")
+	void AddSphereZone(FName Zone, FVector Center, float Radius, float DwellTime = 0.f);
+
+	/** Add or replace a trigger zone outlined in the XY plane and extruded from MinZ to MaxZ. DwellTime of 0 sends no dwell event. */
+	UFUNCTION(BlueprintCallable, Category = "PSN|Zones")
+	void AddPolygonZone(FName Zone, const TArray<FVector2D>& Points, float MinZ, float MaxZ, float DwellTime = 0.f);
+
+	/** Remove a zone. Trackers still inside get an exit event. */
+	UFUNCTION(BlueprintCallable, Category = "PSN|Zones")
+	bool RemoveZone(FName Zone);
+
+	/** Remove every zone. Trackers still inside get exit events. */
+	UFUNCTION(BlueprintCallable, Category = "PSN|Zones")
+	void ClearZones();
+
+	/**
+	 * Trackers not received for this many seconds leave the spatial index and every zone, with exit events, until they are received again.
+	 * Their last state stays in the snapshot. 2 seconds by default, 0 never times out.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "PSN|Zones")
+	void SetTrackerTimeout(float Seconds);
+
+	/** IDs of the trackers inside a zone as of this frame. False if there is no such zone. */
+	UFUNCTION(BlueprintCallable, Category = "PSN|Zones")
+	bool GetZoneOccupants(FName Zone, TArray<int32>& OutIDs) const;
+
+	/** A tracker has moved into a zone. Zones are evaluated once per frame. */
+	UPROPERTY(BlueprintAssignable, Category = "PSN|Zones")
+	FPSNZoneTrackerEvent OnPSNZoneEntered;
+
+	/** A tracker has left a zone, or the zone was removed */
+	UPROPERTY(BlueprintAssignable, Category = "PSN|Zones")
+	FPSNZoneTrackerEvent OnPSNZoneExited;
+
+	/** A tracker has stayed in a zone for its dwell time. Sent once per visit. */
+	UPROPERTY(BlueprintAssignable, Category = "PSN|Zones")
+	FPSNZoneTrackerEvent OnPSNZoneDwell;
+
 	/** Add Packet To Queue */
-	void EnqueuePacket(TSharedPtr<FPSNTracker> Packet);
+	void EnqueuePacket(FPSNQueuedPacket&& Packet);
 
 	/** On Packet Received, Add to Queue */
 	void OnPacketReceived(const FString& IPAddress);
 
-	/** Dispatch each message and fire delegate */
-	void DispatchMessage(TSharedPtr<FPSNTracker> Message);
+	/**
+	 * Record a data tracker from SourceAddress in the snapshot and fire the delegates, converting it for Blueprint only if they are bound.
+	 * The name comes from that source's info. Dropped if another source holds the ID, see GetTrackerSnapshot. ReceiveTime is in FPlatformTime::Seconds().
+	 */
+	void DispatchTracker(const FPSNTrackerRecord& Record, uint32 SourceAddress, double ReceiveTime);
+
+	/** Replace a source's names in the info table and fire the info delegates for each tracker that is new or renamed */
+	void DispatchSourceInfo(uint32 SourceAddress, FPSNSourceInfo&& Info);
+
+	/** Fire the info delegates for one tracker */
+	void DispatchInfo(const FPSNTrackerInfo& Info);
+
+	/** Copy of the latest received state of every tracker, converted for Blueprint */
+	UFUNCTION(BlueprintCallable, Category = "PSN")
+	void GetLatestTrackers(TArray<FPSNTracker>& OutTrackers) const;
+
+	/** Forget every tracker held in the snapshot, e.g. when switching source */
+	UFUNCTION(BlueprintCallable, Category = "PSN")
+	void ClearTrackerSnapshot();
+
+	/** Latest received state of one tracker. False if it has not been received. */
+	UFUNCTION(BlueprintCallable, Category = "PSN")
+	bool GetLatestTracker(int32 ID, FPSNTracker& OutTracker) const;
+
+	/** IDs of the trackers within Radius (cm) of Center, unordered */
+	UFUNCTION(BlueprintCallable, Category = "PSN|Spatial")
+	void GetTrackersInRadius(FVector Center, float Radius, TArray<int32>& OutIDs) const;
+
+	/** IDs of the trackers inside Box, unordered */
+	UFUNCTION(BlueprintCallable, Category = "PSN|Spatial")
+	void GetTrackersInBox(FBox Box, TArray<int32>& OutIDs) const;
+
+	/** IDs of up to Count trackers closest to Location, nearest first. MaxDistance of 0 is unlimited. */
+	UFUNCTION(BlueprintCallable, Category = "PSN|Spatial")
+	void GetNearestTrackers(FVector Location, int32 Count, TArray<int32>& OutIDs, float MaxDistance = 0.f) const;
+
+	/** Grid cell size of the spatial index in cm. Around the usual query radius works best. */
+	UFUNCTION(BlueprintCallable, Category = "PSN|Spatial")
+	void SetSpatialCellSize(float CellSize);
+
+	/** Samples of recent history kept per tracker, 60 by default. 0 turns history off. Clears the history. */
+	UFUNCTION(BlueprintCallable, Category = "PSN|History")
+	void SetTrackerHistoryLength(int32 Samples);
+
+	/** Position and rotation of a tracker SecondsAgo, interpolated between received samples. False if it has no history. */
+	UFUNCTION(BlueprintCallable, Category = "PSN|History")
+	bool GetTrackerStateAtTime(int32 ID, float SecondsAgo, FVector& OutPosition, FRotator& OutRotation) const;
+
+	/** Received positions of a tracker over the last Duration seconds, oldest first */
+	UFUNCTION(BlueprintCallable, Category = "PSN|History")
+	bool GetTrackerTrajectory(int32 ID, float Duration, TArray<FVector>& OutPositions) const;
+
+	/** Average velocity of a tracker in cm/s over the last Window seconds of its history */
+	UFUNCTION(BlueprintCallable, Category = "PSN|History")
+	bool GetTrackerVelocity(int32 ID, float Window, FVector& OutVelocity) const;
+
+	/** Recent samples of every tracker, timed with FPlatformTime::Seconds(). Game thread only. */
+	const FPSNTrackerHistory& GetTrackerHistory() const { return TrackerHistory; }
+
+	/** Spatial index over the snapshot positions. Game thread only. */
+	const FPSNSpatialHash& GetSpatialIndex() const { return SpatialIndex; }
+
+	/**
+	 * Name of a tracker from the info of the source it was last received from, or empty if that source has not named it.
+	 * Before any data has arrived for it, the name from whichever source last announced the ID.
+	 */
+	FString GetTrackerName(int32 ID) const;
+
+	/** System name announced by the source at SourceAddress, or empty if no info packet has arrived from it */
+	UFUNCTION(BlueprintCallable, Category = "PSN")
+	FString GetSourceSystemName(const FString& SourceAddress) const;
+
+	/** Tracker names per source, converted once when an info packet changes them. Game thread only. */
+	const FPSNInfoTable& GetInfoTable() const { return InfoTable; }
+
+	/**
+	 * Latest received state of every tracker, keyed by tracker ID. Game thread only.
+	 * The snapshot, spatial index, history and zones hold one tracker per ID, so sources sharing a receiver need distinct IDs.
+	 * The first source to send an ID holds it until the tracker times out, see SetTrackerTimeout; other sources' trackers
+	 * with that ID are dropped, counted in the stats and logged. With no timeout, the ID is held until the snapshot is cleared.
+	 */
+	const TMap<int32, FPSNTrackerSnapshotEntry>& GetTrackerSnapshot() const { return TrackerSnapshot; }
+
+	/** Incremented every time the snapshot changes, so consumers can skip unchanged frames */
+	uint32 GetSnapshotRevision() const { return SnapshotRevision; }
+
+	/** Receive counters, safe to read from any thread */
+	FPSNReceiverStats& GetStats() { return Stats; }
+	const FPSNReceiverStats& GetStats() const { return Stats; }
 
 private:
 
 	TUniquePtr<IPSNServerProxy> ReceiverProxy;
 
-	// Queue
-	TQueue<TSharedPtr<FPSNTracker>> PacketQueue;
+	// Queue. Sources enqueue from the socket threads concurrently, so it takes several producers.
+	TQueue<FPSNQueuedPacket, EQueueMode::Mpsc> PacketQueue;
+
+	FPSNReceiverStats Stats;
+
+	// Rolls the rate windows every frame while the receiver runs, so a silent source drops to zero rather than
+	// keeping the rate it had when its last packet was dispatched
+	FTSTicker::FDelegateHandle PublishStatsHandle;
+	bool PublishStats(float DeltaTime);
+
+	// Latest state of each tracker, updated as data packets are dispatched
+	TMap<int32, FPSNTrackerSnapshotEntry> TrackerSnapshot;
+
+	uint32 SnapshotRevision = 0;
+
+	// Snapshot positions bucketed by grid cell for proximity queries
+	FPSNSpatialHash SpatialIndex;
+
+	// Recent samples per tracker, recorded as data is dispatched
+	FPSNTrackerHistory TrackerHistory;
+
+	// Trigger zones, evaluated against the spatial index on tick
+	FPSNZoneSet Zones;
+	TArray<FPSNZoneEvent> ZoneEvents;
+
+	// Snapshot revision at the last zone pass, to skip occupancy tests when nothing has moved
+	uint32 ZoneRevision = 0;
+
+	// See SetTrackerTimeout. Checked a few times per timeout rather than every frame.
+	float TrackerTimeout = 2.f;
+	double NextTimeoutCheck = 0.0;
+
+	// Remove trackers past the timeout from the spatial index, so the next zone pass sends their exits
+	void EvictStaleTrackers(double Now);
+
+	void BroadcastZoneEvents();
+
+	// Tracker names from info packets. Kept apart from the snapshot so data frames carry no strings.
+	FPSNInfoTable InfoTable;
+
+	// Further paths for the same stream, handed to the proxy on start
+	TArray<FPSNReceivePath> RedundantPaths;
+
+	// PSN to Unreal transforms, pushed to the proxy whenever they change
+	FPSNCoordinateTransform CoordinateTransform;
+	TMap<FIPv4Address, FPSNCoordinateTransform> SourceTransforms;
+
+	// Change suppression settings, see SetChangeSuppression
+	bool bSuppressUnchanged = false;
+	float SuppressPositionTolerance = 0.1f;
+	float SuppressValueTolerance = 0.001f;
+	float SuppressHeartbeatSeconds = 1.f;
+
+	// With change suppression on, whether the entry's tracker should be broadcast. Records it as delivered if so.
+	bool ShouldDeliver(FPSNTrackerSnapshotEntry& Entry) const;
+
+	// Reused by each dispatch when converting for the delegates
+	FPSNTracker DispatchScratch;
 };
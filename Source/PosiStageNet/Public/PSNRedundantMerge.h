@@ -0,0 +1,73 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Interfaces/IPv4/IPv4Address.h"
+
+/** A group or address the receiver listens on, optionally through a specific local interface */
+struct FPSNReceivePath
+{
+	FIPv4Address Address;
+
+	/** Local interface to join a multicast group on, Any for the default */
+	FIPv4Address Interface = FIPv4Address::Any;
+};
+
+/**
+ * Merges copies of one PSN stream arriving over several networks.
+ * A redundant sender transmits the same bytes on every network, timestamp and frame ID included, so a packet is
+ * identified by a hash of its contents. The first copy is passed on and later copies are dropped before decoding.
+ * The two copies come from different sender addresses, so the first copy's address becomes the source key of both,
+ * and one decoder and frame sequence serve the stream whichever network delivers it.
+ */
+class POSISTAGENET_API FPSNRedundantMerge
+{
+public:
+
+	/** A copy arriving this long after the first is treated as a new packet */
+	static constexpr double WindowSeconds = 0.5;
+
+	/**
+	 * Number of recent packets remembered to start with. The ring doubles whenever it would drop a packet younger than
+	 * WindowSeconds, up to MaxWindowSize, which covers the window at up to about 130000 packets per second.
+	 */
+	static constexpr int32 InitialWindowSize = 256;
+	static constexpr int32 MaxWindowSize = 65536;
+
+	FPSNRedundantMerge();
+
+	/**
+	 * Offer a packet received from SourceAddress at FPlatformTime::Seconds() Now.
+	 * False if it is a copy of a packet already offered. OutSourceKey is the address the stream is merged under.
+	 */
+	bool Push(const uint8* Data, int32 Size, uint32 SourceAddress, double Now, uint32& OutSourceKey);
+
+	/** Address a source is merged under, itself if it has not been matched with another */
+	uint32 GetSourceKey(uint32 SourceAddress) const;
+
+	void Reset();
+
+	/** Number of packets the ring currently remembers */
+	int32 GetWindowSize() const { return Window.Num(); }
+
+private:
+
+	// Double the ring, keeping every entry
+	void Grow();
+
+	struct FEntry
+	{
+		uint64 Hash = 0;
+		uint32 SourceAddress = 0;
+		double Time = 0.0;
+	};
+
+	// Ring of recent packets, with an index from hash to slot
+	TArray<FEntry> Window;
+	TMap<uint64, int32> Slots;
+	int32 Head = 0;
+
+	// Sender addresses matched to the address their stream was first seen from
+	TMap<uint32, uint32> SourceKeys;
+};
@@ -4,9 +4,16 @@
 
 #include "CoreMinimal.h"
 #include "PSNStream.h"
+#include "PSNTrackerRecord.h"
+#include "PSNStats.h"
 #include "Common/UdpSocketReceiver.h"
 #include "Interfaces/IPv4/IPv4Address.h"
 #include "Interfaces/IPv4/IPv4Endpoint.h"
+#include "HAL/CriticalSection.h"
+#include <atomic>
+
+class FEvent;
+class FThread;
 
 /** Interface for internal networking implementation. */
 class POSISTAGENET_API IPSNSenderProxy
@@ -15,8 +22,13 @@ public:
 	virtual ~IPSNSenderProxy() {}
 	virtual void GetSendIPAddress(FString& InIPAddress, int32& Port) const = 0;
 	virtual bool SetSendIPAddress(const FString& InIPAddress, const int32 Port) = 0;
+	virtual bool SetSendInterfaces(const TArray<FString>& LocalAddresses) = 0;
 	virtual void SendPSNData(TArray<FPSNTracker> TrackerData, uint64 Lifetime) = 0;
 	virtual void SendPSNInfo(TArray<FPSNTracker> TrackerData, uint64 Lifetime) = 0;
+	virtual void PublishPSNData(TArray<FPSNTrackerRecord>& TrackerData, uint64 Lifetime) = 0;
+	virtual void PublishPSNInfo(uint64 Lifetime) = 0;
+	virtual void SetTrackerName(int32 ID, const FString& Name) = 0;
+	virtual void RemoveTrackerName(int32 ID) = 0;
 	virtual void Stop() = 0;
 };
 
@@ -24,8 +36,10 @@ class POSISTAGENET_API FPSNSenderProxy : public IPSNSenderProxy
 {
 public:
 
-	// Ctor
-	FPSNSenderProxy(const FString& InClientName);
+	// Ctor. Stats must outlive the proxy.
+	FPSNSenderProxy(const FString& InClientName, FPSNSenderStats& InStats);
+
+	virtual ~FPSNSenderProxy();
 
 	// Get  IP Address
 	void GetSendIPAddress(FString& InIPAddress, int32& Port) const override;
@@ -33,25 +47,111 @@ public:
 	// Set IP Address
 	bool SetSendIPAddress(const FString& InIPAddress, const int32 Port) override;
 
-	// Send PSN Data
+	/**
+	 * Send every packet on each of these local interfaces, by IPv4 address, instead of the default route.
+	 * Frames are encoded once, so each interface carries the same bytes, frame ID and timestamp.
+	 * An empty list goes back to the default route. False if an address is invalid, leaving the interfaces unchanged.
+	 * An interface that cannot be bound is kept and reported as unhealthy.
+	 */
+	bool SetSendInterfaces(const TArray<FString>& LocalAddresses) override;
+
+	// Encode and send PSN Data on the calling thread
 	void SendPSNData(TArray<FPSNTracker> TrackerData, uint64 Lifetime);
 
 	void SendPSNInfo(TArray<FPSNTracker> TrackerData, uint64 Lifetime);
 
-	// Stop Socket. Handles itself on EndPlay so no need to call then.
+	/**
+	 * Hand a data frame to the send thread, which encodes and sends the newest published frame.
+	 * TrackerData is swapped with an earlier snapshot's storage, so the caller can refill it without allocating.
+	 * Names come from the name table.
+	 */
+	void PublishPSNData(TArray<FPSNTrackerRecord>& TrackerData, uint64 Lifetime);
+
+	/** Ask the send thread to send the info packet, built from the name table */
+	void PublishPSNInfo(uint64 Lifetime);
+
+	/** Register a tracker name for the info packet. Converted to UTF-8 once, here. */
+	void SetTrackerName(int32 ID, const FString& Name);
+
+	void RemoveTrackerName(int32 ID);
+
+	// Stop the send thread and Socket. Handles itself on EndPlay so no need to call then.
 	void Stop();
 
 private:
 
-	void SendPacket(strlist packet);
+	// Returns the number of bytes sent on the first healthy interface
+	int32 SendPacket(const strlist& packet);
+
+	// Create the sockets for Interfaces, reporting each in Stats. Called with SendLock held.
+	void BuildSockets();
+	void DestroySockets();
+
+	// Socket bound to one local interface, null if the bind failed
+	FSocket* CreateInterfaceSocket(const FIPv4Address& LocalAddress) const;
+
+	// Encode and send, on either the send thread or the caller's thread
+	void EncodeAndSendData(const TArray<FPSNTrackerRecord>& TrackerData, uint64 Lifetime);
+	void EncodeAndSendInfo(const ::psn::tracker_map& Trackers, uint64 Lifetime);
+
+	// Start the send thread on first publish
+	void StartWorker();
 
-	FSocket* Socket;
+	// Send thread body: wait for published frames and send the newest
+	void WorkerLoop();
+
+	/** A socket bound to one local interface */
+	struct FSendSocket
+	{
+		FSocket* Socket = nullptr;
+		FIPv4Address LocalAddress;
+
+		// While Socket is null: when to try binding again, and the wait after that, doubling up to MaxRetrySeconds
+		double NextRetryTime = 0.0;
+		double RetrySeconds = 0.0;
+	};
+
+	// Backoff for rebinding an interface whose socket could not be created, e.g. an adapter that is not up yet
+	static constexpr double MinRetrySeconds = 1.0;
+	static constexpr double MaxRetrySeconds = 30.0;
+
+	// One per interface, or a single unbound socket for the default route. Guarded by SendLock.
+	TArray<FSendSocket> Sockets;
+
+	// Local addresses chosen with SetSendInterfaces, empty for the default route
+	TArray<FIPv4Address> Interfaces;
 
 	TSharedPtr<FInternetAddr> IPAddress;
 
 	FString SenderName;
 
+	// Counters owned by the sender subsystem
+	FPSNSenderStats& Stats;
+
 	// Encoder. Single encoder exists once per Proxy since we need data persistence for correct iterations of packets. 
 	TUniquePtr<class ::psn::psn_encoder> psn_encoder;
 
+	// Held while encoding and sending, so the encoder and socket are only used by one thread at a time
+	FCriticalSection SendLock;
+
+	// Native trackers reused from frame to frame, guarded by SendLock
+	::psn::tracker_map DataTrackers;
+
+	// Published snapshots and the name table, guarded by PublishLock
+	FCriticalSection PublishLock;
+	TArray<FPSNTrackerRecord> PendingData;
+	uint64 PendingDataLifetime = 0;
+	uint64 PendingInfoLifetime = 0;
+	bool bHasPendingData = false;
+	bool bHasPendingInfo = false;
+	TMap<int32, ::std::string> TrackerNames;
+	bool bTrackerNamesChanged = false;
+
+	// Owned by the send thread while it encodes; swapped back into the pending slot afterwards
+	TArray<FPSNTrackerRecord> SendingData;
+
+	TUniquePtr<FThread> Worker;
+	FEvent* WorkAvailable = nullptr;
+	std::atomic<bool> bStopping{ false };
+
 };
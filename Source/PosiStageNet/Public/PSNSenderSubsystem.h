@@ -6,10 +6,78 @@
 #include "Engine/EngineTypes.h"
 #include "Subsystems/GameInstanceSubsystem.h"
 #include "PSNMessage.h"
+#include "PSNTrackerRecord.h"
+#include "PSNCoordinateSpace.h"
 #include "PSNSenderProxy.h"
+#include "PSNIDAllocator.h"
 #include "Tickable.h"
 #include "PSNSenderSubsystem.generated.h"
 
+class FChaosScene;
+class UPSNSenderSubsystem;
+class USceneComponent;
+
+/** The last three samples of a tracked component, used to derive speed and acceleration by finite differences */
+struct POSISTAGENET_API FPSNMotionHistory
+{
+	static constexpr int32 NumSamples = 3;
+
+	// Newest first
+	FVector Positions[NumSamples];
+	double Times[NumSamples];
+	int32 Count = 0;
+
+	// A sample at or before the newest time (a paused clock) replaces the newest sample
+	void Push(const FVector& Position, double Time);
+
+	FVector GetVelocity() const;
+	FVector GetAcceleration() const;
+};
+
+/** A component bound with AddComponentToTrack, and its motion history */
+struct FPSNComponentTrack
+{
+	FPSNTrackerInfo Info;
+	TWeakObjectPtr<USceneComponent> Component;
+	FPSNMotionHistory History;
+};
+
+/** Health of one local interface the sender transmits on */
+USTRUCT(BlueprintType)
+struct FPSNSendInterfaceStatus
+{
+	GENERATED_BODY()
+
+	/** Local IPv4 address, 0.0.0.0 for the default route */
+	UPROPERTY(BlueprintReadOnly, Category = "PSN")
+	FString Address;
+
+	/** False from a failed send until the next one succeeds */
+	UPROPERTY(BlueprintReadOnly, Category = "PSN")
+	bool bHealthy = true;
+
+	UPROPERTY(BlueprintReadOnly, Category = "PSN")
+	int64 PacketsSent = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "PSN")
+	int64 SocketErrors = 0;
+
+	/** Seconds since a frame last went out on this interface, -1 if none has */
+	UPROPERTY(BlueprintReadOnly, Category = "PSN")
+	float SecondsSinceLastSend = -1.f;
+};
+
+/** Samples tracked components in the sender's chosen tick group */
+struct FPSNSenderTickFunction : public FTickFunction
+{
+	UPSNSenderSubsystem* Target = nullptr;
+
+	//~ Begin FTickFunction Interface
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+	//~ End FTickFunction Interface
+};
+
 /**
  *	PSN Sender Subsystem. 
  */
@@ -40,11 +108,65 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "PSN")
 	void UpdateTracker(FName TrackerName, FPSNTrackerData NewData);
 
+	/** Stop sending a tracker added with AddTracker and free its ID. Returns false if no tracker has that name. */
+	UFUNCTION(BlueprintCallable, Category = "PSN")
+	bool RemoveTracker(FName TrackerName);
+
 	// Tracker Component is a live updated component
 	UFUNCTION(BlueprintCallable, Category = "PSN")
 	void AddComponentToTrack(FPSNTrackerInfo Meta, USceneComponent* Component);
 
-	uint64 GetTimestamp();
+	/**
+	 * Stop sending every tracker bound to this component and free their IDs. Returns false if the component was not tracked.
+	 * Passing None removes trackers whose component has been destroyed.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "PSN")
+	bool RemoveComponentToTrack(USceneComponent* Component);
+
+	/** Map trackers from Unreal into the receiver's PSN space with the inverse of this preset. None converts cm to meters only. */
+	UFUNCTION(BlueprintCallable, Category = "PSN")
+	void SetCoordinateSpace(UPSNCoordinateSpace* Space);
+
+	/** Choose the clock used to stamp outgoing frames */
+	UFUNCTION(BlueprintCallable, Category = "PSN")
+	void SetTimestampSource(EPSNTimestampSource Source);
+
+	UFUNCTION(BlueprintPure, Category = "PSN")
+	EPSNTimestampSource GetTimestampSource() const { return TimestampSource; }
+
+	/**
+	 * Tick group in which tracked components are sampled, and On Tick frames are sent.
+	 * Post Physics (default) sees final physics transforms; Post Update Work also sees late camera and attachment updates.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "PSN")
+	void SetSampleTickGroup(TEnumAsByte<ETickingGroup> TickGroup);
+
+	/**
+	 * Sample tracked components as soon as the physics scene ends its frame, instead of in the sample tick group.
+	 * Still once per game frame on the game thread; async physics steps and substeps in between are not sampled.
+	 * A world without a physics scene is sampled in the tick group instead, with a warning.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "PSN")
+	void SetSampleOnPhysicsTick(bool bEnable);
+
+	/**
+	 * Send every frame on each of these local interfaces, by IPv4 address, for redundant networks.
+	 * Frames are encoded once, so each network carries identical packets. An empty list uses the default route.
+	 * Kept across restarts of the sender. False if an address is invalid; an interface that cannot be bound shows as unhealthy.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "PSN|Redundancy")
+	bool SetSendInterfaces(const TArray<FString>& LocalAddresses);
+
+	/** IPv4 addresses of this machine's network adapters, to choose send interfaces from */
+	UFUNCTION(BlueprintCallable, Category = "PSN|Redundancy")
+	void GetLocalInterfaceAddresses(TArray<FString>& OutAddresses) const;
+
+	/** Health of each interface the sender is transmitting on */
+	UFUNCTION(BlueprintCallable, Category = "PSN|Redundancy")
+	void GetSendInterfaceStatus(TArray<FPSNSendInterfaceStatus>& OutStatus) const;
+
+	/** Timestamp of the last frame sent, in microseconds */
+	uint64 GetTimestamp() const { return FrameTimestamp; }
 
 	UFUNCTION()
 	void SendData();
@@ -55,9 +177,16 @@ public:
 	UFUNCTION(BlueprintPure, Category = "PSN")
 	bool IsSenderRunning();
 
+	/** The lowest ID at or above StartFrom not used by any tracker, or -1 if every ID is in use */
 	UFUNCTION(BlueprintPure, Category = "PSN", meta=(StartFrom=1))
 	int FindFreeID(int StartFrom);
 
+	UFUNCTION(BlueprintPure, Category = "PSN")
+	bool IsIDInUse(int ID) const;
+
+	/** Send counters, safe to read from any thread */
+	const FPSNSenderStats& GetStats() const { return Stats; }
+
 protected:
 
 	// Timer Handle for the Sender
@@ -73,19 +202,95 @@ private:
 
 	void BuildTrackerList();
 
-	int CheckAvailableID(int InID);
+	// Fill ComponentTrackers from every bound component, reading transforms in parallel
+	void SampleComponents();
+
+	// Take the frame timestamp and sample components
+	void SampleFrame();
+
+	// Called by SampleTickFunction in the chosen tick group
+	void OnSampleTick();
+	friend struct FPSNSenderTickFunction;
+
+	// Game thread, once per frame after the physics scene has ended its frame
+	void OnPhysicsPostTick(FChaosScene* Scene);
+
+	// Register the tick function and physics hook with the current world, once per world
+	void RegisterSampling();
+	void UnregisterSampling();
+	void OnWorldCleanup(UWorld* World, bool bSessionEnded, bool bCleanupResources);
+
+	// Whether components are sampled every frame, rather than when the tracker list is built
+	bool IsSamplingEachFrame() const;
+
+	// Claim the tracker's ID, warning if it is out of range or already used
+	bool ClaimTrackerID(const FPSNTrackerInfo& Info);
+
+	// Send the info packet now so receivers see a removal without waiting for the 1Hz timer
+	void RefreshInfo();
+
+	// Give a new sender proxy the names of every registered tracker
+	void RegisterTrackerNames();
+
+	// Read the chosen clock, in microseconds
+	uint64 SampleTimestamp() const;
+
+	// Restart the monotonic and custom time step clocks from zero
+	void ResetClockOrigin();
 
 	TUniquePtr<IPSNSenderProxy> SenderPtr;
 
+	// Local addresses to send on, see SetSendInterfaces
+	TArray<FString> SendInterfaces;
+
 	EPSNFrequency ChosenFrequency;
+
+	EPSNTimestampSource TimestampSource = EPSNTimestampSource::PSN_Monotonic;
+
+	// Clock values when the sender started
+	double MonotonicOrigin = 0.0;
+	double CustomTimeStepOrigin = 0.0;
+
+	// Unreal to PSN transform, applied to the whole tracker list once it is built
+	FPSNCoordinateTransform SendTransform = FPSNCoordinateTransform(0.01f);
+
+	// Sampled once at the start of each send, shared by the header and all trackers
+	uint64 FrameTimestamp = 0;
 	
-	// Map to store all component ptrs that we wish to send
-	TMap<FPSNTrackerInfo, USceneComponent*> ComponentMap;
+	// All components that we wish to send
+	TArray<FPSNComponentTrack> ComponentTracks;
+
+	// Index into ComponentTracks of each bound tracker, so rebinding finds its track without a scan
+	TMap<FPSNTrackerInfo, int32> ComponentTrackIndices;
+
+	// Components resolved on the game thread before the parallel read, parallel to ComponentTracks
+	TArray<const USceneComponent*> ResolvedComponents;
+
+	// Latest sample of each component, parallel to ComponentTracks
+	TArray<FPSNTrackerRecord> ComponentTrackers;
+
+	// Rotation of each component from the last sample, converted to PSN orientation in one batch
+	TArray<FQuat4f> ComponentRotations;
+
+	FPSNSenderTickFunction SampleTickFunction;
+	TEnumAsByte<ETickingGroup> SampleTickGroup = TG_PostPhysics;
+	bool bSampleOnPhysicsTick = false;
+
+	// World the tick function and physics hook are registered with
+	TWeakObjectPtr<UWorld> SamplingWorld;
+	FDelegateHandle PhysicsPostTickHandle;
+	FDelegateHandle WorldCleanupHandle;
 	
 	// Map to store all manually added trackers we wish to send
 	TMap<FName, FPSNTracker> TrackerMap;
 
-	// The combined tracker list, generated when using SendData, and cached so it can be send in the info packet.
-	TArray<FPSNTracker> TrackerList;
+	// IDs used by TrackerMap and ComponentTracks
+	FPSNIDAllocator TrackerIDs;
+
+	// The combined tracker list, generated when using SendData. Names are held by the proxy for the info packet.
+	// Publishing swaps it with recycled storage from the send thread.
+	TArray<FPSNTrackerRecord> TrackerList;
+
+	FPSNSenderStats Stats;
 
 };
@@ -0,0 +1,76 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Uniform grid over tracker positions, keyed by tracker ID.
+ * Moving a tracker within its cell is a single lookup; queries only visit the cells they overlap,
+ * so their cost follows the number of trackers nearby rather than the total.
+ */
+class POSISTAGENET_API FPSNSpatialHash
+{
+public:
+
+	/** CellSize in cm. Around the usual query radius works best. */
+	explicit FPSNSpatialHash(float InCellSize = 200.f);
+
+	/** Change the cell size, re-inserting every tracker */
+	void SetCellSize(float InCellSize);
+	float GetCellSize() const { return CellSize; }
+
+	/** Insert a tracker or move it to a new position */
+	void Update(int32 ID, const FVector3f& Position);
+
+	void Remove(int32 ID);
+
+	void Reset();
+
+	int32 Num() const { return Entries.Num(); }
+
+	/** Last position stored for a tracker. False if it is not in the grid. */
+	bool GetPosition(int32 ID, FVector3f& OutPosition) const;
+
+	/** Trackers within Radius of Center, unordered */
+	void QueryRadius(const FVector& Center, float Radius, TArray<int32>& OutIDs) const;
+
+	/** Trackers inside the box, unordered */
+	void QueryBox(const FBox& Box, TArray<int32>& OutIDs) const;
+
+	/** Up to Count trackers closest to Location, nearest first. MaxDistance of 0 is unlimited. */
+	void QueryNearest(const FVector& Location, int32 Count, TArray<int32>& OutIDs, float MaxDistance = 0.f) const;
+
+private:
+
+	struct FEntry
+	{
+		FIntVector Cell;
+
+		// Index of this tracker in its cell's list
+		int32 Slot = 0;
+	};
+
+	struct FCellItem
+	{
+		int32 ID;
+		FVector3f Position;
+	};
+
+	FIntVector ToCell(const FVector& Position) const;
+
+	void AddToCell(int32 ID, const FVector3f& Position, FEntry& Entry);
+	void RemoveFromCell(const FEntry& Entry);
+
+	// Visit the trackers in every cell from MinCell to MaxCell inclusive
+	template<typename VisitorType>
+	void ForEachInCells(const FIntVector& MinCell, const FIntVector& MaxCell, VisitorType&& Visitor) const;
+
+	float CellSize;
+	float InvCellSize;
+
+	TMap<int32, FEntry> Entries;
+
+	// Positions are kept with the IDs so a query reads each cell as one array
+	TMap<FIntVector, TArray<FCellItem>> Cells;
+};
@@ -0,0 +1,232 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include <atomic>
+
+// Stat Group, Mainly for Packet Queuing.
+DECLARE_STATS_GROUP(TEXT("PSN Commands"), STATGROUP_PSNNetworkCommands, STATCAT_Advanced);
+
+// Receive side
+DECLARE_CYCLE_STAT_EXTERN(TEXT("PSN Decode"), STAT_PSNDecode, STATGROUP_PSNNetworkCommands, POSISTAGENET_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("PSN Dispatch"), STAT_PSNDispatch, STATGROUP_PSNNetworkCommands, POSISTAGENET_API);
+DECLARE_FLOAT_ACCUMULATOR_STAT_EXTERN(TEXT("PSN Packets/s Received"), STAT_PSNPacketsPerSecond, STATGROUP_PSNNetworkCommands, POSISTAGENET_API);
+DECLARE_FLOAT_ACCUMULATOR_STAT_EXTERN(TEXT("PSN Bytes/s Received"), STAT_PSNBytesPerSecond, STATGROUP_PSNNetworkCommands, POSISTAGENET_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("PSN Frames Completed"), STAT_PSNFramesCompleted, STATGROUP_PSNNetworkCommands, POSISTAGENET_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("PSN Frames Dropped"), STAT_PSNFramesDropped, STATGROUP_PSNNetworkCommands, POSISTAGENET_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("PSN Frames Partial"), STAT_PSNFramesPartial, STATGROUP_PSNNetworkCommands, POSISTAGENET_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("PSN Frames Reordered"), STAT_PSNFramesReordered, STATGROUP_PSNNetworkCommands, POSISTAGENET_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("PSN Packets Duplicated"), STAT_PSNPacketsDuplicated, STATGROUP_PSNNetworkCommands, POSISTAGENET_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("PSN Queue Depth"), STAT_PSNQueueDepth, STATGROUP_PSNNetworkCommands, POSISTAGENET_API);
+DECLARE_FLOAT_ACCUMULATOR_STAT_EXTERN(TEXT("PSN Receive To Dispatch (ms)"), STAT_PSNDispatchLatency, STATGROUP_PSNNetworkCommands, POSISTAGENET_API);
+
+// Send side
+DECLARE_CYCLE_STAT_EXTERN(TEXT("PSN Encode"), STAT_PSNEncode, STATGROUP_PSNNetworkCommands, POSISTAGENET_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("PSN SendTo"), STAT_PSNSend, STATGROUP_PSNNetworkCommands, POSISTAGENET_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("PSN Packets Per Frame Sent"), STAT_PSNPacketsPerFrame, STATGROUP_PSNNetworkCommands, POSISTAGENET_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("PSN Socket Errors"), STAT_PSNSocketErrors, STATGROUP_PSNNetworkCommands, POSISTAGENET_API);
+
+CSV_DECLARE_CATEGORY_MODULE_EXTERN(POSISTAGENET_API, PSN);
+
+struct FPSNTrackerRecord;
+
+/**
+ * Counters for a single sending host, identified by its IPv4 address.
+ */
+struct POSISTAGENET_API FPSNSourceStats
+{
+	/** Source IPv4 address in host order, 0 while the slot is unused */
+	std::atomic<uint32> Address{ 0 };
+
+	std::atomic<uint64> PacketsReceived{ 0 };
+	std::atomic<uint64> DecodeErrors{ 0 };
+	std::atomic<uint64> FramesCompleted{ 0 };
+	std::atomic<int32> LastFrameID{ INDEX_NONE };
+
+	// Frame sequence, see FPSNFrameSequence
+	std::atomic<uint64> FramesLost{ 0 };
+	std::atomic<uint64> FramesPartial{ 0 };
+	std::atomic<uint64> FramesReordered{ 0 };
+	std::atomic<uint64> PacketsDuplicated{ 0 };
+	std::atomic<uint64> PacketsLate{ 0 };
+
+	/** Copies of packets that already arrived first over another path */
+	std::atomic<uint64> PacketsRedundant{ 0 };
+
+	std::atomic<double> LastReceiveTime{ 0.0 };
+	std::atomic<double> PacketsPerSecond{ 0.0 };
+
+	/** Trackers of this source whose receive times are kept, further IDs are only counted */
+	static constexpr int32 MaxTrackers = 1024;
+
+	/** Tracker updates whose receive time was not kept, because MaxTrackers other IDs already were or its slots were taken */
+	std::atomic<uint64> TrackersNotListed{ 0 };
+
+	/** Record that the trackers were received from this source at FPlatformTime::Seconds() Time. Socket thread, never blocks. */
+	void MarkTrackersReceived(const TArray<FPSNTrackerRecord>& Trackers, double Time);
+
+	/** Copy out the last receive time of every tracker this source has sent, unordered. Never blocks the receive path. */
+	void GetTrackersReceived(TArray<TPair<uint16, double>>& OutTrackers) const;
+
+private:
+
+	friend struct FPSNReceiverStats;
+	double WindowStart = 0.0;
+	uint64 WindowPackets = 0;
+
+	static constexpr uint32 EmptyTrackerSlot = ~0u;
+	static constexpr int32 NumTrackerSlots = MaxTrackers * 2;
+	static constexpr int32 MaxTrackerProbes = 32;
+
+	// Open addressed table from tracker ID to last receive time, claimed with a compare and swap so several socket
+	// threads can write and any thread can read without a lock. Half full at most, so probes stay short.
+	struct FTrackerSlot
+	{
+		std::atomic<uint32> ID{ EmptyTrackerSlot };
+		std::atomic<double> LastReceived{ 0.0 };
+	};
+	FTrackerSlot TrackerSlots[NumTrackerSlots];
+	std::atomic<int32> NumTrackersListed{ 0 };
+};
+
+/**
+ * Receive side counters. Written from the socket thread and the game thread, safe to read from any thread.
+ */
+struct POSISTAGENET_API FPSNReceiverStats
+{
+	/** Number of sending hosts tracked individually, further sources only count towards the totals */
+	static constexpr int32 MaxSources = 16;
+
+	std::atomic<uint64> PacketsReceived{ 0 };
+	std::atomic<uint64> BytesReceived{ 0 };
+	std::atomic<uint64> DecodeErrors{ 0 };
+	std::atomic<uint64> FramesCompleted{ 0 };
+	std::atomic<int32> QueueDepth{ 0 };
+
+	// Time spent in the decoder, over the packets that reached it. Redundant copies and late packets are dropped before.
+	std::atomic<uint64> PacketsDecoded{ 0 };
+	std::atomic<uint64> DecodeCycles{ 0 };
+
+	// Frame sequence over every source. Dropped frames never arrived; reordered frames arrived after a newer
+	// frame and were discarded; duplicated packets repeat a frame that had already arrived complete; late packets are
+	// the other packets discarded for belonging to an older frame.
+	std::atomic<uint64> FramesDropped{ 0 };
+	std::atomic<uint64> FramesPartial{ 0 };
+	std::atomic<uint64> FramesReordered{ 0 };
+	std::atomic<uint64> PacketsDuplicated{ 0 };
+	std::atomic<uint64> PacketsLate{ 0 };
+
+	// Copies dropped when merging redundant paths, see FPSNRedundantMerge
+	std::atomic<uint64> PacketsRedundant{ 0 };
+
+	// Game thread time spent dispatching queued trackers
+	std::atomic<uint64> DispatchCycles{ 0 };
+
+	// Receive to dispatch latency, summed over every dispatched tracker
+	std::atomic<uint64> TrackersDispatched{ 0 };
+
+	// Dispatched trackers not broadcast because they had not changed, see UPSNReceiverSubsystem::SetChangeSuppression
+	std::atomic<uint64> TrackersSuppressed{ 0 };
+
+	// Trackers dropped because another source already holds their ID, see UPSNReceiverSubsystem::GetTrackerSnapshot
+	std::atomic<uint64> TrackerIDConflicts{ 0 };
+	std::atomic<uint64> DispatchLatencyCycles{ 0 };
+	std::atomic<double> LastDispatchLatencyMs{ 0.0 };
+
+	// Rates over the last complete one second window
+	std::atomic<double> PacketsPerSecond{ 0.0 };
+	std::atomic<double> BytesPerSecond{ 0.0 };
+
+	/** Roll the rate window and push the values to STAT and CSV. Game thread only, every frame while receiving. */
+	void Publish();
+
+	/** Print every counter */
+	void Dump(FOutputDevice& Ar) const;
+
+	double GetAverageDecodeMicroseconds() const;
+	double GetAverageDispatchLatencyMs() const;
+
+	/** Counters for the given source address, claiming a free slot if needed. Null once every slot is taken. */
+	FPSNSourceStats* FindOrAddSource(uint32 Address);
+
+	/** Per source counters, unused slots have an address of 0 */
+	const FPSNSourceStats* GetSources() const { return Sources; }
+
+private:
+
+	double WindowStart = 0.0;
+	uint64 WindowPackets = 0;
+	uint64 WindowBytes = 0;
+
+	FPSNSourceStats Sources[MaxSources];
+};
+
+/**
+ * Counters for one local interface a sender transmits on.
+ */
+struct POSISTAGENET_API FPSNSendInterfaceStats
+{
+	/** Local IPv4 address in host order, 0 for the default route */
+	std::atomic<uint32> Address{ 0 };
+
+	/** False while the slot is unused */
+	std::atomic<bool> bActive{ false };
+
+	/** False from a failed send until the next one succeeds */
+	std::atomic<bool> bHealthy{ true };
+
+	std::atomic<uint64> PacketsSent{ 0 };
+	std::atomic<uint64> BytesSent{ 0 };
+	std::atomic<uint64> SocketErrors{ 0 };
+
+	/** FPlatformTime::Seconds() of the last successful send */
+	std::atomic<double> LastSendTime{ 0.0 };
+};
+
+/**
+ * Send side counters. Written by the sender, safe to read from any thread.
+ */
+struct POSISTAGENET_API FPSNSenderStats
+{
+	/** Number of local interfaces a sender can transmit on at once */
+	static constexpr int32 MaxInterfaces = 4;
+
+	std::atomic<uint64> FramesSent{ 0 };
+	std::atomic<uint64> PacketsSent{ 0 };
+	std::atomic<uint64> BytesSent{ 0 };
+	std::atomic<uint64> SocketErrors{ 0 };
+	std::atomic<uint64> TrackerListBuilds{ 0 };
+	std::atomic<uint64> BuildCycles{ 0 };
+	std::atomic<uint64> EncodeCycles{ 0 };
+	std::atomic<uint64> SendCycles{ 0 };
+	std::atomic<uint32> LastPacketsPerFrame{ 0 };
+
+	/** Published frames replaced by a newer one before the send thread picked them up */
+	std::atomic<uint64> FramesSuperseded{ 0 };
+
+	/** Per interface counters, in the order the interfaces were given */
+	FPSNSendInterfaceStats Interfaces[MaxInterfaces];
+
+	// Rates over the last complete one second window
+	std::atomic<double> FramesPerSecond{ 0.0 };
+	std::atomic<double> BytesPerSecond{ 0.0 };
+
+	/** Roll the rate window and push the values to STAT and CSV. Game thread only. */
+	void Publish();
+
+	/** Print every counter */
+	void Dump(FOutputDevice& Ar) const;
+
+	double GetAverageBuildMicroseconds() const;
+	double GetAverageEncodeMicroseconds() const;
+	double GetAverageSendMicroseconds() const;
+
+private:
+
+	double WindowStart = 0.0;
+	uint64 WindowFrames = 0;
+	uint64 WindowBytes = 0;
+};
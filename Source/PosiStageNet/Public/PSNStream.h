@@ -6,6 +6,8 @@
 #include <list>
 
 struct FTracker;
+struct FPSNSourceInfo;
+struct FPSNTrackerRecord;
 
 // Define std list of string as a typedef
 typedef ::std::list <::std::string> strlist;
@@ -30,19 +32,29 @@ public:
 	// ctor - sized only, null data
 	FPSNStream(int32 InSize);
 
-	// Decode Tracker Map. Requires Stream to be made with the data ctor so it has size and data ready to decode. 
-	void DecodeToTrackers(TArray<FPSNTracker>& InTrackerMap, ::psn::psn_decoder* Decoder);
+	// Decode Tracker Map. Requires Stream to be made with the data ctor so it has size and data ready to decode. Returns false if the packet failed to decode.
+	// Data packets fill OutTrackers when a new frame completes. Info packets only update the decoder, see ConvertInfo.
+	bool DecodeToTrackers(TArray<FPSNTrackerRecord>& OutTrackers, ::psn::psn_decoder* Decoder);
+
+	// Convert the names of the decoder's last complete info frame to FStrings
+	static void ConvertInfo(const ::psn::psn_decoder& Decoder, FPSNSourceInfo& OutInfo);
 
 	// Encode Tracker Map, return data and info packets
-	void EncodeToPSN(TArray<FPSNTracker> InTrackerMap, ::psn::psn_encoder* InEncoder, strlist& dataPacket, strlist& InfoPacket, uint64 TimespanMicroseconds, bool bIsHeader);
+	void EncodeToPSN(const TArray<FPSNTracker>& InTrackerMap, ::psn::psn_encoder* InEncoder, strlist& dataPacket, strlist& InfoPacket, uint64 TimespanMicroseconds, bool bIsHeader);
+
+	// Update a persistent native tracker map from a data frame in place. Names are not touched, and nodes are only allocated when the set of IDs changes.
+	static void UpdateNativeTrackers(const TArray<FPSNTrackerRecord>& InTrackers, ::psn::tracker_map& InOutNativeTrackers);
+
+	// Read the packet chunk ID, frame ID and frame packet count from raw packet data without decoding it. False if the header chunk is missing or truncated.
+	static bool PeekHeader(const uint8* InData, int32 InSize, uint16& OutPacketID, uint8& OutFrameID, uint8& OutFramePacketCount);
 
 	uint8_t GetHeaderFrameID();
 
-	EPSNPacketType StreamDataType;
+	EPSNPacketType StreamDataType = EPSNPacketType::PSNType_Invalid;
 
 private:
 
-	inline FString StringToFString(std::string InString);
+	static inline FString StringToFString(const std::string& InString);
 
 	/** Stream data. */
 	TArray<uint8> Data;
@@ -50,6 +62,6 @@ private:
 	/** Current buffer position. */
 	int32 Position;
 
-	uint8_t HeaderFrameID;
+	uint8_t HeaderFrameID = 0;
 
 };
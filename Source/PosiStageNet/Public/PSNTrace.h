@@ -0,0 +1,46 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Trace/Trace.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+/*
+* PSN trace channel for Unreal Insights. Enable with -trace=cpu,psn (or "Trace.Enable psn" at runtime).
+* CPU scopes cover each pipeline stage, the events carry frame IDs and packet counts so one frame
+* can be followed from BuildTrackerList on the sender to dispatch on the receiver.
+*/
+
+#if UE_TRACE_ENABLED
+
+UE_TRACE_CHANNEL_EXTERN(PSNChannel, POSISTAGENET_API);
+
+#define PSN_TRACE_SCOPE(Name) TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(Name, PSNChannel)
+
+#else
+
+#define PSN_TRACE_SCOPE(Name)
+
+#endif
+
+namespace PSNTrace
+{
+	/** Sender encoded a data frame */
+	POSISTAGENET_API void FrameEncoded(uint8 FrameID, uint32 PacketCount, uint32 TrackerCount);
+
+	/** Sender finished the SendTo calls for a frame */
+	POSISTAGENET_API void FrameSent(uint8 FrameID, uint32 PacketCount, uint32 Bytes);
+
+	/** Receiver read a packet from the socket */
+	POSISTAGENET_API void PacketReceived(uint32 Bytes);
+
+	/** Receiver reassembled and decoded a complete data frame */
+	POSISTAGENET_API void FrameDecoded(uint8 FrameID, uint32 PacketCount, uint32 TrackerCount);
+
+	/** Receiver queued a frame's trackers for the game thread */
+	POSISTAGENET_API void FrameEnqueued(uint8 FrameID, uint32 TrackerCount);
+
+	/** Game thread broadcast a frame's trackers */
+	POSISTAGENET_API void FrameDispatched(uint8 FrameID, uint32 TrackerCount);
+}
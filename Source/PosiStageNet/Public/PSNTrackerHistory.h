@@ -0,0 +1,99 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FPSNTrackerRecord;
+
+/**
+ * Recent positions and rotations of every tracker, in a fixed number of samples per tracker.
+ * Each tracker owns a ring of samples in one shared pool, so once a tracker has been seen, recording
+ * it never allocates. Samples are quantised to 24 bytes: time to 0.1 ms, position to 0.1 mm and
+ * rotation to 16 bits per quaternion component.
+ */
+class POSISTAGENET_API FPSNTrackerHistory
+{
+public:
+
+	explicit FPSNTrackerHistory(int32 InSamplesPerTracker = 60);
+
+	/** Change the number of samples kept per tracker. 0 turns history off. Clears the history. */
+	void SetSamplesPerTracker(int32 InSamplesPerTracker);
+	int32 GetSamplesPerTracker() const { return SamplesPerTracker; }
+
+	/** Preallocate rings for this many trackers */
+	void Reserve(int32 NumTrackers);
+
+	/** Record a sample. A time at or before the newest sample (a paused clock) replaces the newest sample. */
+	void Push(int32 ID, double Time, const FVector3f& Position, const FQuat4f& Rotation);
+
+	/** Record the position and orientation of a received tracker, in Unreal units */
+	void Push(int32 ID, double Time, const FPSNTrackerRecord& Record);
+
+	void Remove(int32 ID);
+
+	void Reset();
+
+	int32 NumSamples(int32 ID) const;
+
+	/** State at Time, interpolated between the samples either side, or the oldest or newest sample outside the history */
+	bool GetStateAtTime(int32 ID, double Time, FVector& OutPosition, FQuat& OutRotation) const;
+
+	/** Positions recorded from StartTime to EndTime, oldest first */
+	bool GetTrajectory(int32 ID, double StartTime, double EndTime, TArray<FVector>& OutPositions, TArray<double>* OutTimes = nullptr) const;
+
+	/** Average velocity in cm/s from StartTime to EndTime, clamped to the recorded history. False with under two samples. */
+	bool GetVelocity(int32 ID, double StartTime, double EndTime, FVector& OutVelocity) const;
+
+private:
+
+	static constexpr double TicksPerSecond = 10000.0;
+
+	// Positions are stored in units of 0.01 cm
+	static constexpr double PositionSteps = 100.0;
+
+	struct FSample
+	{
+		// Ticks of 0.1 ms since Origin
+		uint32 Time;
+		int32 Position[3];
+		int16 Rotation[4];
+	};
+	static_assert(sizeof(FSample) == 24, "History samples are expected to stay 24 bytes");
+
+	struct FRing
+	{
+		// First sample of this ring in Samples
+		int32 Start = 0;
+
+		// Newest sample, relative to Start
+		int32 Head = 0;
+		int32 Count = 0;
+	};
+
+	// Sample by age order, 0 being the oldest
+	const FSample& GetSample(const FRing& Ring, int32 Index) const;
+
+	// Interpolated state at a time in ticks, clamped to the ring. Either output may be null.
+	void Interpolate(const FRing& Ring, double Ticks, FVector* OutPosition, FQuat* OutRotation) const;
+
+	double ToTicks(double Time) const { return (Time - Origin) * TicksPerSecond; }
+	double ToTime(uint32 Ticks) const { return Origin + Ticks / TicksPerSecond; }
+
+	static FVector ToPosition(const FSample& Sample);
+	static FQuat ToRotation(const FSample& Sample);
+
+	int32 AllocateRing();
+
+	int32 SamplesPerTracker;
+
+	// Time of tick 0, set by the first sample
+	double Origin = 0.0;
+	bool bHasOrigin = false;
+
+	TMap<int32, int32> RingIndices;
+	TArray<FRing> Rings;
+	TArray<int32> FreeRings;
+	TArray<FSample> Samples;
+};
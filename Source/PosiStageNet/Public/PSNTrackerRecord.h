@@ -0,0 +1,183 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PSNMessage.h"
+#include "PSNOrientation.h"
+
+/** Bits of FPSNTrackerRecord::Fields, in the same order as the PSN data tracker chunk IDs */
+namespace EPSNTrackerField
+{
+	enum Type : uint8
+	{
+		Position		= 1 << ::psn::DATA_TRACKER_POS,
+		Speed			= 1 << ::psn::DATA_TRACKER_SPEED,
+		Orientation		= 1 << ::psn::DATA_TRACKER_ORI,
+		Status			= 1 << ::psn::DATA_TRACKER_STATUS,
+		Acceleration	= 1 << ::psn::DATA_TRACKER_ACCEL,
+		TargetPosition	= 1 << ::psn::DATA_TRACKER_TRGTPOS,
+		Timestamp		= 1 << ::psn::DATA_TRACKER_TIMESTAMP,
+
+		All = Position | Speed | Orientation | Status | Acceleration | TargetPosition | Timestamp,
+	};
+}
+
+/**
+ * Tracker state as it moves through the send and receive pipelines.
+ * Floats and no strings, so a frame is one flat array that copies with memcpy. Names are looked up by ID when needed.
+ * Converted to the Blueprint facing FPSNTracker only when it is handed to a delegate or a Blueprint call.
+ */
+struct FPSNTrackerRecord
+{
+	uint64 Timestamp = 0;
+
+	FVector3f Position = FVector3f::ZeroVector;
+	FVector3f Speed = FVector3f::ZeroVector;
+
+	/** Axis-angle orientation as carried on the wire, see PSNOrientation */
+	FVector3f Orientation = FVector3f::ZeroVector;
+
+	FVector3f Acceleration = FVector3f::ZeroVector;
+	FVector3f TargetPosition = FVector3f::ZeroVector;
+	float Status = 0.f;
+
+	uint16 ID = 0;
+
+	/** EPSNTrackerField bits for the fields that were set */
+	uint8 Fields = 0;
+
+	/** PSN frame the tracker arrived in. Receiver only. */
+	uint8 FrameID = 0;
+
+	FORCEINLINE bool HasField(EPSNTrackerField::Type Field) const { return (Fields & Field) != 0; }
+
+	// Read every field set on a decoded native tracker. The name is left behind.
+	static FPSNTrackerRecord FromNative(const ::psn::tracker& InTracker, uint8 InFrameID)
+	{
+		FPSNTrackerRecord Record;
+		Record.ID = InTracker.get_id();
+		Record.FrameID = InFrameID;
+		if (InTracker.is_pos_set())
+		{
+			Record.Position = Conv_Float3ToVector3f(InTracker.get_pos());
+			Record.Fields |= EPSNTrackerField::Position;
+		}
+		if (InTracker.is_speed_set())
+		{
+			Record.Speed = Conv_Float3ToVector3f(InTracker.get_speed());
+			Record.Fields |= EPSNTrackerField::Speed;
+		}
+		if (InTracker.is_ori_set())
+		{
+			Record.Orientation = Conv_Float3ToVector3f(InTracker.get_ori());
+			Record.Fields |= EPSNTrackerField::Orientation;
+		}
+		if (InTracker.is_status_set())
+		{
+			Record.Status = InTracker.get_status();
+			Record.Fields |= EPSNTrackerField::Status;
+		}
+		if (InTracker.is_accel_set())
+		{
+			Record.Acceleration = Conv_Float3ToVector3f(InTracker.get_accel());
+			Record.Fields |= EPSNTrackerField::Acceleration;
+		}
+		if (InTracker.is_target_pos_set())
+		{
+			Record.TargetPosition = Conv_Float3ToVector3f(InTracker.get_target_pos());
+			Record.Fields |= EPSNTrackerField::TargetPosition;
+		}
+		if (InTracker.is_timestamp_set())
+		{
+			Record.Timestamp = InTracker.get_timestamp();
+			Record.Fields |= EPSNTrackerField::Timestamp;
+		}
+		return Record;
+	}
+
+	// Write the set fields into an existing native tracker, leaving its ID and name alone
+	void WriteNative(::psn::tracker& NativeTracker) const
+	{
+		if (HasField(EPSNTrackerField::Position))
+		{
+			NativeTracker.set_pos(Conv_Vector3fToFloat3(Position));
+		}
+		if (HasField(EPSNTrackerField::Speed))
+		{
+			NativeTracker.set_speed(Conv_Vector3fToFloat3(Speed));
+		}
+		if (HasField(EPSNTrackerField::Orientation))
+		{
+			NativeTracker.set_ori(Conv_Vector3fToFloat3(Orientation));
+		}
+		if (HasField(EPSNTrackerField::Status))
+		{
+			NativeTracker.set_status(Status);
+		}
+		if (HasField(EPSNTrackerField::Acceleration))
+		{
+			NativeTracker.set_accel(Conv_Vector3fToFloat3(Acceleration));
+		}
+		if (HasField(EPSNTrackerField::TargetPosition))
+		{
+			NativeTracker.set_target_pos(Conv_Vector3fToFloat3(TargetPosition));
+		}
+		if (HasField(EPSNTrackerField::Timestamp))
+		{
+			NativeTracker.set_timestamp(Timestamp);
+		}
+	}
+
+	// Take the ID, data and timestamp of a Blueprint tracker. Every field is marked as set.
+	void SetFromTracker(const FPSNTracker& InTracker)
+	{
+		ID = (uint16)InTracker.Info.ID;
+		Position = FVector3f(InTracker.Data.Position);
+		Speed = FVector3f(InTracker.Data.Speed);
+		Orientation = PSNOrientation::RotatorToAxisAngle(InTracker.Data.Orientation);
+		Status = InTracker.Data.Status;
+		Acceleration = FVector3f(InTracker.Data.Acceleration);
+		TargetPosition = FVector3f(InTracker.Data.TargetPosition);
+		Timestamp = (uint64)InTracker.Header.Timestamp;
+		Fields = EPSNTrackerField::All;
+	}
+
+	// Fill the ID, header and data of a Blueprint tracker. The name is up to the caller.
+	void ToTracker(FPSNTracker& OutTracker) const
+	{
+		OutTracker.Info.ID = ID;
+		OutTracker.Header.FrameID = FrameID;
+		OutTracker.Header.Timestamp = (int64)Timestamp;
+		OutTracker.Data.Position = FVector(Position);
+		OutTracker.Data.Speed = FVector(Speed);
+		OutTracker.Data.Orientation = PSNOrientation::AxisAngleToRotator(Orientation);
+		OutTracker.Data.Status = Status;
+		OutTracker.Data.Acceleration = FVector(Acceleration);
+		OutTracker.Data.TargetPosition = FVector(TargetPosition);
+	}
+
+	// Same fields set, and each within tolerance of Other's. Positions use PositionTolerance, everything else ValueTolerance.
+	bool NearlyEquals(const FPSNTrackerRecord& Other, float PositionTolerance, float ValueTolerance) const
+	{
+		return ((Fields ^ Other.Fields) & ~EPSNTrackerField::Timestamp) == 0 &&
+			Position.Equals(Other.Position, PositionTolerance) &&
+			TargetPosition.Equals(Other.TargetPosition, PositionTolerance) &&
+			Speed.Equals(Other.Speed, ValueTolerance) &&
+			Orientation.Equals(Other.Orientation, ValueTolerance) &&
+			Acceleration.Equals(Other.Acceleration, ValueTolerance) &&
+			FMath::IsNearlyEqual(Status, Other.Status, ValueTolerance);
+	}
+
+	static FORCEINLINE FVector3f Conv_Float3ToVector3f(const ::psn::float3& InFloat3)
+	{
+		return FVector3f(InFloat3.x, InFloat3.y, InFloat3.z);
+	}
+
+	static FORCEINLINE ::psn::float3 Conv_Vector3fToFloat3(const FVector3f& V)
+	{
+		return ::psn::float3(V.X, V.Y, V.Z);
+	}
+};
+
+static_assert(sizeof(FPSNTrackerRecord) == 80, "FPSNTrackerRecord should stay packed, 1000 trackers in 80KB");
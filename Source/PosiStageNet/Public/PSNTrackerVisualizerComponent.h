@@ -0,0 +1,70 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "PSNTrackerVisualizerComponent.generated.h"
+
+class UPSNReceiverSubsystem;
+
+UENUM(BlueprintType)
+enum class EPSNVisualizerColorMode : uint8
+{
+	PSN_None		UMETA(DisplayName = "None"),
+	PSN_Status		UMETA(DisplayName = "Status"),
+	PSN_Staleness	UMETA(DisplayName = "Staleness"),
+};
+
+/**
+ * Draws every tracker held by the PSN Receiver Subsystem as an instance of a single mesh.
+ * Instances are placed relative to this component, so attach it at the origin of the PSN space.
+ * When a colour mode is set, the value is written to per instance custom data slot 0 for the material to use.
+ */
+UCLASS(ClassGroup = (PSN), meta = (BlueprintSpawnableComponent))
+class POSISTAGENET_API UPSNTrackerVisualizerComponent : public UInstancedStaticMeshComponent
+{
+	GENERATED_BODY()
+
+public:
+
+	UPSNTrackerVisualizerComponent(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
+
+	//~ Begin UActorComponent Interface
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	//~ End UActorComponent Interface
+
+	/** Value written to per instance custom data slot 0 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "PSN")
+	EPSNVisualizerColorMode ColorMode = EPSNVisualizerColorMode::PSN_None;
+
+	/** Seconds without an update before a tracker reaches a staleness of 1 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "PSN", meta = (ClampMin = 0.01))
+	float StaleTime = 1.f;
+
+	/** Trackers not updated for this many seconds are not drawn. 0 draws them forever */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "PSN", meta = (ClampMin = 0))
+	float HideAfterSeconds = 0.f;
+
+	/** Whether instances follow the tracker orientation */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "PSN")
+	bool bApplyOrientation = true;
+
+	/** Scale applied to every instance */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "PSN")
+	FVector InstanceScale = FVector::OneVector;
+
+private:
+
+	UPSNReceiverSubsystem* GetReceiverSubsystem() const;
+
+	void UpdateInstances(const UPSNReceiverSubsystem& Receiver);
+
+	// Scratch buffers, reused between frames to avoid per frame allocation
+	TArray<FTransform> InstanceTransforms;
+	TArray<float> InstanceValues;
+	TArray<FVector3f> InstanceOrientations;
+	TArray<FQuat4f> InstanceRotations;
+
+	uint32 LastSnapshotRevision = 0;
+};
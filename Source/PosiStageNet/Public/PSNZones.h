@@ -0,0 +1,115 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PSNZones.generated.h"
+
+class FPSNSpatialHash;
+
+UENUM(BlueprintType)
+enum class EPSNZoneShape : uint8
+{
+	PSN_Box			UMETA(DisplayName = "Box"),
+	PSN_Sphere		UMETA(DisplayName = "Sphere"),
+	/** Polygon in the XY plane, extruded between two heights */
+	PSN_Polygon		UMETA(DisplayName = "Extruded Polygon"),
+};
+
+UENUM(BlueprintType)
+enum class EPSNZoneEventType : uint8
+{
+	PSN_Enter		UMETA(DisplayName = "Enter"),
+	PSN_Exit		UMETA(DisplayName = "Exit"),
+	/** The tracker has stayed inside for the zone's dwell time */
+	PSN_Dwell		UMETA(DisplayName = "Dwell"),
+};
+
+/** A trigger volume in Unreal space (cm) */
+struct POSISTAGENET_API FPSNZone
+{
+	FName Name;
+
+	EPSNZoneShape Shape = EPSNZoneShape::PSN_Box;
+
+	/** The box itself, or the bounds of the sphere or polygon. Used as the broad phase. */
+	FBox Bounds = FBox(ForceInit);
+
+	FVector Center = FVector::ZeroVector;
+	float Radius = 0.f;
+
+	/** Polygon outline, either winding */
+	TArray<FVector2D> Points;
+
+	/** Seconds inside before a dwell event. 0 for none. */
+	float DwellTime = 0.f;
+
+	static FPSNZone MakeBox(FName Name, const FBox& Box, float DwellTime = 0.f);
+	static FPSNZone MakeSphere(FName Name, const FVector& Center, float Radius, float DwellTime = 0.f);
+	static FPSNZone MakePolygon(FName Name, const TArray<FVector2D>& Points, float MinZ, float MaxZ, float DwellTime = 0.f);
+
+	bool Contains(const FVector3f& Position) const;
+};
+
+struct FPSNZoneEvent
+{
+	EPSNZoneEventType Type;
+	FName Zone;
+	int32 TrackerID;
+};
+
+/**
+ * Set of zones evaluated against every tracker in a spatial index in one pass.
+ * Each zone only tests the trackers in the grid cells under its bounds, and keeps its occupants sorted by ID
+ * so a pass reports the changes since the last one rather than every overlap.
+ */
+class POSISTAGENET_API FPSNZoneSet
+{
+public:
+
+	/** Add a zone, or replace the zone with the same name. Occupants are kept, and the next pass reports any difference. */
+	void AddZone(const FPSNZone& Zone);
+
+	/** Remove a zone, adding an exit event for each tracker still inside */
+	bool RemoveZone(FName Name, TArray<FPSNZoneEvent>& OutEvents);
+
+	/** Remove every zone, adding exit events for their occupants */
+	void Reset(TArray<FPSNZoneEvent>& OutEvents);
+
+	int32 Num() const { return Zones.Num(); }
+
+	/**
+	 * Test the trackers against every zone and add the enter, exit and dwell events since the last pass.
+	 * When bPositionsChanged is false only dwell times are checked.
+	 */
+	void Evaluate(const FPSNSpatialHash& Index, double Now, bool bPositionsChanged, TArray<FPSNZoneEvent>& OutEvents);
+
+	/** IDs of the trackers inside a zone as of the last pass, in ascending order */
+	bool GetOccupants(FName Name, TArray<int32>& OutIDs) const;
+
+private:
+
+	struct FOccupant
+	{
+		int32 ID;
+		double EnteredTime;
+		bool bDwellReported;
+	};
+
+	struct FZoneState
+	{
+		FPSNZone Zone;
+
+		// Sorted by ID
+		TArray<FOccupant> Occupants;
+	};
+
+	TArray<FZoneState> Zones;
+
+	// Zones changed since the last pass, so occupancy must be tested even if nothing moved
+	bool bZonesChanged = false;
+
+	// Reused by each pass
+	TArray<int32> Candidates;
+	TArray<FOccupant> NextOccupants;
+};
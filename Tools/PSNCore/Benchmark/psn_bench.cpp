@@ -0,0 +1,163 @@
+// Copyright 2021 Royal Shakespeare Company. All Rights Reserved.
+//
+// Microbenchmark for the engine-free PSN codec.
+// Reports encode and decode cost per tracker and heap allocations per frame.
+//
+// Usage: psn_bench [trackers per measurement]
+
+#include "PSN/psn_lib.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+// Allocation counting
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+static std::atomic< size_t > g_allocations( 0 ) ;
+
+void * operator new( size_t size )
+{
+    ++g_allocations ;
+    if ( void * ptr = std::malloc( size ? size : 1 ) )
+        return ptr ;
+    throw std::bad_alloc() ;
+}
+
+void operator delete( void * ptr ) noexcept { std::free( ptr ) ; }
+void operator delete( void * ptr , size_t ) noexcept { std::free( ptr ) ; }
+
+namespace
+{
+
+typedef std::chrono::steady_clock clock_type ;
+
+struct result
+{
+    double ns_per_tracker = 0 ;
+    double allocations_per_frame = 0 ;
+} ;
+
+psn::tracker_map make_trackers( size_t count )
+{
+    psn::tracker_map trackers ;
+
+    for ( size_t i = 0 ; i < count ; ++i )
+    {
+        uint16_t id = static_cast< uint16_t >( i + 1 ) ;
+        float f = static_cast< float >( i ) ;
+
+        psn::tracker tracker( id , "Tracker " + std::to_string( id ) ) ;
+        tracker.set_pos( psn::float3( f , f * 0.5f , 1.8f ) ) ;
+        tracker.set_speed( psn::float3( 0.1f , 0.2f , 0.0f ) ) ;
+        tracker.set_ori( psn::float3( 0.0f , 0.0f , f * 0.01f ) ) ;
+        tracker.set_status( 1.0f ) ;
+        tracker.set_timestamp( 1000 + i ) ;
+        trackers.emplace( id , tracker ) ;
+    }
+
+    return trackers ;
+}
+
+// Enough frames that every measurement processes roughly the same number of trackers
+size_t frames_for( size_t tracker_count , size_t trackers_per_measurement )
+{
+    size_t frames = trackers_per_measurement / tracker_count ;
+    return frames < 10 ? 10 : frames ;
+}
+
+result bench_encode( const psn::tracker_map & trackers , size_t frames )
+{
+    psn::psn_encoder encoder( "psn_bench" ) ;
+    encoder.encode_data( trackers , 0 ) ; // warm up
+
+    size_t allocations_before = g_allocations.load() ;
+    clock_type::time_point start = clock_type::now() ;
+
+    size_t packet_count = 0 ;
+    for ( size_t frame = 0 ; frame < frames ; ++frame )
+        packet_count += encoder.encode_data( trackers , frame ).size() ;
+
+    clock_type::time_point end = clock_type::now() ;
+    size_t allocations = g_allocations.load() - allocations_before ;
+
+    if ( packet_count == 0 )
+        std::fprintf( stderr , "encode produced no packets\n" ) ;
+
+    result r ;
+    r.ns_per_tracker = std::chrono::duration< double , std::nano >( end - start ).count() / double( frames * trackers.size() ) ;
+    r.allocations_per_frame = double( allocations ) / double( frames ) ;
+    return r ;
+}
+
+result bench_decode( const psn::tracker_map & trackers , size_t frames )
+{
+    psn::psn_encoder encoder( "psn_bench" ) ;
+    psn::psn_decoder decoder ;
+
+    // Pre-encode consecutive frames so the decoder sees a normal frame ID sequence
+    const size_t distinct_frames = 4 ;
+    std::vector< std::vector< std::string > > encoded ;
+    for ( size_t frame = 0 ; frame < distinct_frames ; ++frame )
+    {
+        std::list< std::string > packets = encoder.encode_data( trackers , frame ) ;
+        encoded.emplace_back( packets.begin() , packets.end() ) ;
+    }
+
+    for ( const std::string & packet : encoded[ 0 ] ) // warm up
+        decoder.decode( packet.data() , packet.size() ) ;
+
+    size_t allocations_before = g_allocations.load() ;
+    clock_type::time_point start = clock_type::now() ;
+
+    for ( size_t frame = 0 ; frame < frames ; ++frame )
+        for ( const std::string & packet : encoded[ ( frame + 1 ) % distinct_frames ] )
+            decoder.decode( packet.data() , packet.size() ) ;
+
+    clock_type::time_point end = clock_type::now() ;
+    size_t allocations = g_allocations.load() - allocations_before ;
+
+    // frame_packet_count is 8 bit, so frames of more than 255 packets cannot be reassembled whole
+    if ( decoder.get_data().trackers.size() != trackers.size() && encoded[ 0 ].size() <= 255 )
+        std::fprintf( stderr , "decode returned %zu of %zu trackers\n" , decoder.get_data().trackers.size() , trackers.size() ) ;
+
+    result r ;
+    r.ns_per_tracker = std::chrono::duration< double , std::nano >( end - start ).count() / double( frames * trackers.size() ) ;
+    r.allocations_per_frame = double( allocations ) / double( frames ) ;
+    return r ;
+}
+
+} // namespace
+
+int main( int argc , char ** argv )
+{
+    size_t trackers_per_measurement = 2000000 ;
+    if ( argc > 1 )
+        trackers_per_measurement = std::strtoull( argv[ 1 ] , nullptr , 10 ) ;
+
+    const size_t counts[] = { 1 , 10 , 100 , 1000 , 10000 } ;
+
+    std::printf( "%10s %10s %16s %16s %16s %16s\n" ,
+                 "trackers" , "packets" , "encode ns/trk" , "encode alloc/fr" , "decode ns/trk" , "decode alloc/fr" ) ;
+
+    for ( size_t count : counts )
+    {
+        psn::tracker_map trackers = make_trackers( count ) ;
+        size_t frames = frames_for( count , trackers_per_measurement ) ;
+
+        psn::psn_encoder encoder( "psn_bench" ) ;
+        size_t packets = encoder.encode_data( trackers , 0 ).size() ;
+
+        result encode = bench_encode( trackers , frames ) ;
+        result decode = bench_decode( trackers , frames ) ;
+
+        std::printf( "%10zu %10zu %16.1f %16.1f %16.1f %16.1f\n" ,
+                     count , packets , encode.ns_per_tracker , encode.allocations_per_frame , decode.ns_per_tracker , decode.allocations_per_frame ) ;
+    }
+
+    return 0 ;
+}